@@ -0,0 +1,72 @@
+
+/*  © Copyright CERN, 2015. All rights not expressly granted are reserved.
+
+    The stub of this file was generated by quasar (https://github.com/quasar-team/quasar/)
+
+    Quasar is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public Licence as published by
+    the Free Software Foundation, either version 3 of the Licence.
+    Quasar is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public Licence for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+
+ */
+
+
+#ifndef __DTestClass__H__
+#define __DTestClass__H__
+
+#include <Base_DTestClass.h>
+
+namespace Device
+{
+
+  class
+  DTestClass
+  : public Base_DTestClass
+  {
+
+  public:
+  /* sample constructor */
+  explicit DTestClass (
+    const Configuration::TestClass& config,
+    Parent_DTestClass* parent
+  ) ;
+  /* sample dtr */
+  ~DTestClass ();
+
+  /* delegators for
+  cachevariables and sourcevariables */
+
+  /* delegators for methods */
+  UaStatus callFeed (
+    OpcUa_Double value,
+    OpcUa_UInt32 sequence,
+    OpcUa_Boolean good
+  ) ;
+  
+  private:
+  /* Delete copy constructor and assignment operator */
+  DTestClass( const DTestClass& other );
+  DTestClass& operator=(const DTestClass& other);
+
+  // ----------------------------------------------------------------------- *
+  // -     CUSTOM CODE STARTS BELOW THIS COMMENT.                            *
+  // -     Don't change this comment, otherwise merge tool may be troubled.  *
+  // ----------------------------------------------------------------------- *
+
+  public:
+
+  private:
+
+
+
+	};
+
+}
+
+#endif // __DTestClass__H__
\ No newline at end of file
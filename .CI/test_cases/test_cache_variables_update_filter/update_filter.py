@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+'''
+update_filter.py
+
+@author:     agent <agent@local>
+
+@copyright:  2026 CERN
+
+@license:
+Copyright (c) 2026, CERN.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted
+provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions
+   and the following disclaimer in the documentation and/or other materials provided with the
+   distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT  HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS  OR
+IMPLIED  WARRANTIES, INCLUDING, BUT NOT  LIMITED TO, THE IMPLIED WARRANTIES  OF  MERCHANTABILITY
+AND  FITNESS  FOR  A  PARTICULAR  PURPOSE  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,  SPECIAL, EXEMPLARY, OR  CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF  SUBSTITUTE GOODS OR  SERVICES; LOSS OF
+USE, DATA, OR PROFITS; OR BUSINESS  INTERRUPTION) HOWEVER CAUSED AND ON ANY  THEORY  OF  LIABILITY,
+WHETHER IN  CONTRACT, STRICT  LIABILITY,  OR  TORT (INCLUDING  NEGLIGENCE OR OTHERWISE)  ARISING IN
+ANY WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+@contact:    quasar-developers@cern.ch
+'''
+
+import argparse
+import datetime
+import random
+import sys
+from colorama import Fore, Style
+from opcua import Client, ua
+
+# name -> predicate telling whether an update (new) is redundant with respect to the stored value, the way
+# updateFilter of given variable in Design.xml should see it
+FILTERS = {
+    'unfiltered':       lambda new, stored: False,
+    'suppressIfEqual':  lambda new, stored: new == stored,
+    'absoluteDeadband': lambda new, stored: abs(new - stored) <= 0.5,
+    'percentDeadband':  lambda new, stored: abs(new - stored) <= 10 / 100 * abs(stored),
+    'integerDeadband':  lambda new, stored: abs(int(new) - int(stored)) <= 2,
+    'text':             lambda new, stored: str(int(new)) == str(int(stored))
+}
+
+FIRST_SEQUENCE = 1000000  # becomes source timestamp in seconds, anything reasonable will do
+
+def make_feeds(num_feeds):
+    """A noisy analog channel with occasional steps, repetitions and changes of status"""
+    rng = random.Random(1234)
+    feeds = []
+    level = 100.0
+    for i in range(num_feeds):
+        if rng.random() < 0.05:
+            level += rng.choice([-20, -5, 5, 20])
+        value = level if rng.random() < 0.3 else round(level + rng.uniform(-0.3, 0.3), 2)
+        good = rng.random() > 0.02
+        feeds.append((value, FIRST_SEQUENCE + i, good))
+    return feeds
+
+def expected_outcome(feeds):
+    """For every variable: (last value let through, its sequence, its status, number of updates let through)"""
+    outcome = {}
+    for name, is_redundant in FILTERS.items():
+        stored = None  # as initialized by Design: NULL with a bad status, so the first update always goes through
+        let_through = 0
+        for value, sequence, good in feeds:
+            if stored is not None and stored[2] == good and is_redundant(value, stored[0]):
+                continue
+            stored = (value, sequence, good)
+            let_through += 1
+        outcome[name] = stored + (let_through,)
+    return outcome
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--endpoint', default='opc.tcp://127.0.0.1:4841')
+    parser.add_argument('--num_feeds', type=int, default=1000)
+    args = parser.parse_args()
+
+    feeds = make_feeds(args.num_feeds)
+    client = Client(args.endpoint)
+    client.connect()
+    failures = []
+    try:
+        obj = client.get_node('ns=2;s=tc')
+        for value, sequence, good in feeds:
+            obj.call_method('ns=2;s=tc.feed',
+                ua.Variant(value, ua.VariantType.Double),
+                ua.Variant(sequence, ua.VariantType.UInt32),
+                ua.Variant(good, ua.VariantType.Boolean))
+        for name, (value, sequence, good, let_through) in expected_outcome(feeds).items():
+            data_value = client.get_node(f'ns=2;s=tc.{name}').get_data_value()
+            expected_value = str(int(value)) if name == 'text' else int(value) if name == 'integerDeadband' else value
+            expected_timestamp = datetime.datetime(1970, 1, 1) + datetime.timedelta(seconds=sequence)
+            if data_value.SourceTimestamp != expected_timestamp:
+                failures.append(f'{name}: last update let through should be #{sequence}, source timestamp is {data_value.SourceTimestamp}')
+            if data_value.StatusCode.is_good() != good:
+                failures.append(f'{name}: status should be {"good" if good else "bad"}, is {data_value.StatusCode.name}')
+            elif data_value.Value.Value != expected_value:
+                failures.append(f'{name}: value should be {expected_value}, is {data_value.Value.Value}')
+            print(f'{name}: {let_through} of {len(feeds)} updates let through')
+    finally:
+        client.disconnect()
+
+    if failures:
+        print(f'{Fore.RED}{len(failures)} update filters misbehaved{Style.RESET_ALL}:')
+        for failure in failures:
+            print(failure)
+        sys.exit(1)
+    print(f'{Fore.GREEN}All update filters behaved as expected{Style.RESET_ALL}')
+
+if __name__ == "__main__":
+    main()
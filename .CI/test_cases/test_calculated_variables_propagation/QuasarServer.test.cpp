@@ -0,0 +1,324 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * QuasarServer.cpp (of test_calculated_variables_propagation)
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "QuasarServer.h"
+#include <LogIt.h>
+#include <shutdown.h>
+
+#include <ChangeNotifyingVariable.h>
+#include <AsyncEvaluator.h>
+#include <ASTestClass.h>
+
+namespace
+{
+
+//! Values of s are 1..NumUpdates; below 1000, so that 1001 * s can only come from b and c of the same s
+const unsigned int NumUpdates = 999;
+
+AddressSpace::ChangeNotifyingVariable* findVariable (AddressSpace::ASNodeManager* nm, const std::string& id)
+{
+    AddressSpace::ChangeNotifyingVariable* variable = dynamic_cast<AddressSpace::ChangeNotifyingVariable*>(
+        nm->getNode(UaNodeId(id.c_str(), nm->getNameSpaceIndex())));
+    if (!variable)
+        throw std::runtime_error("no variable " + id + " in the address space");
+    return variable;
+}
+
+//! Every value a variable takes, as its listeners see it
+class Recorder
+{
+public:
+    explicit Recorder (AddressSpace::ChangeNotifyingVariable* variable):
+        m_variable(variable),
+        m_handle(variable->addChangeListener([this](AddressSpace::ChangeNotifyingVariable&, const UaDataValue& newValue)
+        {
+            OpcUa_Double value = -1;
+            UaVariant(*newValue.value()).toDouble(value);
+            std::lock_guard<std::mutex> lock (m_lock);
+            m_values.push_back(value);
+        }))
+    {}
+
+    ~Recorder () { m_variable->removeChangeListener(m_handle); }
+
+    std::vector<double> values () const
+    {
+        std::lock_guard<std::mutex> lock (m_lock);
+        return m_values;
+    }
+
+private:
+    AddressSpace::ChangeNotifyingVariable* m_variable;
+    AddressSpace::ChangeNotifyingVariable::ListenerHandle m_handle;
+    mutable std::mutex m_lock;
+    std::vector<double> m_values;
+};
+
+/* The diamond s -> b, s -> c, b + c -> d (b = s, c = 1000 * s): every update of s must evaluate d exactly once,
+ * with b and c of that update - i.e. d = 1001 * s, anything else is a mixed state. */
+bool checkDiamond (AddressSpace::ASNodeManager* nm, AddressSpace::ASTestClass* tc)
+{
+    Recorder d (findVariable(nm, "tc.d"));
+    bool ok = true;
+    for (unsigned int s = 1; s <= NumUpdates && ok; ++s)
+    {
+        tc->setS(s, OpcUa_Good);
+        const std::vector<double> values = d.values();
+        if (values.size() != s)
+        {
+            LOG(Log::ERR) << "after " << s << " updates of s, d was evaluated " << values.size() << " times";
+            ok = false;
+        }
+        else if (values.back() != 1001.0 * s)
+        {
+            LOG(Log::ERR) << "for s=" << s << " d=" << values.back() << ", a mixed state (should be " << 1001 * s << ")";
+            ok = false;
+        }
+    }
+    if (ok)
+        LOG(Log::INF) << "diamond: " << NumUpdates << " updates of s, d evaluated once for each, never in a mixed state";
+    return ok;
+}
+
+/* The same diamond, evaluated by the threads of the asynchronous evaluation (--calculated_variables_async_threads),
+ * maybe limited in rate (--calculated_variables_max_rate). Changes get coalesced, so d needn't see every value of s,
+ * but every value it takes must be 1001 times one which s had, never going back; once s stops changing, d must
+ * converge to its last value; and d mustn't be evaluated more often than the rate allows. */
+bool checkDiamondAsync (AddressSpace::ASNodeManager* nm, AddressSpace::ASTestClass* tc, CalculatedVariables::AsyncEvaluator::Clock::duration minInterval)
+{
+    typedef CalculatedVariables::AsyncEvaluator::Clock Clock;
+    Recorder d (findVariable(nm, "tc.d"));
+    const Clock::time_point start = Clock::now();
+    for (unsigned int s = 1; s <= NumUpdates; ++s)
+    {
+        tc->setS(s, OpcUa_Good);
+        std::this_thread::sleep_for(std::chrono::microseconds(500)); // spread over time, for the rate to matter
+    }
+    const Clock::time_point lastUpdate = Clock::now();
+    std::vector<double> values = d.values();
+    while ((values.empty() || values.back() != 1001.0 * NumUpdates) && Clock::now() - lastUpdate < std::chrono::seconds(1))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        values = d.values();
+    }
+    const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    bool ok = true;
+    double previous = 0;
+    for (double value : values)
+    {
+        if (value < previous || value != 1001.0 * static_cast<unsigned int>(value / 1001.0) || value > 1001.0 * NumUpdates)
+        {
+            LOG(Log::ERR) << "d=" << value << " after d=" << previous << ": a mixed state or an old value of s";
+            ok = false;
+        }
+        previous = value;
+    }
+    if (values.empty() || values.back() != 1001.0 * NumUpdates)
+    {
+        LOG(Log::ERR) << "d didn't converge: " << (values.empty() ? 0 : values.back()) << " a second after s stopped changing at " << NumUpdates;
+        ok = false;
+    }
+    if (values.size() > NumUpdates)
+    {
+        LOG(Log::ERR) << "d was evaluated " << values.size() << " times for " << NumUpdates << " updates of s";
+        ok = false;
+    }
+    if (minInterval != Clock::duration::zero())
+    {
+        // the first evaluation may come right away, every next one at least minInterval later
+        const double interval = std::chrono::duration<double>(minInterval).count();
+        const size_t maxEvaluations = static_cast<size_t>(elapsed / interval) + 1;
+        if (values.size() > maxEvaluations)
+        {
+            LOG(Log::ERR) << "d was evaluated " << values.size() << " times in " << elapsed << "s, over the limit of 1 per " << interval << "s";
+            ok = false;
+        }
+    }
+    if (ok)
+        LOG(Log::INF) << "diamond, asynchronous: " << NumUpdates << " updates of s in " << elapsed << "s, d evaluated " << values.size() <<
+            " times, never in a mixed state, converged";
+    return ok;
+}
+
+//! What p, q and r are for their inputs a and b: (a + 1000 * b) * 1000000 + (1000 * a + b)
+double encode (unsigned int a, unsigned int b)
+{
+    return (a + 1000.0 * b) * 1000000.0 + (1000.0 * a + b);
+}
+
+//! Whether both halves of p, q or r come from the same a and b
+bool isConsistent (double value)
+{
+    const unsigned long long v = static_cast<unsigned long long>(value);
+    if (v != value)
+        return false;
+    const unsigned long long half1 = v / 1000000, half2 = v % 1000000;
+    return half1 % 1000 == half2 / 1000 && half1 / 1000 == half2 % 1000;
+}
+
+/* s, u and w written concurrently, each by its own thread, while every one of them feeds two or three synchronization
+ * domains: the writers must neither dead-lock (locking the domains of an input in a different order than another
+ * writer) nor let a formula see a change half-way (p, q, r with halves of different inputs, d of different s). */
+bool checkConcurrentWriters (AddressSpace::ASNodeManager* nm, AddressSpace::ASTestClass* tc)
+{
+    typedef std::chrono::steady_clock Clock;
+    Recorder d (findVariable(nm, "tc.d")), p (findVariable(nm, "tc.p")), q (findVariable(nm, "tc.q")), r (findVariable(nm, "tc.r"));
+    std::atomic<bool> stop (false);
+    const std::function<void (unsigned int)> setters[] = {
+        [tc](unsigned int value) { tc->setS(value, OpcUa_Good); },
+        [tc](unsigned int value) { tc->setU(value, OpcUa_Good); },
+        [tc](unsigned int value) { tc->setW(value, OpcUa_Good); }
+    };
+    std::vector<std::future<unsigned int>> writers;
+    for (unsigned int i = 0; i < 3; ++i)
+        writers.push_back(std::async(std::launch::async, [&stop, &setters, i]()
+        {
+            unsigned int value = 0;
+            for (unsigned int n = 0; !stop; ++n)
+            {
+                value = (n * (i + 1)) % NumUpdates + 1; // each at its own pace
+                setters[i](value);
+            }
+            return value;
+        }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    stop = true;
+    unsigned int last[3];
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        if (writers[i].wait_for(std::chrono::seconds(2)) != std::future_status::ready)
+        {
+            // the hung writers would keep the server from ever exiting, so do it the hard way
+            LOG(Log::ERR) << "concurrent writers didn't finish within 2s of being told to: a dead-lock";
+            std::_Exit(1);
+        }
+        last[i] = writers[i].get();
+    }
+    const double expected[] = { 1001.0 * last[0], encode(last[0], last[1]), encode(last[1], last[2]), encode(last[2], last[0]) };
+    const Recorder* recorders[] = { &d, &p, &q, &r };
+    const char* names[] = { "d", "p", "q", "r" };
+    // asynchronous evaluation may still be catching up
+    const Clock::time_point stopped = Clock::now();
+    auto converged = [&]()
+    {
+        for (unsigned int i = 0; i < 4; ++i)
+        {
+            const std::vector<double> values = recorders[i]->values();
+            if (values.empty() || values.back() != expected[i])
+                return false;
+        }
+        return true;
+    };
+    while (!converged() && Clock::now() - stopped < std::chrono::seconds(1))
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    bool ok = true;
+    size_t numValues = 0;
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        const std::vector<double> values = recorders[i]->values();
+        numValues += values.size();
+        for (double value : values)
+        {
+            if (i == 0 ? value != 1001.0 * static_cast<unsigned int>(value / 1001.0) : !isConsistent(value))
+            {
+                LOG(Log::ERR) << names[i] << "=" << std::fixed << value << ": computed from a change seen half-way";
+                ok = false;
+                break;
+            }
+        }
+        if (values.empty() || values.back() != expected[i])
+        {
+            LOG(Log::ERR) << names[i] << " ended at " << std::fixed << (values.empty() ? 0 : values.back()) << " instead of " << expected[i];
+            ok = false;
+        }
+    }
+    if (ok)
+        LOG(Log::INF) << "concurrent writers of inputs shared by domains: no dead-lock, " << numValues << " values of d, p, q, r, all consistent";
+    return ok;
+}
+
+bool checkPropagation (AddressSpace::ASNodeManager* nm)
+{
+    AddressSpace::ASTestClass* tc = dynamic_cast<AddressSpace::ASTestClass*>(nm->getNode(UaNodeId("tc", nm->getNameSpaceIndex())));
+    if (!tc)
+        throw std::runtime_error("no object tc in the address space");
+    CalculatedVariables::AsyncEvaluator* asyncEvaluator = CalculatedVariables::AsyncEvaluator::instance();
+    const bool diamondOk = asyncEvaluator ? checkDiamondAsync(nm, tc, asyncEvaluator->minInterval()) : checkDiamond(nm, tc);
+    return checkConcurrentWriters(nm, tc) && diamondOk;
+}
+
+}
+
+QuasarServer::QuasarServer() : BaseQuasarServer()
+{
+
+}
+
+QuasarServer::~QuasarServer()
+{
+
+}
+
+void QuasarServer::mainLoop()
+{
+    // a failed check ends the server, and so the test
+    if (!checkPropagation(getNodeManager()))
+        throw std::runtime_error("calculated variables propagated wrongly, see above");
+
+    printServerMsg("Press "+std::string(SHUTDOWN_SEQUENCE)+" to shutdown server");
+
+    // Wait for user command to terminate the server thread.
+
+    while(ShutDownFlag() == 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    printServerMsg(" Shutting down server");
+}
+
+void QuasarServer::initialize()
+{
+    LOG(Log::INF) << "Initializing Quasar server.";
+
+}
+
+void QuasarServer::shutdown()
+{
+	LOG(Log::INF) << "Shutting down Quasar server.";
+}
+
+void QuasarServer::initializeLogIt()
+{
+	BaseQuasarServer::initializeLogIt();
+    LOG(Log::INF) << "Logging initialized.";
+}
@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+'''
+restart_with_cache.py
+
+@author:     agent <agent@local>
+
+@copyright:  2026 CERN
+
+@license:
+Copyright (c) 2026, CERN.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted
+provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions
+   and the following disclaimer in the documentation and/or other materials provided with the
+   distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT  HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS  OR
+IMPLIED  WARRANTIES, INCLUDING, BUT NOT  LIMITED TO, THE IMPLIED WARRANTIES  OF  MERCHANTABILITY
+AND  FITNESS  FOR  A  PARTICULAR  PURPOSE  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,  SPECIAL, EXEMPLARY, OR  CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF  SUBSTITUTE GOODS OR  SERVICES; LOSS OF
+USE, DATA, OR PROFITS; OR BUSINESS  INTERRUPTION) HOWEVER CAUSED AND ON ANY  THEORY  OF  LIABILITY,
+WHETHER IN  CONTRACT, STRICT  LIABILITY,  OR  TORT (INCLUDING  NEGLIGENCE OR OTHERWISE)  ARISING IN
+ANY WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+@contact:    quasar-developers@cern.ch
+'''
+
+import argparse
+import os
+import subprocess
+import sys
+import time
+from colorama import Fore, Style
+from opcua import Client, ua
+
+def wait_for_server(endpoint, process, timeout):
+    """Returns a connected client as soon as the server accepts connections"""
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if process.poll() is not None:
+            raise Exception(f'Server exited prematurely with return code {process.returncode}')
+        client = Client(endpoint)
+        try:
+            client.connect()
+            return client
+        except Exception:
+            time.sleep(0.1)
+    raise Exception(f'Server did not start within {timeout}s')
+
+def dump_address_space(client):
+    """Browse name, node class and (for variables) value and data type of every node of the server's namespace(s),
+    by node id"""
+    dump = {}
+    pending = [client.get_objects_node()]
+    while pending:
+        node = pending.pop()
+        for child in node.get_children():
+            if child.nodeid.NamespaceIndex == 0:
+                continue # the standard nodes, e.g. the Server object
+            key = child.nodeid.to_string()
+            if key in dump:
+                continue
+            node_class = child.get_node_class()
+            entry = [child.get_browse_name().to_string(), str(node_class)]
+            if node_class == ua.NodeClass.Variable:
+                data_value = child.get_data_value()
+                entry += [repr(data_value.Value.Value), str(data_value.Value.VariantType), str(data_value.StatusCode)]
+            dump[key] = entry
+            pending.append(child)
+    return dump
+
+def terminate(process):
+    process.terminate()
+    try:
+        process.wait(timeout=30)
+    except subprocess.TimeoutExpired:
+        process.kill()
+        process.wait()
+
+def run_server(args, extra_args):
+    """Starts the server, returns the dump of its address space and its log"""
+    log_file_name = 'restart_with_cache.log'
+    with open(log_file_name, 'w') as log:
+        process = subprocess.Popen([args.server] + extra_args + [args.config], stdout=log, stderr=subprocess.STDOUT)
+        try:
+            client = wait_for_server(args.endpoint, process, args.timeout)
+            try:
+                dump = dump_address_space(client)
+            finally:
+                client.disconnect()
+        finally:
+            terminate(process)
+    with open(log_file_name) as log:
+        return dump, log.read()
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--server', default='./OpcUaServer')
+    parser.add_argument('--config', default='config.xml')
+    parser.add_argument('--config_cache', default='config.cache')
+    parser.add_argument('--endpoint', default='opc.tcp://127.0.0.1:4841')
+    parser.add_argument('--timeout', type=float, default=60)
+    args = parser.parse_args()
+
+    if os.path.exists(args.config_cache):
+        os.remove(args.config_cache)
+
+    failures = []
+    reference, _ = run_server(args, [])
+    print(f'without the cache: {len(reference)} nodes')
+    if not reference:
+        failures.append('the address space is empty')
+
+    for name, must_be_loaded_from_cache in [('first start with the cache', False), ('second start with the cache', True)]:
+        dump, log = run_server(args, ['--config_cache', args.config_cache])
+        loaded_from_cache = 'from cache' in log
+        print(f'{name}: {len(dump)} nodes, configuration {"loaded from" if loaded_from_cache else "not loaded from"} the cache')
+        if loaded_from_cache != must_be_loaded_from_cache:
+            failures.append(f'{name}: the configuration was {"" if loaded_from_cache else "not "}loaded from the cache')
+        if not os.path.exists(args.config_cache):
+            failures.append(f'{name}: no cache [{args.config_cache}] after it')
+        if dump != reference:
+            missing = [key for key in reference if key not in dump]
+            extra = [key for key in dump if key not in reference]
+            different = [key for key in reference if key in dump and dump[key] != reference[key]]
+            failures.append(f'{name}: address space differs, missing: {missing[:5]}, extra: {extra[:5]}, ' +
+                ', '.join(f'{key}: {reference[key]} vs {dump[key]}' for key in different[:5]))
+
+    leftovers = [f for f in os.listdir(os.path.dirname(os.path.abspath(args.config_cache)))
+        if f.startswith(os.path.basename(args.config_cache) + '.')]
+    if leftovers:
+        failures.append(f'temporary files of the cache left behind: {leftovers}')
+
+    if failures:
+        for failure in failures:
+            print(f'{Fore.RED}{failure}{Style.RESET_ALL}')
+        sys.exit(1)
+    print(f'{Fore.GREEN}Address space identical without the cache, with the cache written and with the cache used{Style.RESET_ALL}')
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,164 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * QuasarServer.cpp (of test_node_queries)
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <thread>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "QuasarServer.h"
+#include <LogIt.h>
+#include <shutdown.h>
+
+#include <ASNodeQueries.h>
+#include <ASCrate.h>
+#include <ASBoard.h>
+#include <ASChannel.h>
+
+namespace
+{
+
+//! The reference: walking the address space from the Objects folder
+template<typename T>
+std::vector<T*> walk (AddressSpace::ASNodeManager* nm, const std::string& pattern)
+{
+    std::vector<T*> found;
+    AddressSpace::findAllByPattern<T> (nm, nm->getNode(UaNodeId(OpcUaId_ObjectsFolder, 0)), OpcUa_NodeClass_Object, pattern, found);
+    return found;
+}
+
+template<typename T>
+std::vector<T*> sorted (std::vector<T*> nodes)
+{
+    std::sort(nodes.begin(), nodes.end());
+    return nodes;
+}
+
+/* Logs the outcome; the order matters only when ordered (findAllObjectsByPatternInNodeManager keeps the order of
+ * the walk), the index gives the nodes in the order of types or of ids. */
+template<typename T>
+bool compare (const std::string& query, const std::vector<T*>& found, const std::vector<T*>& reference, bool ordered)
+{
+    const bool same = ordered ? found == reference : sorted(found) == sorted(reference);
+    if (same && !reference.empty())
+        LOG(Log::INF) << query << ": " << found.size() << " objects, as walking the address space";
+    else
+        LOG(Log::ERR) << query << ": " << found.size() << " objects, walking the address space found " << reference.size() <<
+            (same ? " (but something should have been found)" : "");
+    return same && !reference.empty();
+}
+
+//! Every query must find what findAllByPattern finds walking the address space
+bool checkNodeQueries (AddressSpace::ASNodeManager* nm)
+{
+    using namespace AddressSpace;
+    bool ok = true;
+    {
+        std::vector<ASCrate*> crates;
+        findAllObjectsOfTypeInNodeManager(nm, crates);
+        ok = compare("findAllObjectsOfTypeInNodeManager<ASCrate>", crates, walk<ASCrate>(nm, ".*"), false) && ok;
+        std::vector<ASBoard*> boards;
+        findAllObjectsOfTypeInNodeManager(nm, boards);
+        ok = compare("findAllObjectsOfTypeInNodeManager<ASBoard>", boards, walk<ASBoard>(nm, ".*"), false) && ok;
+        std::vector<ASChannel*> channels;
+        findAllObjectsOfTypeInNodeManager(nm, channels);
+        ok = compare("findAllObjectsOfTypeInNodeManager<ASChannel>", channels, walk<ASChannel>(nm, ".*"), false) && ok;
+    }
+    {
+        std::vector<ASChannel*> channels;
+        findAllObjectsByPrefixInNodeManager(nm, "crate1.board2.", channels);
+        ok = compare("findAllObjectsByPrefixInNodeManager<ASChannel> crate1.board2.", channels, walk<ASChannel>(nm, "crate1\\.board2\\..*"), false) && ok;
+    }
+    {
+        std::vector<ASChannel*> channels;
+        findAllObjectsByGlobInNodeManager(nm, "crate*.board?.ch1", channels);
+        ok = compare("findAllObjectsByGlobInNodeManager<ASChannel> crate*.board?.ch1", channels, walk<ASChannel>(nm, "crate.*\\.board.\\.ch1"), false) && ok;
+    }
+    // an escaped literal, a word assertion (\< isn't a literal '<') and one with no literal beginning
+    const char* patterns[] = {"crate1\\.board2\\.ch1[0-9]", "\\<crate1\\.board2\\.ch0", ".*\\.ch[0-3]"};
+    for (const char* pattern : patterns)
+    {
+        std::vector<ASChannel*> indexed;
+        findAllIndexedObjectsByPatternInNodeManager(nm, pattern, indexed);
+        ok = compare(std::string("findAllIndexedObjectsByPatternInNodeManager<ASChannel> ") + pattern, indexed, walk<ASChannel>(nm, pattern), false) && ok;
+        std::vector<ASChannel*> walked;
+        findAllObjectsByPatternInNodeManager(nm, pattern, walked);
+        ok = compare(std::string("findAllObjectsByPatternInNodeManager<ASChannel> ") + pattern, walked, walk<ASChannel>(nm, pattern), true) && ok;
+    }
+    {
+        // objects which aren't in the index: Meta's, added straight through the SDK
+        std::vector<UaObject*> meta;
+        findAllObjectsByPatternInNodeManager(nm, "StandardMetaData.*", meta);
+        ok = compare("findAllObjectsByPatternInNodeManager<UaObject> StandardMetaData.*", meta, walk<UaObject>(nm, "StandardMetaData.*"), true) && ok;
+        std::vector<UaObject*> all;
+        findAllObjectsByPatternInNodeManager(nm, ".*", all);
+        ok = compare("findAllObjectsByPatternInNodeManager<UaObject> .*", all, walk<UaObject>(nm, ".*"), true) && ok;
+    }
+    return ok;
+}
+
+}
+
+QuasarServer::QuasarServer() : BaseQuasarServer()
+{
+
+}
+
+QuasarServer::~QuasarServer()
+{
+
+}
+
+void QuasarServer::mainLoop()
+{
+    // a failed check ends the server, and so the test
+    if (!checkNodeQueries(getNodeManager()))
+        throw std::runtime_error("node queries differ from walking the address space, see above");
+
+    printServerMsg("Press "+std::string(SHUTDOWN_SEQUENCE)+" to shutdown server");
+
+    // Wait for user command to terminate the server thread.
+
+    while(ShutDownFlag() == 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    printServerMsg(" Shutting down server");
+}
+
+void QuasarServer::initialize()
+{
+    LOG(Log::INF) << "Initializing Quasar server.";
+
+}
+
+void QuasarServer::shutdown()
+{
+	LOG(Log::INF) << "Shutting down Quasar server.";
+}
+
+void QuasarServer::initializeLogIt()
+{
+	BaseQuasarServer::initializeLogIt();
+    LOG(Log::INF) << "Logging initialized.";
+}
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+'''
+generate_config.py
+
+@author:     agent <agent@local>
+
+@copyright:  2026 CERN
+
+@license:
+Copyright (c) 2026, CERN.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted
+provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions
+   and the following disclaimer in the documentation and/or other materials provided with the
+   distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT  HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS  OR
+IMPLIED  WARRANTIES, INCLUDING, BUT NOT  LIMITED TO, THE IMPLIED WARRANTIES  OF  MERCHANTABILITY
+AND  FITNESS  FOR  A  PARTICULAR  PURPOSE  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,  SPECIAL, EXEMPLARY, OR  CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF  SUBSTITUTE GOODS OR  SERVICES; LOSS OF
+USE, DATA, OR PROFITS; OR BUSINESS  INTERRUPTION) HOWEVER CAUSED AND ON ANY  THEORY  OF  LIABILITY,
+WHETHER IN  CONTRACT, STRICT  LIABILITY,  OR  TORT (INCLUDING  NEGLIGENCE OR OTHERWISE)  ARISING IN
+ANY WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+@contact:    quasar-developers@cern.ch
+'''
+
+import argparse
+
+def channel_voltage(crate, board, channel):
+    return crate*10 + board + channel/1000
+
+def channel_current(crate, board, channel):
+    return (channel+1)/100
+
+def write_config(f, num_crates, num_boards, num_channels):
+    f.write('<?xml version="1.0" encoding="UTF-8"?>\n')
+    f.write('<configuration xmlns="http://cern.ch/quasar/Configuration" xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance" '
+            'xsi:schemaLocation="http://cern.ch/quasar/Configuration ../Configuration/Configuration.xsd ">\n')
+    for crate in range(num_crates):
+        f.write(f'  <Crate name="crate{crate}" slots="{num_boards}">\n')
+        for board in range(num_boards):
+            f.write(f'    <Board name="board{board}" slot="{board}">\n')
+            for channel in range(num_channels):
+                f.write(f'      <Channel name="ch{channel}" number="{channel}" '
+                        f'voltage="{channel_voltage(crate, board, channel)}" current="{channel_current(crate, board, channel)}"/>\n')
+            f.write('      <CalculatedVariable name="powerOfFirstChannel" value="$thisObjectAddress.ch0.voltage * $thisObjectAddress.ch0.current"/>\n')
+            f.write('    </Board>\n')
+        highest = ', '.join(f'$thisObjectAddress.board{board}.temperature' for board in range(min(num_boards, 4)))
+        f.write(f'    <CalculatedVariable name="highestBoardTemperature" value="max({highest})"/>\n')
+        f.write('  </Crate>\n')
+    f.write('</configuration>\n')
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--num_crates', type=int, default=20)
+    parser.add_argument('--num_boards', type=int, default=50)
+    parser.add_argument('--num_channels', type=int, default=128)
+    parser.add_argument('--output', default='config_large.xml')
+    args = parser.parse_args()
+    with open(args.output, 'w') as f:
+        write_config(f, args.num_crates, args.num_boards, args.num_channels)
+    num_channels = args.num_crates * args.num_boards * args.num_channels
+    # a channel is an object, two cache-variables and a property; a board and a crate a few more
+    num_nodes = 4*num_channels + args.num_crates*args.num_boards*4 + args.num_crates*4
+    print(f'Wrote {args.output}: {num_channels} channels, about {num_nodes} nodes')
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+'''
+startup_benchmark.py
+
+@author:     agent <agent@local>
+
+@copyright:  2026 CERN
+
+@license:
+Copyright (c) 2026, CERN.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted
+provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions
+   and the following disclaimer in the documentation and/or other materials provided with the
+   distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT  HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS  OR
+IMPLIED  WARRANTIES, INCLUDING, BUT NOT  LIMITED TO, THE IMPLIED WARRANTIES  OF  MERCHANTABILITY
+AND  FITNESS  FOR  A  PARTICULAR  PURPOSE  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,  SPECIAL, EXEMPLARY, OR  CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF  SUBSTITUTE GOODS OR  SERVICES; LOSS OF
+USE, DATA, OR PROFITS; OR BUSINESS  INTERRUPTION) HOWEVER CAUSED AND ON ANY  THEORY  OF  LIABILITY,
+WHETHER IN  CONTRACT, STRICT  LIABILITY,  OR  TORT (INCLUDING  NEGLIGENCE OR OTHERWISE)  ARISING IN
+ANY WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+@contact:    quasar-developers@cern.ch
+'''
+
+import argparse
+import os
+import random
+import subprocess
+import sys
+import time
+from colorama import Fore, Style
+from opcua import Client, ua
+
+def wait_for_server(endpoint, process, timeout):
+    """Returns a connected client as soon as the server accepts connections"""
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        if process.poll() is not None:
+            raise Exception(f'Server exited prematurely with return code {process.returncode}')
+        client = Client(endpoint)
+        try:
+            client.connect()
+            return client
+        except Exception:
+            time.sleep(0.05)
+    raise Exception(f'Server did not start within {timeout}s')
+
+def rss_mb(process, field):
+    """From /proc/<pid>/status (Linux only), in MB: VmHWM is the peak resident set size so far, VmRSS the current one"""
+    with open(f'/proc/{process.pid}/status') as status:
+        for line in status:
+            if line.startswith(field + ':'):
+                return int(line.split()[1]) / 1024
+    return float('nan')
+
+def sample_address_space(client, num_crates, num_boards, num_channels, num_samples):
+    """Browse names and values of a random (but for a given seed the same) sample of objects"""
+    rng = random.Random(1234)
+    sample = {}
+    crates = client.get_objects_node().get_children()
+    sample['crates'] = sorted(node.nodeid.to_string() for node in crates)
+    for _ in range(num_samples):
+        prefix = f'crate{rng.randrange(num_crates)}.board{rng.randrange(num_boards)}'
+        board = client.get_node(ua.NodeId.from_string(f'ns=2;s={prefix}'))
+        sample[prefix] = sorted(node.nodeid.to_string() for node in board.get_children())
+        sample[prefix + '.powerOfFirstChannel'] = client.get_node(
+            ua.NodeId.from_string(f'ns=2;s={prefix}.powerOfFirstChannel')).get_value()
+        channel = f'{prefix}.ch{rng.randrange(num_channels)}'
+        for variable in ['voltage', 'current']:
+            sample[f'{channel}.{variable}'] = client.get_node(ua.NodeId.from_string(f'ns=2;s={channel}.{variable}')).get_value()
+    return sample
+
+def terminate(process):
+    process.terminate()
+    try:
+        process.wait(timeout=30)
+    except subprocess.TimeoutExpired:
+        process.kill()
+        process.wait()
+
+def run_server(args, extra_args):
+    """Starts the server, returns the startup time, its peak and current RSS by then and a sample of its address space"""
+    start = time.time()
+    process = subprocess.Popen([args.server] + extra_args + [args.config],
+        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    try:
+        client = wait_for_server(args.endpoint, process, args.timeout)
+        startup = time.time() - start
+        peak_rss = rss_mb(process, 'VmHWM')
+        rss = rss_mb(process, 'VmRSS')
+        try:
+            sample = sample_address_space(client, args.num_crates, args.num_boards, args.num_channels, args.num_samples)
+        finally:
+            client.disconnect()
+    finally:
+        terminate(process)
+    return startup, peak_rss, rss, sample
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--server', default='./OpcUaServer')
+    parser.add_argument('--config', default='config_large.xml', help='see generate_config.py')
+    parser.add_argument('--endpoint', default='opc.tcp://127.0.0.1:4841')
+    parser.add_argument('--threads', default='2,4,8', help='comma-separated numbers of configuration threads to try after the sequential run')
+    parser.add_argument('--config_cache', default='config_large.cache',
+        help='configuration cache to try, written by a first start and used by a second one (empty: skip)')
+    parser.add_argument('--num_crates', type=int, default=20)
+    parser.add_argument('--num_boards', type=int, default=50)
+    parser.add_argument('--num_channels', type=int, default=128)
+    parser.add_argument('--num_samples', type=int, default=50)
+    parser.add_argument('--timeout', type=float, default=1200)
+    args = parser.parse_args()
+
+    # the first run, the reference for the others, builds the address space sequentially
+    runs = [('sequential', [])] + [(f'configuration_threads={threads}', ['--configuration_threads', str(threads)])
+        for threads in [int(x) for x in args.threads.split(',')]]
+    if args.config_cache:
+        if os.path.exists(args.config_cache):
+            os.remove(args.config_cache)
+        runs.append(('config_cache (written)', ['--config_cache', args.config_cache]))
+        runs.append(('config_cache (used)', ['--config_cache', args.config_cache]))
+
+    results = []
+    reference = None
+    failed = False
+    for name, extra_args in runs:
+        startup, peak_rss, rss, sample = run_server(args, extra_args)
+        if reference is None:
+            reference = sample
+        elif sample != reference:
+            failed = True
+            different = [key for key in reference if reference[key] != sample.get(key)]
+            print(f'{Fore.RED}Address space built with {name} differs, e.g. at: {different[:5]}{Style.RESET_ALL}')
+        results.append((name, startup, peak_rss, rss))
+        print(f'{name}: server up after {startup:.2f}s, peak RSS {peak_rss:.0f} MB, RSS when up {rss:.0f} MB')
+
+    print(f'{"run":>24} {"startup [s]":>12} {"speedup":>8} {"peak RSS [MB]":>14} {"vs sequential":>14} {"RSS when up [MB]":>17}')
+    for name, startup, peak_rss, rss in results:
+        print(f'{name:>24} {startup:>12.2f} {results[0][1]/startup:>8.2f} {peak_rss:>14.0f} {peak_rss/results[0][2]:>14.2f} {rss:>17.0f}')
+    if failed:
+        sys.exit(1)
+    print(f'{Fore.GREEN}Address space sample identical for all runs{Style.RESET_ALL}')
+
+if __name__ == "__main__":
+    main()
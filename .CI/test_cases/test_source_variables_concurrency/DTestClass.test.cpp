@@ -0,0 +1,137 @@
+/*  © Copyright CERN, 2015. All rights not expressly granted are reserved.
+
+    The stub of this file was generated by quasar (https://github.com/quasar-team/quasar/)
+
+    Quasar is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public Licence as published by
+    the Free Software Foundation, either version 3 of the Licence.
+    Quasar is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public Licence for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+
+
+ */
+
+
+#include <thread>
+#include <chrono>
+
+#include <Configuration.hxx> // TODO; should go away, is already in Base class for ages
+
+#include <DTestClass.h>
+#include <ASTestClass.h>
+#include <LogIt.h>
+
+namespace Device
+{
+// 1111111111111111111111111111111111111111111111111111111111111111111111111
+// 1     GENERATED CODE STARTS HERE AND FINISHES AT SECTION 2              1
+// 1     Users don't modify this code!!!!                                  1
+// 1     If you modify this code you may start a fire or a flood somewhere,1
+// 1     and some human being may possible cease to exist. You don't want  1
+// 1     to be charged with that!                                          1
+// 1111111111111111111111111111111111111111111111111111111111111111111111111
+
+
+
+
+
+
+// 2222222222222222222222222222222222222222222222222222222222222222222222222
+// 2     SEMI CUSTOM CODE STARTS HERE AND FINISHES AT SECTION 3            2
+// 2     (code for which only stubs were generated automatically)          2
+// 2     You should add the implementation but dont alter the headers      2
+// 2     (apart from constructor, in which you should complete initializati2
+// 2     on list)                                                          2
+// 2222222222222222222222222222222222222222222222222222222222222222222222222
+
+/* The value of every variable is derived from the "expected" config entry of its object, so the client can tell
+   whether a reply was routed to the right request. The asynchronous handlers sleep a bit to keep many requests
+   from many sessions in flight at the same time. */
+
+/* sample ctr */
+DTestClass::DTestClass (
+    const Configuration::TestClass& config,
+    Parent_DTestClass* parent
+):
+    Base_DTestClass( config, parent)
+
+    /* fill up constructor initialization list here */
+    ,m_numReadManyCalls(0)
+    ,m_numCachedVariableReads(0)
+{
+    /* fill up constructor body here */
+}
+
+/* sample dtr */
+DTestClass::~DTestClass ()
+{
+    LOG(Log::INF) << getFullName() << ": readMany was called " << m_numReadManyCalls << " times, " <<
+        "asynchronous_cached was read from the device " << m_numCachedVariableReads << " times";
+}
+
+/* delegates for cachevariables */
+
+/* ASYNCHRONOUS !! */
+UaStatus DTestClass::readAsynchronous_no_mutex (
+    OpcUa_UInt32& value,
+    UaDateTime& sourceTime
+)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+    value = expected() + 1;
+    sourceTime = UaDateTime::now();
+    return OpcUa_Good;
+}
+/* ASYNCHRONOUS !! */
+UaStatus DTestClass::readAsynchronous_mutex_containing_object (
+    OpcUa_UInt32& value,
+    UaDateTime& sourceTime
+)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+    value = expected() + 2;
+    sourceTime = UaDateTime::now();
+    return OpcUa_Good;
+}
+/* ASYNCHRONOUS !! */
+UaStatus DTestClass::readAsynchronous_cached (
+    OpcUa_UInt32& value,
+    UaDateTime& sourceTime
+)
+{
+    m_numCachedVariableReads++;
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+    value = expected() + 4;
+    sourceTime = UaDateTime::now();
+    return OpcUa_Good;
+}
+/* SYNCHRONOUS !! */
+UaStatus DTestClass::readSynchronous_no_mutex (
+    OpcUa_UInt32& value,
+    UaDateTime& sourceTime
+)
+{
+    value = expected() + 3;
+    sourceTime = UaDateTime::now();
+    return OpcUa_Good;
+}
+
+/* delegators for methods */
+
+// 3333333333333333333333333333333333333333333333333333333333333333333333333
+// 3     FULLY CUSTOM CODE STARTS HERE                                     3
+// 3     Below you put bodies for custom methods defined for this class.   3
+// 3     You can do whatever you want, but please be decent.               3
+// 3333333333333333333333333333333333333333333333333333333333333333333333333
+
+void DTestClass::readMany (const std::vector<SourceVariableId>& variables)
+{
+    m_numReadManyCalls++;
+}
+
+}
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+'''
+monitored_items.py
+
+@author:     agent <agent@local>
+
+@copyright:  2026 CERN
+
+@license:
+Copyright (c) 2026, CERN.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted
+provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions
+   and the following disclaimer in the documentation and/or other materials provided with the
+   distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT  HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS  OR
+IMPLIED  WARRANTIES, INCLUDING, BUT NOT  LIMITED TO, THE IMPLIED WARRANTIES  OF  MERCHANTABILITY
+AND  FITNESS  FOR  A  PARTICULAR  PURPOSE  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,  SPECIAL, EXEMPLARY, OR  CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF  SUBSTITUTE GOODS OR  SERVICES; LOSS OF
+USE, DATA, OR PROFITS; OR BUSINESS  INTERRUPTION) HOWEVER CAUSED AND ON ANY  THEORY  OF  LIABILITY,
+WHETHER IN  CONTRACT, STRICT  LIABILITY,  OR  TORT (INCLUDING  NEGLIGENCE OR OTHERWISE)  ARISING IN
+ANY WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+@contact:    quasar-developers@cern.ch
+'''
+
+import argparse
+import sys
+import threading
+import time
+from colorama import Fore, Style
+from opcua import Client, ua
+
+from multi_session_stress import VARIABLE_OFFSETS
+
+class Handler:
+    def __init__(self):
+        self.values = {}
+        self.lock = threading.Lock()
+
+    def datachange_notification(self, node, value, data):
+        with self.lock:
+            self.values.setdefault(node.nodeid.to_string(), []).append(value)
+
+def session(endpoint, num_objects, sampling_interval, timeout, failures, lock):
+    try:
+        client = Client(endpoint)
+        client.connect()
+        try:
+            handler = Handler()
+            # python-opcua requests the publishing interval as the sampling interval of the items
+            subscription = client.create_subscription(sampling_interval, handler)
+            expected = {}
+            nodes = []
+            for i in range(1, num_objects+1):
+                for variable, offset in VARIABLE_OFFSETS.items():
+                    node_id = f'ns=2;s=tc{i}.{variable}'
+                    expected[node_id] = 1000*i + offset
+                    nodes.append(client.get_node(node_id))
+            handles = subscription.subscribe_data_change(nodes)
+            for node, handle in zip(nodes, handles):
+                if isinstance(handle, ua.StatusCode):
+                    with lock:
+                        failures.append(f'{node.nodeid.to_string()}: creating monitored item failed: {handle.name}')
+            deadline = time.time() + timeout
+            while time.time() < deadline and len(handler.values) < len(expected):
+                time.sleep(0.1)
+            for node_id, expected_value in expected.items():
+                with handler.lock:
+                    got = handler.values.get(node_id)
+                if not got or any(value != expected_value for value in got):
+                    with lock:
+                        failures.append(f'{node_id}: expected {expected_value}, got {got}')
+            subscription.delete()
+        finally:
+            client.disconnect()
+    except Exception as e:
+        # an exception would only end this thread, the test must fail
+        with lock:
+            failures.append(f'session failed: {type(e).__name__}: {e}')
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--endpoint', default='opc.tcp://127.0.0.1:4841')
+    parser.add_argument('--num_objects', type=int, default=50)
+    parser.add_argument('--num_sessions', type=int, default=8)
+    parser.add_argument('--sampling_interval', type=float, default=250)
+    parser.add_argument('--timeout', type=float, default=10)
+    args = parser.parse_args()
+
+    failures = []
+    lock = threading.Lock()
+    threads = [threading.Thread(target=session, args=(args.endpoint, args.num_objects, args.sampling_interval, args.timeout, failures, lock))
+        for _ in range(args.num_sessions)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    if failures:
+        print(f'{Fore.RED}{len(failures)} monitored items failed{Style.RESET_ALL}, first few:')
+        for failure in failures[:20]:
+            print(failure)
+        sys.exit(1)
+    print(f'{Fore.GREEN}All monitored items of {args.num_sessions} concurrent sessions delivered correct values{Style.RESET_ALL}')
+
+if __name__ == "__main__":
+    main()
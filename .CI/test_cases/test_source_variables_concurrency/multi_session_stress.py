@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+'''
+multi_session_stress.py
+
+@author:     agent <agent@local>
+
+@copyright:  2026 CERN
+
+@license:
+Copyright (c) 2026, CERN.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted
+provided that the following conditions are met:
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions
+   and the following disclaimer in the documentation and/or other materials provided with the
+   distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT  HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS  OR
+IMPLIED  WARRANTIES, INCLUDING, BUT NOT  LIMITED TO, THE IMPLIED WARRANTIES  OF  MERCHANTABILITY
+AND  FITNESS  FOR  A  PARTICULAR  PURPOSE  ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,  SPECIAL, EXEMPLARY, OR  CONSEQUENTIAL
+DAMAGES (INCLUDING, BUT  NOT LIMITED TO,  PROCUREMENT OF  SUBSTITUTE GOODS OR  SERVICES; LOSS OF
+USE, DATA, OR PROFITS; OR BUSINESS  INTERRUPTION) HOWEVER CAUSED AND ON ANY  THEORY  OF  LIABILITY,
+WHETHER IN  CONTRACT, STRICT  LIABILITY,  OR  TORT (INCLUDING  NEGLIGENCE OR OTHERWISE)  ARISING IN
+ANY WAY OUT OF  THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+@contact:    quasar-developers@cern.ch
+'''
+
+import argparse
+import random
+import sys
+import threading
+from colorama import Fore, Style
+from opcua import Client, ua
+
+# see config.xml: objects tc1..tcN with expected=1000*i, and DTestClass.test.cpp: each variable adds its own offset
+VARIABLE_OFFSETS = {
+    'asynchronous_no_mutex' : 1,
+    'asynchronous_mutex_containing_object' : 2,
+    'synchronous_no_mutex' : 3,
+    'asynchronous_cached' : 4}
+
+def make_items(num_objects):
+    items = []
+    for i in range(1, num_objects+1):
+        for variable, offset in VARIABLE_OFFSETS.items():
+            items.append((ua.NodeId.from_string(f'ns=2;s=tc{i}.{variable}'), 1000*i + offset))
+    return items
+
+def session(endpoint, items, num_iterations, failures, lock):
+    try:
+        client = Client(endpoint)
+        client.connect()
+        try:
+            for iteration in range(num_iterations):
+                # every session uses its own order, so the same variable gets different callback handles in different sessions
+                random.shuffle(items)
+                params = ua.ReadParameters()
+                for node_id, _ in items:
+                    read_value_id = ua.ReadValueId()
+                    read_value_id.NodeId = node_id
+                    read_value_id.AttributeId = ua.AttributeIds.Value
+                    params.NodesToRead.append(read_value_id)
+                results = client.uaclient.read(params)
+                for (node_id, expected), result in zip(items, results):
+                    if not result.StatusCode.is_good() or result.Value.Value != expected:
+                        with lock:
+                            failures.append(f'{node_id.to_string()}: expected {expected}, got {result.Value.Value} ({result.StatusCode.name})')
+        finally:
+            client.disconnect()
+    except Exception as e:
+        # an exception would only end this thread, the test must fail
+        with lock:
+            failures.append(f'session failed: {type(e).__name__}: {e}')
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--endpoint', default='opc.tcp://127.0.0.1:4841')
+    parser.add_argument('--num_objects', type=int, default=50)
+    parser.add_argument('--num_sessions', type=int, default=16)
+    parser.add_argument('--num_iterations', type=int, default=100)
+    args = parser.parse_args()
+
+    failures = []
+    lock = threading.Lock()
+    threads = [threading.Thread(target=session, args=(args.endpoint, make_items(args.num_objects), args.num_iterations, failures, lock))
+        for _ in range(args.num_sessions)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    num_reads = args.num_sessions * args.num_iterations * args.num_objects * len(VARIABLE_OFFSETS)
+    if failures:
+        print(f'{Fore.RED}{len(failures)} out of {num_reads} reads failed{Style.RESET_ALL}, first few:')
+        for failure in failures[:20]:
+            print(failure)
+        sys.exit(1)
+    print(f'{Fore.GREEN}All {num_reads} reads from {args.num_sessions} concurrent sessions returned correct values{Style.RESET_ALL}')
+
+if __name__ == "__main__":
+    main()
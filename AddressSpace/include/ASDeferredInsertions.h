@@ -0,0 +1,81 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * ASDeferredInsertions.h
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADDRESSSPACE_INCLUDE_ASDEFERREDINSERTIONS_H_
+#define ADDRESSSPACE_INCLUDE_ASDEFERREDINSERTIONS_H_
+
+#include <vector>
+#include <cstddef>
+#include <functional>
+
+namespace AddressSpace
+{
+
+/* Insertions of nodes into the ASNodeManager, recorded instead of performed, so that independent parts of the
+ * address space can be built concurrently (see the parallel mode of the Configurator).
+ *
+ * While a thread has a Scope open, ASNodeManager::addNodeAndReferenceThrows() and addUnreferencedNode() called
+ * by that thread only record what they would do, and so does runOrDefer() with any other action which has to
+ * happen in the same order as the insertions (e.g. instantiating a CalculatedVariable, which needs the nodes it
+ * reads to be there). replay() then performs everything that was recorded, in the recorded order. */
+class DeferredInsertions
+{
+public:
+    DeferredInsertions() {}
+    DeferredInsertions(const DeferredInsertions&) = delete;
+    DeferredInsertions& operator=(const DeferredInsertions&) = delete;
+
+    //! Makes the calling thread record into the given DeferredInsertions until the end of the scope.
+    class Scope
+    {
+    public:
+        explicit Scope(DeferredInsertions& insertions);
+        ~Scope();
+    private:
+        DeferredInsertions* m_previous;
+    };
+
+    //! Whether the calling thread is recording.
+    static bool isDeferring() { return s_current != nullptr; }
+
+    //! Runs the action right away, or, if the calling thread is recording, records it.
+    static void runOrDefer(std::function<void()> action);
+
+    //! Performs the recorded actions in the recorded order, from a thread which isn't recording. An exception stops it.
+    void replay();
+
+    std::size_t size() const { return m_actions.size(); }
+
+private:
+    std::vector<std::function<void()>> m_actions;
+
+    static thread_local DeferredInsertions* s_current;
+};
+
+/* Runs the jobs in up to numThreads threads, each job recording into its own DeferredInsertions, then replays
+ * the recordings in the order of the jobs, from the calling thread - so the address space ends up as if the jobs
+ * were run one after another. If a job throws, the recordings of the jobs before it are replayed and the
+ * exception is rethrown. */
+void buildConcurrently(const std::vector<std::function<void()>>& jobs, unsigned int numThreads);
+
+}
+
+#endif /* ADDRESSSPACE_INCLUDE_ASDEFERREDINSERTIONS_H_ */
@@ -0,0 +1,200 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * ASNodeIndex.h
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADDRESSSPACE_INCLUDE_ASNODEINDEX_H_
+#define ADDRESSSPACE_INCLUDE_ASNODEINDEX_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <algorithm>
+#include <typeindex>
+#include <typeinfo>
+#include <cstring>
+#include <cstddef>
+
+namespace AddressSpace
+{
+
+/* How NodeIndex gets the string identifier of a node: specialize with
+ *   static bool stringId (Node* node, std::string& id); // false if the node isn't identified by a string
+ * (see ASNodeManager.h for UaNode). */
+template<typename Node>
+struct NodeIndexTraits;
+
+/* Nodes of an address space, indexed as they get added - so that finding nodes doesn't take walking the whole
+ * address space and matching every node.
+ *
+ * By type: nodes are kept per dynamic type, in the order they were added. All nodes of a type are of the same
+ * node class and pass the same dynamic_cast, so a query for a type checks one node of every type known and then
+ * takes the matching ones as they are.
+ * By string identifier: a sorted list of the identifiers, for prefix queries. It's built on the first such query
+ * (a server which never asks pays nothing for it) and merged with the nodes added since on the following ones.
+ *
+ * Nodes are never removed: the address space only grows until the server goes. Thread-safe; the visitors run
+ * under the lock of the index and mustn't add nodes. */
+template<typename Node, typename Traits = NodeIndexTraits<Node>>
+class NodeIndex
+{
+public:
+    NodeIndex(): m_numNodesById(0) {}
+    NodeIndex(const NodeIndex&) = delete;
+    NodeIndex& operator=(const NodeIndex&) = delete;
+
+    void add (Node* node)
+    {
+        std::lock_guard<std::mutex> lock (m_lock);
+        std::vector<Node*>& ofType = m_byType[std::type_index(typeid(*node))];
+        if (ofType.empty())
+            m_types.push_back(&ofType);
+        ofType.push_back(node);
+        m_nodes.push_back(node);
+    }
+
+    //! visit(Node* anyOfThem, const std::vector<Node*>& nodes) for the nodes of every type, types in the order they first came
+    template<typename Visit>
+    void forEachType (Visit visit) const
+    {
+        std::lock_guard<std::mutex> lock (m_lock);
+        for (const std::vector<Node*>* ofType : m_types)
+            visit(ofType->front(), *ofType);
+    }
+
+    //! visit(const std::string& id, Node* node) for the nodes whose string identifier starts with prefix, in the order of identifiers
+    template<typename Visit>
+    void forEachWithPrefix (const std::string& prefix, Visit visit) const
+    {
+        std::lock_guard<std::mutex> lock (m_lock);
+        updateById();
+        typename ById::const_iterator it = std::lower_bound(m_byId.begin(), m_byId.end(), prefix,
+                [](const typename ById::value_type& entry, const std::string& key){ return entry.first < key; });
+        for (; it != m_byId.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+            visit(it->first, it->second);
+    }
+
+    std::size_t size () const
+    {
+        std::lock_guard<std::mutex> lock (m_lock);
+        return m_nodes.size();
+    }
+
+private:
+    typedef std::vector<std::pair<std::string, Node*>> ById;
+
+    void updateById () const
+    {
+        if (m_numNodesById == m_nodes.size())
+            return;
+        const std::size_t numSorted = m_byId.size();
+        std::string id;
+        for (; m_numNodesById < m_nodes.size(); ++m_numNodesById)
+            if (Traits::stringId(m_nodes[m_numNodesById], id))
+                m_byId.push_back(std::make_pair(id, m_nodes[m_numNodesById]));
+        std::sort(m_byId.begin() + numSorted, m_byId.end());
+        std::inplace_merge(m_byId.begin(), m_byId.begin() + numSorted, m_byId.end());
+    }
+
+    mutable std::mutex m_lock;
+    std::map<std::type_index, std::vector<Node*>> m_byType;
+    std::vector<const std::vector<Node*>*> m_types; //!< of m_byType, in the order they came
+    std::vector<Node*> m_nodes; //!< all, in the order they came
+
+    mutable ById m_byId;
+    mutable std::size_t m_numNodesById; //!< the first m_numNodesById of m_nodes are in m_byId (if identified by a string)
+};
+
+/* The characters every string matching the (xpressive, ECMAScript-like) regular expression starts with - so that
+ * only nodes with that prefix need matching. Conservative: stops at anything which isn't plainly a literal. */
+inline std::string regexLiteralPrefix (const std::string& pattern)
+{
+    if (pattern.find('|') != std::string::npos)
+        return ""; // alternatives may start differently
+    std::string prefix;
+    std::size_t i = 0;
+    while (i < pattern.size())
+    {
+        char c = pattern[i];
+        std::size_t next = i + 1;
+        if (c == '\\')
+        {
+            // an escaped special character is itself; anything else isn't a literal: \d, \w, \Q..., but also
+            // punctuation with a meaning of its own, e.g. the word assertions \< and \>
+            if (next == pattern.size() || pattern[next] == '\0' || !std::strchr("^$.|?*+()[]{}\\/-", pattern[next]))
+                break;
+            c = pattern[next++];
+        }
+        else if (std::strchr("^$.|?*+()[]{}", c))
+            break;
+        if (next < pattern.size() && std::strchr("?*{", pattern[next]))
+            break; // optional or repeated, it may not be there
+        prefix.push_back(c);
+        if (next < pattern.size() && pattern[next] == '+')
+            break;
+        i = next;
+    }
+    return prefix;
+}
+
+//! Glob: '*' matches any (also empty) sequence of characters, '?' any one character, everything else itself
+inline bool globMatch (const char* glob, std::size_t globLength, const char* text, std::size_t textLength)
+{
+    std::size_t g = 0, t = 0;
+    std::size_t starG = std::string::npos, starT = 0;
+    while (t < textLength)
+    {
+        if (g < globLength && glob[g] == '*')
+        {
+            starG = g++;
+            starT = t;
+        }
+        else if (g < globLength && (glob[g] == '?' || glob[g] == text[t]))
+        {
+            g++;
+            t++;
+        }
+        else if (starG != std::string::npos)
+        {
+            g = starG + 1; // let the last star take one more character
+            t = ++starT;
+        }
+        else
+            return false;
+    }
+    while (g < globLength && glob[g] == '*')
+        g++;
+    return g == globLength;
+}
+
+inline bool globMatch (const std::string& glob, const std::string& text)
+{
+    return globMatch(glob.data(), glob.size(), text.data(), text.size());
+}
+
+inline std::string globLiteralPrefix (const std::string& glob)
+{
+    return glob.substr(0, glob.find_first_of("*?"));
+}
+
+}
+
+#endif /* ADDRESSSPACE_INCLUDE_ASNODEINDEX_H_ */
@@ -0,0 +1,103 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * ASNodeIndexQueries.h
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ADDRESSSPACE_INCLUDE_ASNODEINDEXQUERIES_H_
+#define ADDRESSSPACE_INCLUDE_ASNODEINDEXQUERIES_H_
+
+#include <ASNodeIndex.h>
+#include <boost/xpressive/xpressive.hpp>
+
+#include <string>
+#include <vector>
+
+namespace AddressSpace
+{
+
+/* The object queries of a NodeIndex, for any kind of node: NodeIndexTraits must also give
+ *   static bool isObject (Node* node);
+ * ASNodeQueries.h has them for the node manager (find...InNodeManager); they live here, away from the
+ * OPC-UA toolkit, so that they can also be benchmarked on their own (benchmark_node_queries). */
+
+//! All objects of type T (or its descendants), in the order they were added
+template<typename T, typename Node, typename Traits>
+unsigned int findAllIndexedObjectsOfType (const NodeIndex<Node, Traits>& index, std::vector<T*>& storage)
+{
+    unsigned int numAdded = 0;
+    index.forEachType([&storage, &numAdded](Node* anyOfThem, const std::vector<Node*>& nodes)
+    {
+        if (!Traits::isObject(anyOfThem) || !dynamic_cast<T*>(anyOfThem))
+            return;
+        for (Node* node : nodes)
+            storage.push_back( dynamic_cast<T*>(node) );
+        numAdded += nodes.size();
+    });
+    return numAdded;
+}
+
+//! Objects of type T (or its descendants) whose string id starts with prefix and satisfies accept(id), in the order of ids
+template<typename T, typename Node, typename Traits, typename Accept>
+unsigned int findAllIndexedObjectsWithPrefix (const NodeIndex<Node, Traits>& index, const std::string& prefix, Accept accept, std::vector<T*>& storage)
+{
+    unsigned int numAdded = 0;
+    index.forEachWithPrefix(prefix, [&](const std::string& id, Node* node)
+    {
+        if (!accept(id))
+            return;
+        T* t = dynamic_cast<T*>(node);
+        if (t && Traits::isObject(node))
+        {
+            storage.push_back( t );
+            numAdded++;
+        }
+    });
+    return numAdded;
+}
+
+template<typename T, typename Node, typename Traits>
+unsigned int findAllIndexedObjectsByPrefix (const NodeIndex<Node, Traits>& index, const std::string& prefix, std::vector<T*>& storage)
+{
+    return findAllIndexedObjectsWithPrefix(index, prefix, [](const std::string&){ return true; }, storage);
+}
+
+//! Glob: '*' and '?', see globMatch()
+template<typename T, typename Node, typename Traits>
+unsigned int findAllIndexedObjectsByGlob (const NodeIndex<Node, Traits>& index, const std::string& glob, std::vector<T*>& storage)
+{
+    return findAllIndexedObjectsWithPrefix(index, globLiteralPrefix(glob),
+            [&glob](const std::string& id){ return globMatch(glob, id); }, storage);
+}
+
+/* The regular expression: ".*" is a query by type; otherwise only the ids starting with the literal beginning of
+ * the pattern are matched. Throws boost::xpressive::regex_error if the pattern is wrong. */
+template<typename T, typename Node, typename Traits>
+unsigned int findAllIndexedObjectsByPattern (const NodeIndex<Node, Traits>& index, const std::string& pattern, std::vector<T*>& storage)
+{
+    if (pattern == ".*")
+        return findAllIndexedObjectsOfType(index, storage);
+    const boost::xpressive::cregex expression = boost::xpressive::cregex::compile( pattern );
+    return findAllIndexedObjectsWithPrefix(index, regexLiteralPrefix(pattern),
+            [&expression](const std::string& id){ return boost::xpressive::regex_match( id.c_str(), id.c_str() + id.size(), expression ); },
+            storage);
+}
+
+}
+
+#endif /* ADDRESSSPACE_INCLUDE_ASNODEINDEXQUERIES_H_ */
@@ -28,11 +28,32 @@
 #include <nodemanagerbase.h>
 
 #include <ASUtils.h>
+#include <ASNodeIndex.h>
 
 namespace AddressSpace
 
 {
 
+    template<>
+    struct NodeIndexTraits<UaNode>
+    {
+        static bool stringId (UaNode* node, std::string& id)
+        {
+            UaNodeId nodeId = node->nodeId();
+            if (nodeId.identifierType() != OpcUa_IdentifierType_String)
+                return false;
+            id = UaString(nodeId.identifierString()).toUtf8();
+            return true;
+        }
+        static bool isObject (UaNode* node) { return node->nodeClass() == OpcUa_NodeClass_Object; }
+    };
+
+    typedef NodeIndex<UaNode> ASNodeIndex;
+
+#ifndef BACKEND_OPEN62541
+    class ASSourceVariableIoManager;
+#endif
+
     class ASNodeManager : public NodeManagerBase
     {
 
@@ -44,7 +65,8 @@ namespace AddressSpace
 
 	virtual ~ASNodeManager();
 
-  /* Wrapper on top of UA-SDK that throws when the call wasn't successful */
+  /* Wrapper on top of UA-SDK that throws when the call wasn't successful.
+   * When the calling thread defers insertions (see ASDeferredInsertions.h), it's only recorded. */
   UaStatus addNodeAndReferenceThrows(
     const UaNodeId&   parentNodeId,
     UaReferenceLists* pNewNode,
@@ -67,6 +89,9 @@ namespace AddressSpace
     UaObject * getInstanceDeclarationObjectType (OpcUa_UInt32 typeId);
 
     virtual IOManager* getIOManager(UaNode* pUaNode, OpcUa_Int32 attributeId) const;
+
+    //! Stops periodic sampling of source variables for monitored items; call before the source-variable threads go.
+    void stopSourceVariableSampling ();
 #endif
 
     UaNodeId makeChildNodeId (const UaNodeId &parent, const UaString& childName);
@@ -77,10 +102,19 @@ namespace AddressSpace
 	UaStatus addUnreferencedNode( UaNode* node );
 	const std::list<UaNode*>& getUnreferencedNodes () const { return m_unreferencedNodes; }
 
+	//! Nodes added by addNodeAndReferenceThrows() and addUnreferencedNode(): all objects and variables of the design's classes
+	const ASNodeIndex& getNodeIndex () const { return m_nodeIndex; }
+
   private:
     UaStatus createTypeNodes();
+    void indexNode( UaReferenceLists* newNode );
     std::function<UaStatus ()> m_afterStartUpDelegate;
 	std::list<UaNode*> m_unreferencedNodes;
+	ASNodeIndex m_nodeIndex;
+#ifndef BACKEND_OPEN62541
+	//! Shared by all source variables
+	ASSourceVariableIoManager* m_sourceVariableIoManager;
+#endif
   };
 
 
@@ -23,8 +23,14 @@
 #define __ASNODEQUERIES_H__
 
 #include <ASNodeManager.h>
+#include <ASNodeIndex.h>
+#include <ASNodeIndexQueries.h>
 #include <boost/xpressive/xpressive.hpp>
 
+#include <string>
+#include <vector>
+#include <utility>
+
 namespace AddressSpace
 {
 
@@ -44,58 +50,176 @@ namespace AddressSpace
 
 
 
-    template<typename T>
-        unsigned int findVariablesByRegex (UaNode* startNode, const boost::xpressive::sregex & expression, std::vector<T*> &storage)
+    /* The string identifier of a node id, as the bytes the id holds - without a copy (the open62541 backend
+     * gives it as a string, so there it's copied into a buffer kept for the next one). */
+    class StringIdentifier
     {
-        if (!startNode)
-            return 0;
-        UaNodeId id = startNode->nodeId();
-        if (startNode->nodeClass() == OpcUa_NodeClass_Variable)
+    public:
+        StringIdentifier(): m_begin(nullptr), m_end(nullptr) {}
+
+        //! Returns false if the id isn't a string one. The id must stay while begin()/end() are used.
+        bool of (const UaNodeId& id)
+        {
+            if (id.identifierType() != OpcUa_IdentifierType_String)
+                return false;
+#ifndef BACKEND_OPEN62541
+            const OpcUa_String* identifier = id.identifierString();
+            m_begin = OpcUa_String_GetRawString(identifier);
+            if (!m_begin)
+                m_begin = "";
+            m_end = m_begin + OpcUa_String_StrSize(identifier);
+#else // BACKEND_OPEN62541
+            m_buffer = UaString(id.identifierString()).toUtf8();
+            m_begin = m_buffer.data();
+            m_end = m_begin + m_buffer.size();
+#endif // BACKEND_OPEN62541
+            return true;
+        }
+
+        const char* begin () const { return m_begin; }
+        const char* end () const { return m_end; }
+
+    private:
+        const char* m_begin;
+        const char* m_end;
+#ifdef BACKEND_OPEN62541
+        std::string m_buffer;
+#endif // BACKEND_OPEN62541
+    };
+
+    enum class VisitResult
+    {
+        Continue,
+        SkipChildren, //!< don't go below this node
+        Stop
+    };
+
+    namespace Detail
+    {
+        //! The targets of the forward references of a node, one after another
+        class ChildCursor
         {
-            if (id.identifierType() == OpcUa_IdentifierType_String)
+#ifdef BACKEND_OPEN62541
+            typedef decltype(std::declval<UaNode*>()->referencedTargets()->begin()) TargetIterator;
+#endif // BACKEND_OPEN62541
+        public:
+            explicit ChildCursor (UaNode* node):
+#ifndef BACKEND_OPEN62541
+                m_next(const_cast<UaReference *>(node->getUaReferenceLists()->pTargetNodes()))
+            {}
+            bool atEnd () const { return !m_next; }
+            UaNode* next ()
             {
+                UaNode* target = m_next->pTargetNode();
+                m_next = m_next->pNextForwardReference();
+                return target;
+            }
+        private:
+            UaReference* m_next;
+#else // BACKEND_OPEN62541
+                m_it(node->referencedTargets()->begin()),
+                m_end(node->referencedTargets()->end())
+            {}
+            bool atEnd () const { return m_it == m_end; }
+            UaNode* next () { return (m_it++)->target; }
+        private:
+            TargetIterator m_it;
+            TargetIterator m_end;
+#endif // BACKEND_OPEN62541
+        };
 
-                std::string sId = UaString(id.identifierString()).toUtf8();
+        inline bool regexMatches (const StringIdentifier& id, const boost::xpressive::cregex & expression, std::string&)
+        {
+            return boost::xpressive::regex_match( id.begin(), id.end(), expression );
+        }
 
+        //! std::string regexes need a std::string: the buffer is reused from one node to the next
+        inline bool regexMatches (const StringIdentifier& id, const boost::xpressive::sregex & expression, std::string& buffer)
+        {
+            buffer.assign( id.begin(), id.end() );
+            return boost::xpressive::regex_match( buffer, expression );
+        }
 
-                boost::xpressive::smatch what;
-                if (boost::xpressive::regex_match( sId , what, expression ))
-                {
-                    std::cout << "name matched:" << sId << std::endl;
-                    T* t = dynamic_cast<T*>(startNode);
-                    if (t == startNode) /* this type itself or its descendant */
-                    {
-                        std::cout << "type also matched" << std::endl;
-                        storage.push_back( t );
-                        return 1;
-                    }
-                    else
-                        return 0; /* type mismatch */
-                }
-                else
-                    return 0; /* name mismatch */
+        inline boost::xpressive::cregex compilePattern (const std::string & pattern)
+        {
+            boost::xpressive::cregex expression;
+            try
+            {
+                expression = boost::xpressive::cregex::compile( pattern );
+            }
+            catch (boost::xpressive::regex_error &e)
+            {
+                ABORT_MESSAGE(CONCAT3(" REGEX Expression is wrong:",pattern,e.what()));
             }
-            else
-                return 0; /* strange identifier type */
+            return expression;
         }
-        else if (startNode->nodeClass() == OpcUa_NodeClass_Object)
+    }
+
+    /* Calls visitor(UaNode*) -> VisitResult for startNode and the nodes below it, depth-first, in the order of
+     * the references, going below objects only. Iterative: the depth of the address space (e.g. of recursive
+     * hasobjects) is limited by memory, not by the call stack. Returns false if the visitor stopped it. */
+    template<typename Visitor>
+        bool visitNodes (UaNode* startNode, Visitor visitor)
+    {
+        std::vector<Detail::ChildCursor> stack;
+        UaNode* node = startNode;
+        while (true)
         {
-#ifndef BACKEND_OPEN62541
-            unsigned int nMatched=0;
-            UaReference *pRefList = const_cast<UaReference *>(startNode->getUaReferenceLists()->pTargetNodes());
-            while (pRefList)
+            if (node)
             {
-                nMatched = nMatched + findVariablesByRegex( pRefList->pTargetNode(), expression, storage);
-                pRefList = pRefList->pNextForwardReference();
+                const VisitResult result = visitor(node);
+                if (result == VisitResult::Stop)
+                    return false;
+                if (result == VisitResult::Continue && node->nodeClass() == OpcUa_NodeClass_Object)
+                    stack.emplace_back(node);
             }
-            return nMatched;
-#else // BACKEND_OPEN62541
+            while (!stack.empty() && stack.back().atEnd())
+                stack.pop_back();
+            if (stack.empty())
+                return true;
+            node = stack.back().next();
+        }
+    }
 
-#endif // BACKEND_OPEN62541
-		
+    namespace Detail
+    {
+        template<typename T, typename Regex>
+            unsigned int findAllMatching (UaNode* startNode, OpcUa_NodeClass nodeClass, const Regex & expression, std::vector<T*> &storage)
+        {
+            unsigned int numAdded = 0;
+            StringIdentifier stringId;
+            std::string buffer;
+            visitNodes(startNode, [&](UaNode* node)
+            {
+                if (node->nodeClass() == nodeClass)
+                {
+                    const UaNodeId id = node->nodeId();
+                    if (stringId.of(id) && regexMatches(stringId, expression, buffer))
+                    {
+                        T* t = dynamic_cast<T*>(node);
+                        if (t) /* this type itself or its descendant */
+                        {
+                            storage.push_back( t );
+                            numAdded++;
+                        }
+                    }
+                }
+                return VisitResult::Continue;
+            });
+            return numAdded;
         }
-        else
-            return 0;
+    }
+
+    template<typename T>
+        unsigned int findVariablesByRegex (UaNode* startNode, const boost::xpressive::sregex & expression, std::vector<T*> &storage)
+    {
+        return Detail::findAllMatching<T> (startNode, OpcUa_NodeClass_Variable, expression, storage);
+    }
+
+    template<typename T>
+        unsigned int findVariablesByRegex (UaNode* startNode, const boost::xpressive::cregex & expression, std::vector<T*> &storage)
+    {
+        return Detail::findAllMatching<T> (startNode, OpcUa_NodeClass_Variable, expression, storage);
     }
 
     template<typename T>
@@ -103,127 +227,121 @@ namespace AddressSpace
     {
         if (!startNode)
             return 0;
-        boost::xpressive::sregex expression;
-        try
-        {
-            expression = boost::xpressive::sregex::compile( pattern );
-        }
-        catch (boost::xpressive::regex_error &e)
-        {
-            ABORT_MESSAGE(CONCAT3(" REGEX Expression is wrong:",pattern,e.what()));
-        }
-        return findVariablesByRegex<T> (startNode, expression, storage);
+        return findVariablesByRegex<T> (startNode, Detail::compilePattern(pattern), storage);
     }
 
     template<typename T>
         unsigned int findAllByRegex (const ASNodeManager *nm, UaNode* startNode, OpcUa_NodeClass nodeClass, const boost::xpressive::sregex & expression, std::vector<T*> &storage)
+    {
+        return Detail::findAllMatching<T> (startNode, nodeClass, expression, storage);
+    }
+
+    template<typename T>
+        unsigned int findAllByRegex (const ASNodeManager *nm, UaNode* startNode, OpcUa_NodeClass nodeClass, const boost::xpressive::cregex & expression, std::vector<T*> &storage)
+    {
+        return Detail::findAllMatching<T> (startNode, nodeClass, expression, storage);
+    }
+
+    template<typename T>
+        unsigned int findAllByPattern (const ASNodeManager *nm, UaNode* startNode, OpcUa_NodeClass nodeClass, const std::string & pattern, std::vector<T*> &storage)
     {
         if (!startNode)
             return 0;
+        return findAllByRegex<T> (nm, startNode, nodeClass, Detail::compilePattern(pattern), storage);
+    }
 
-        UaNodeId id = startNode->nodeId();
-        unsigned int numAdded=0;
-        if (startNode->nodeClass() == nodeClass)
+    //! The first node (in the order of visitNodes) of the class and type whose string id matches; 0 if none
+    template<typename T>
+        T* findFirstByPattern (UaNode* startNode, OpcUa_NodeClass nodeClass, const std::string & pattern)
+    {
+        if (!startNode)
+            return 0;
+        const boost::xpressive::cregex expression = Detail::compilePattern(pattern);
+        StringIdentifier stringId;
+        T* found = 0;
+        visitNodes(startNode, [&](UaNode* node)
         {
-            if (id.identifierType() == OpcUa_IdentifierType_String)
+            if (node->nodeClass() == nodeClass)
             {
-                std::string sId = UaString(id.identifierString()).toUtf8();
-                boost::xpressive::smatch what;
-                if (boost::xpressive::regex_match( sId , what, expression ))
+                const UaNodeId id = node->nodeId();
+                if (stringId.of(id) && boost::xpressive::regex_match( stringId.begin(), stringId.end(), expression ))
                 {
-                    //std::cout << "name matched:" << sId << std::endl;
-                    T* t = dynamic_cast<T*>(startNode);
-                    if (t == startNode) /* this type itself or its descendant */
-                    {
-                        //      std::cout << "type also matched" << std::endl;
-                        storage.push_back( t );
-                        numAdded++;
-                    }
-                    //else
-                    //  std::cout << "type didnt match:" << typeid(startNode).name() << std::endl;
+                    found = dynamic_cast<T*>(node);
+                    if (found)
+                        return VisitResult::Stop;
                 }
             }
-        }
-        if (startNode->nodeClass() == OpcUa_NodeClass_Object)
+            return VisitResult::Continue;
+        });
+        return found;
+    }
+
+    /* All objects of type T (or its descendants) whose string id matches the regular expression: those below the
+     * Objects folder, in the order of visitNodes, then the unreferenced ones. */
+    template<typename T>
+        unsigned int findAllObjectsByPatternInNodeManager (ASNodeManager *nm, const std::string & pattern, std::vector<T*> &storage)
+    {
+        const boost::xpressive::cregex expression = Detail::compilePattern(pattern);
+        unsigned int numAdded = findAllByRegex<T> (nm, nm->getNode(UaNodeId(OpcUaId_ObjectsFolder, 0)), OpcUa_NodeClass_Object, expression, storage);
+        StringIdentifier stringId;
+        for (UaNode* node : nm->getUnreferencedNodes())
         {
-            unsigned int nMatched=0;
-#ifdef BACKEND_OPEN62541
-    for(const UaNode::ReferencedTarget &target : *(startNode->referencedTargets()) )
-	{
-	  nMatched = nMatched + findAllByRegex(nm, target.target, nodeClass, expression, storage);
-	}
-#else // BACKEND_OPEN62541
-            UaReference *pRefList = const_cast<UaReference *>(startNode->getUaReferenceLists()->pTargetNodes());
-            while (pRefList)
+            if (node->nodeClass() != OpcUa_NodeClass_Object)
+                continue;
+            const UaNodeId id = node->nodeId();
+            if (stringId.of(id) && boost::xpressive::regex_match( stringId.begin(), stringId.end(), expression ))
             {
-                nMatched = nMatched + findAllByRegex(nm, pRefList->pTargetNode(), nodeClass, expression, storage);
-                pRefList = pRefList->pNextForwardReference();
+                T* t = dynamic_cast<T*>(node);
+                if (t) /* this type itself or its descendant */
+                {
+                    storage.push_back( t );
+                    numAdded++;
+                }
             }
-
-#endif // BACKEND_OPEN62541
-            return nMatched;
         }
-        else
-            return numAdded;
+        return numAdded;
     }
 
+    /* The queries below use the node index of the node manager (see ASNodeIndex.h) instead of walking the
+     * address space. They only see the nodes added through addNodeAndReferenceThrows() and addUnreferencedNode(),
+     * i.e. the objects of the design's classes, referenced or not - not e.g. those of Meta or anything added
+     * straight through the SDK; for those, use findAllObjectsByPatternInNodeManager(). */
+
+    //! All objects of type T (or its descendants), in the order they were added
     template<typename T>
-        unsigned int findAllByPattern (const ASNodeManager *nm, UaNode* startNode, OpcUa_NodeClass nodeClass, const std::string & pattern, std::vector<T*> &storage)
+        unsigned int findAllObjectsOfTypeInNodeManager (const ASNodeManager *nm, std::vector<T*> &storage)
     {
-        if (!startNode)
-            return 0;
-        boost::xpressive::sregex expression;
-        try
-        {
-            expression = boost::xpressive::sregex::compile( pattern );
-        }
-        catch (boost::xpressive::regex_error &e)
-        {
-            ABORT_MESSAGE(CONCAT3(" REGEX Expression is wrong:",pattern,e.what()));
-        }
-        return findAllByRegex<T> (nm, startNode, nodeClass, expression, storage);
+        return findAllIndexedObjectsOfType (nm->getNodeIndex(), storage);
     }
 
+    //! Objects of type T (or its descendants) whose string id starts with prefix, in the order of ids
     template<typename T>
-        unsigned int findAllObjectsByPatternInNodeManager (ASNodeManager *nm, const std::string & pattern, std::vector<T*> &storage)
+        unsigned int findAllObjectsByPrefixInNodeManager (const ASNodeManager *nm, const std::string & prefix, std::vector<T*> &storage)
+    {
+        return findAllIndexedObjectsByPrefix (nm->getNodeIndex(), prefix, storage);
+    }
+
+    //! Objects of type T (or its descendants) whose string id matches the glob ('*' and '?'), in the order of ids
+    template<typename T>
+        unsigned int findAllObjectsByGlobInNodeManager (const ASNodeManager *nm, const std::string & glob, std::vector<T*> &storage)
+    {
+        return findAllIndexedObjectsByGlob (nm->getNodeIndex(), glob, storage);
+    }
+
+    /* As findAllObjectsByPatternInNodeManager, from the index: ".*" is a query by type; otherwise only the ids
+     * starting with the literal beginning of the pattern are matched, in their order. */
+    template<typename T>
+        unsigned int findAllIndexedObjectsByPatternInNodeManager (const ASNodeManager *nm, const std::string & pattern, std::vector<T*> &storage)
     {
-        boost::xpressive::sregex expression;
         try
         {
-            expression = boost::xpressive::sregex::compile( pattern );
+            return findAllIndexedObjectsByPattern (nm->getNodeIndex(), pattern, storage);
         }
         catch (boost::xpressive::regex_error &e)
         {
             ABORT_MESSAGE(CONCAT3(" REGEX Expression is wrong:",pattern,e.what()));
         }
-        int numReferenced = findAllByRegex<T> (nm, nm->getNode(UaNodeId(OpcUaId_ObjectsFolder, 0)), OpcUa_NodeClass_Object, expression, storage);
-        int numUnreferenced = 0;
-        auto& unreferencedNodes = nm->getUnreferencedNodes();
-        for (auto it = unreferencedNodes.begin(); it!=unreferencedNodes.end(); it++)
-        {
-            UaNodeId id = (*it)->nodeId();
-            if ((*it)->nodeClass() == OpcUa_NodeClass_Object)
-            {
-                if (id.identifierType() == OpcUa_IdentifierType_String)
-                {
-                    std::string sId = UaString(id.identifierString()).toUtf8();
-                    boost::xpressive::smatch what;
-                    if (boost::xpressive::regex_match( sId , what, expression ))
-                    {
-                        //std::cout << "name matched:" << sId << std::endl;
-                        T* t = dynamic_cast<T*>((*it));
-                        if (t == *it) /* this type itself or its descendant */
-                        {
-                            //  std::cout << "type also matched" << std::endl;
-                            storage.push_back( t );
-                            numUnreferenced++;
-                        }
-                    }
-                }
-            }
-        }
-        return numReferenced + numUnreferenced;
-
+        return 0;
     }
 
 }
@@ -27,7 +27,9 @@
 #include <opcua_basedatavariabletype.h>
 #include <iomanager.h>
 #include <SourceVariables.h>
-#include <ASSourceVariableIoManager.h>
+#include <ASSourceVariableReadCache.h>
+
+#include <memory>
 
 namespace AddressSpace
 {
@@ -52,23 +54,25 @@ public:
 	        	OpcUa::BaseDataVariableType (nodeId, name, browseNameNameSpaceIndex, initialValue, accessLevel, pNodeConfig, pSharedMutex),
 	        	m_readOperationJobId(readJobId),
 	        	m_writeOperationJobId(writeJobId),
-	        	m_parentObjectNode(pParentObjectNode),
-	        	m_ioManager(new ASSourceVariableIoManager(m_readOperationJobId, m_writeOperationJobId, m_parentObjectNode) )
+	        	m_parentObjectNode(pParentObjectNode)
 	        {}
-	virtual ~ASSourceVariable ()
-	{
-		delete m_ioManager;
-	};
+	virtual ~ASSourceVariable () {};
 
-	IOManager* getIOManager () const { return m_ioManager; }
+	/* Note: I/O of all source variables goes through one IOManager owned by ASNodeManager (so that a client transaction
+	 * touching many source variables can be handled as a whole), which uses the getters below. */
+	ASSourceVariableJobId readOperationJobId () const { return m_readOperationJobId; }
+	ASSourceVariableJobId writeOperationJobId () const { return m_writeOperationJobId; }
+	const UaNode* parentObjectNode () const { return m_parentObjectNode; }
 
+	//! Called for source variables having cacheMaxAgeMs in the Design; must happen before the variable is used.
+	void enableReadCache (unsigned int maxAgeMs) { m_readCache.reset(new ASSourceVariableReadCache(maxAgeMs)); }
+	ASSourceVariableReadCache* readCache () const { return m_readCache.get(); }
 
 private:
 	ASSourceVariableJobId m_readOperationJobId;
 	ASSourceVariableJobId m_writeOperationJobId;
 	const UaNode* m_parentObjectNode;
-	ASSourceVariableIoManager *m_ioManager;
-
+	std::unique_ptr<ASSourceVariableReadCache> m_readCache;
 
 };
 
@@ -24,26 +24,36 @@
 
 #ifndef BACKEND_OPEN62541
 
+#include <vector>
+#include <memory>
+#include <mutex>
+
 #include <iomanager.h>
 #include <SourceVariables.h>
 
 namespace AddressSpace
 {
 
+class ASNodeManager;
+class ASSourceVariable;
+class ASSourceVariableSamplingEngine;
+
+/* One instance (owned by ASNodeManager) serves all source variables, so the SDK hands us all source-variable items
+ * of a client transaction at once. Asynchronous reads are collected and, at finishTransaction, grouped per object:
+ * each group of more than one read becomes a single thread-pool job (see SourceVariables_spawnIoJobReadMany).
+ * All state of a transaction lives in its Transaction context (hIOManagerContext) and the jobs get their own copies of
+ * the callback and handles, so any number of sessions may run transactions on the same variables concurrently.
+ * Transaction contexts are recycled, so that a transaction doesn't cost any allocation once the server is warm.
+ * Asynchronous reads of variables with a read cache (cacheMaxAgeMs in the Design) are first offered to the cache,
+ * see ASSourceVariableReadCache.
+ * Monitored items are served by periodic sampling, see ASSourceVariableSamplingEngine. */
 class ASSourceVariableIoManager: public IOManager
 
 {
 public:
 
-	ASSourceVariableIoManager (ASSourceVariableJobId readOp, ASSourceVariableJobId writeOp, const UaNode* variableParentNode):
-		m_readOperationJobId (readOp),
-		m_writeOperationJobId (writeOp),
-		m_variableParentNode (variableParentNode),
-		m_callback(0),
-		m_transaction(0),
-		m_callbackHandle(0)
-{}
-	virtual ~ASSourceVariableIoManager () {}
+	explicit ASSourceVariableIoManager (ASNodeManager* nodeManager);
+	virtual ~ASSourceVariableIoManager ();
 
     virtual UaStatus beginTransaction (
         IOManagerCallback*       pCallback,
@@ -60,27 +70,18 @@ public:
         OpcUa_UInt32        callbackHandle,
         IOVariableCallback* pIOVariableCallback,
         VariableHandle*     pVariableHandle,
-        MonitoringContext&  monitoringContext)
-    {
-    	return OpcUa_Bad;
-    }
+        MonitoringContext&  monitoringContext);
 
     virtual UaStatus beginModifyMonitoring(
         OpcUa_Handle        hIOManagerContext,
         OpcUa_UInt32        callbackHandle,
         OpcUa_UInt32        hIOVariable,
-        MonitoringContext&  monitoringContext)
-    {
-    	return OpcUa_Bad;
-    }
+        MonitoringContext&  monitoringContext);
 
     virtual UaStatus beginStopMonitoring(
         OpcUa_Handle        hIOManagerContext,
         OpcUa_UInt32        callbackHandle,
-        OpcUa_UInt32        hIOVariable)
-    {
-    	return OpcUa_Bad;
-    }
+        OpcUa_UInt32        hIOVariable);
 
     virtual UaStatus beginRead (
         OpcUa_Handle        hIOManagerContext,
@@ -97,13 +98,50 @@ public:
     virtual UaStatus finishTransaction (
         OpcUa_Handle        hIOManagerContext);
 
+    //! Stops sampling of monitored items; to be called before the source-variable thread pool is destroyed.
+    void stopSampling ();
+
+    struct DeferredRead
+    {
+        const UaNode*            parentObjectNode;
+        ASSourceVariableReadItem item;
+    };
+
+    /* The building blocks of beginRead and finishTransaction, shared with ASSourceVariableSamplingEngine.
+     * startRead either finishes the read right away, spawns it (synchronous reads) or appends it to deferredReads;
+     * spawnDeferredReads spawns the latter grouped per object. */
+    static UaStatus startRead (
+        ASSourceVariable*          variable,
+        IOManagerCallback*         callback,
+        OpcUa_UInt32               hTransaction,
+        OpcUa_UInt32               callbackHandle,
+        OpcUa_Double               maxAge,
+        std::vector<DeferredRead>& deferredReads);
+    static void spawnDeferredReads (
+        IOManagerCallback*         callback,
+        OpcUa_UInt32               hTransaction,
+        std::vector<DeferredRead>& reads);
+
 private:
-    ASSourceVariableJobId m_readOperationJobId;
-    ASSourceVariableJobId m_writeOperationJobId;
-    const UaNode * m_variableParentNode;
-	IOManagerCallback*  m_callback;
-	OpcUa_UInt32 m_transaction;
-	OpcUa_UInt32 m_callbackHandle;
+    //! Everything we know about one transaction; handed to the SDK as hIOManagerContext.
+    struct Transaction
+    {
+        IOManagerCallback*        callback;
+        OpcUa_UInt32              hTransaction;
+        OpcUa_Double              maxAge; // [ms], as requested by the client
+        std::vector<DeferredRead> deferredReads;
+    };
+
+    ASSourceVariable* sourceVariable (VariableHandle* variableHandle) const;
+
+    Transaction* acquireTransaction ();
+    void releaseTransaction (Transaction* transaction);
+
+    ASNodeManager* m_nodeManager;
+    std::unique_ptr<ASSourceVariableSamplingEngine> m_samplingEngine;
+
+    std::mutex m_freeTransactionsLock;
+    std::vector<Transaction*> m_freeTransactions; //!< finished ones, for the next transactions to reuse
 
 };
 
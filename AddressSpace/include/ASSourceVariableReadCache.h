@@ -0,0 +1,93 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * ASSourceVariableReadCache.h
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ASSOURCEVARIABLEREADCACHE_H_
+#define ASSOURCEVARIABLEREADCACHE_H_
+
+#ifndef BACKEND_OPEN62541
+
+#include <mutex>
+#include <chrono>
+#include <vector>
+
+#include <iomanager.h>
+#include <uadatavalue.h>
+
+namespace AddressSpace
+{
+
+/* Value cache of one asynchronous source variable (enabled with cacheMaxAgeMs in the Design).
+ * A read is served from memory if the last value obtained from the device is young enough; otherwise, if a device read
+ * of this variable is already in flight, the read just waits for its result. Only when neither is the case a new
+ * device read is needed, and whoever does it must report back through completeRead(). */
+class ASSourceVariableReadCache
+{
+public:
+	enum Outcome
+	{
+		SERVED,    //!< value was young enough and was copied to cachedValue; caller should finishRead() with it
+		COALESCED, //!< will be finished when the device read currently in flight completes; caller has nothing else to do
+		MUST_READ  //!< caller must read the device and call completeRead() afterwards
+	};
+
+	explicit ASSourceVariableReadCache (unsigned int maxAgeMs);
+
+	ASSourceVariableReadCache (const ASSourceVariableReadCache& other) = delete;
+	ASSourceVariableReadCache& operator= (const ASSourceVariableReadCache& other) = delete;
+
+	/* clientMaxAgeMs is the maxAge of the client's Read request; the stricter of it and the Design's limit applies.
+	 * (As per OPC-UA, maxAge=0 means the client wants a fresh value - such reads are still coalesced though.) */
+	Outcome beginRead (
+			double             clientMaxAgeMs,
+			IOManagerCallback* callback,
+			OpcUa_UInt32       hTransaction,
+			OpcUa_UInt32       callbackHandle,
+			UaDataValue&       cachedValue);
+
+	/* To be called exactly once after each MUST_READ outcome. Finishes all coalesced reads with the result.
+	 * storeInCache=false is meant for failures which didn't come from the device (e.g. the job couldn't be spawned). */
+	void completeRead (const UaDataValue& result, bool storeInCache);
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct PendingRead
+	{
+		IOManagerCallback* callback;
+		OpcUa_UInt32       hTransaction;
+		OpcUa_UInt32       callbackHandle;
+	};
+
+	const Clock::duration    m_maxAge;
+
+	std::mutex               m_lock;
+	bool                     m_hasValue;
+	UaDataValue              m_value;
+	Clock::time_point        m_valueObtainedAt;
+	bool                     m_readInFlight;
+	std::vector<PendingRead> m_pendingReads;
+};
+
+}
+
+#endif // BACKEND_OPEN62541
+
+#endif /* ASSOURCEVARIABLEREADCACHE_H_ */
@@ -0,0 +1,153 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * ASSourceVariableSamplingEngine.h
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ASSOURCEVARIABLESAMPLINGENGINE_H_
+#define ASSOURCEVARIABLESAMPLINGENGINE_H_
+
+#ifndef BACKEND_OPEN62541
+
+#include <map>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+
+#include <iomanager.h>
+
+namespace AddressSpace
+{
+
+class ASSourceVariable;
+
+/* Periodic sampling of source variables on behalf of monitored items.
+ *
+ * All monitored items of one source variable with the same (revised) sampling interval share one "sampled variable",
+ * which is read once per interval and whose result is fanned out to all of them. Sampled variables with the same
+ * interval form a bucket; buckets are kept in a hashed timer wheel with TICK_MS resolution, serviced by one thread.
+ * The reads themselves are spawned the same way as client reads are (so they are batched per object and go through
+ * the read cache, if any). A sampled variable whose previous read hasn't finished yet skips its turn. */
+class ASSourceVariableSamplingEngine: public IOManagerCallback
+{
+public:
+	static const unsigned int TICK_MS = 10;
+	static const unsigned int WHEEL_SIZE = 512;
+
+	ASSourceVariableSamplingEngine ();
+	virtual ~ASSourceVariableSamplingEngine ();
+
+	ASSourceVariableSamplingEngine (const ASSourceVariableSamplingEngine& other) = delete;
+	ASSourceVariableSamplingEngine& operator= (const ASSourceVariableSamplingEngine& other) = delete;
+
+	/* samplingInterval [ms] is revised in place (rounded up to a multiple of TICK_MS). */
+	UaStatus startMonitoring (ASSourceVariable* variable, IOVariableCallback* callback, OpcUa_Double& samplingInterval, OpcUa_UInt32& hIOVariable);
+	UaStatus modifyMonitoring (OpcUa_UInt32 hIOVariable, OpcUa_Double& samplingInterval);
+	/* Doesn't wait for a fan-out in flight (a fan-out calls dataChange() only of the items still subscribed), but
+	 * calls whenStopped - which lets the SDK drop the item's callback - only once no dataChange() of the item can
+	 * be running: right away, or at the end of that fan-out. Not called if the returned status isn't good. */
+	UaStatus stopMonitoring (OpcUa_UInt32 hIOVariable, const std::function<void()>& whenStopped);
+
+	//! Must be called before the source-variable thread pool goes away; monitoring requests are refused afterwards.
+	void stop ();
+
+	/* IOManagerCallback: results of our reads come here. */
+	virtual UaStatus finishRead (
+			OpcUa_UInt32  hTransaction,
+			OpcUa_UInt32  callbackHandle,
+			UaDataValue&  dataValue,
+			OpcUa_Boolean detach = OpcUa_False,
+			OpcUa_Boolean allowCopy = OpcUa_True);
+	virtual UaStatus finishWrite (OpcUa_UInt32, OpcUa_UInt32, const UaStatus&, OpcUa_Boolean = OpcUa_True) { return OpcUa_BadInvalidState; }
+	virtual UaStatus finishStartMonitoring (OpcUa_UInt32, OpcUa_UInt32, OpcUa_UInt32, OpcUa_Double, OpcUa_Boolean, UaDataValue&, const UaStatus&) { return OpcUa_BadInvalidState; }
+	virtual UaStatus finishModifyMonitoring (OpcUa_UInt32, OpcUa_UInt32, OpcUa_Double, const UaStatus&) { return OpcUa_BadInvalidState; }
+	virtual UaStatus finishStopMonitoring (OpcUa_UInt32, OpcUa_UInt32, const UaStatus&) { return OpcUa_BadInvalidState; }
+
+private:
+	struct Bucket;
+
+	struct SampledVariable
+	{
+		OpcUa_UInt32                     id; // the callbackHandle of its reads
+		ASSourceVariable*                variable;
+		Bucket*                          bucket;
+		std::vector<IOVariableCallback*> subscribers;
+		bool                             readInFlight; // from the read being spawned until its result got fanned out
+		unsigned int                     fanOutsInFlight; // finishRead calling subscribers, without m_lock
+		unsigned int                     references; // one while registered (in the maps below) plus one per fan-out in flight
+		std::vector<std::function<void()>> whenFannedOut; // of the items stopped during the fan-out in flight
+	};
+
+	struct Bucket
+	{
+		unsigned int                  intervalTicks;
+		unsigned int                  remainingRounds; // full wheel revolutions until due
+		std::vector<SampledVariable*> variables;
+	};
+
+	//! A read to be spawned; a copy, as the sampled variable may go away meanwhile.
+	struct Sample
+	{
+		OpcUa_UInt32      id;
+		ASSourceVariable* variable;
+		OpcUa_Double      maxAge;
+	};
+
+	struct MonitoredItem
+	{
+		SampledVariable*    sampledVariable;
+		IOVariableCallback* callback;
+	};
+
+	static unsigned int toIntervalTicks (OpcUa_Double samplingInterval);
+
+	// all these need m_lock held
+	SampledVariable* subscribe (ASSourceVariable* variable, unsigned int intervalTicks, IOVariableCallback* callback);
+	void unsubscribe (SampledVariable* sampledVariable, IOVariableCallback* callback);
+	//! Deletes the sampled variable with its last reference
+	static void release (SampledVariable* sampledVariable);
+	void schedule (Bucket* bucket, unsigned long long fromTick);
+	void collectDue (std::vector<Sample>& due);
+	void addSample (SampledVariable* sampledVariable, std::vector<Sample>& due);
+
+	void run ();
+	void sample (const std::vector<Sample>& due);
+
+	std::mutex m_lock;
+	std::condition_variable m_wakeUp;
+	std::thread m_thread;
+	bool m_quit;
+	bool m_stopped;
+
+	unsigned long long m_currentTick;
+	std::vector<std::vector<Bucket*>> m_wheel;
+	std::map<unsigned int, Bucket> m_buckets; // by intervalTicks
+	std::map<std::pair<ASSourceVariable*, unsigned int>, SampledVariable*> m_sampledVariables; // by (variable, intervalTicks)
+	std::map<OpcUa_UInt32, SampledVariable*> m_sampledVariablesById;
+	std::map<OpcUa_UInt32, MonitoredItem> m_monitoredItems; // by hIOVariable
+	std::vector<SampledVariable*> m_firstSamplePending; // sampled at the nearest tick, so that subscribers needn't wait
+	OpcUa_UInt32 m_nextId;
+};
+
+}
+
+#endif // BACKEND_OPEN62541
+
+#endif /* ASSOURCEVARIABLESAMPLINGENGINE_H_ */
@@ -50,6 +50,11 @@ namespace ArrayTools
 	void convertVectorToUaVariant( const std::vector <UaVariant>& input, UaVariant& output );
 	void convertVectorToUaVariant( const std::vector< UaByteString>& input, UaVariant& output );
 
+	/* These detach the elements from the input rather than copying them: after the call the input holds empty elements. */
+	void convertVectorToUaVariant( std::vector <UaString>&& input, UaVariant& output );
+	void convertVectorToUaVariant( std::vector <UaVariant>&& input, UaVariant& output );
+	void convertVectorToUaVariant( std::vector <UaByteString>&& input, UaVariant& output );
+
 	UaStatus convertUaVariantToBooleanVector( const UaVariant& input, std::vector <OpcUa_Boolean> &vect );
 	UaStatus convertUaVariantToByteVector( const UaVariant& input, std::vector <OpcUa_Byte> &vect );
 	UaStatus convertUaVariantToVector( const UaVariant& input, std::vector <OpcUa_SByte> &vect );
@@ -65,6 +70,26 @@ namespace ArrayTools
 	UaStatus convertUaVariantToVector( const UaVariant& input, std::vector <UaByteString>& vect );
 	UaStatus convertUaVariantToVector( const UaVariant& input, std::vector <UaVariant>& vect );
 
+#ifndef BACKEND_OPEN62541
+	/* These read the array in place from an OpcUa_Variant (e.g. the one held by a UaDataValue obtained from a node), without
+	 * copying it to a UaVariant and then to a UaXxxArray first; the storage of the output vector is reused.
+	 * They return OpcUa_BadTypeMismatch unless the input holds a one-dimensional array of exactly the given type. */
+	UaStatus copyOpcUaVariantToBooleanVector( const OpcUa_Variant& input, std::vector <OpcUa_Boolean>& output );
+	UaStatus copyOpcUaVariantToByteVector( const OpcUa_Variant& input, std::vector <OpcUa_Byte>& output );
+	UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_SByte>& output );
+	UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_Int16>& output );
+	UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_UInt16>& output );
+	UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_Int32>& output );
+	UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_UInt32>& output );
+	UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_Int64>& output );
+	UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_UInt64>& output );
+	UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_Float>& output );
+	UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_Double>& output );
+	UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <UaString>& output );
+	UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <UaByteString>& output );
+	UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <UaVariant>& output );
+#endif // BACKEND_OPEN62541
+
 	std::vector<UaString> convertStdStringsToUaStrings( const std::vector<std::string>& input );
 }
 
@@ -0,0 +1,60 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * ArrayToolsKernels.h
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ARRAYTOOLSKERNELS_H_
+#define ARRAYTOOLSKERNELS_H_
+
+#include <cstddef>
+
+namespace AddressSpace
+{
+
+namespace ArrayTools
+{
+
+/* Bulk element conversions used by ArrayTools for large arrays. Every kernel exists in a scalar version and, on x86 with GCC/clang,
+ * in SSE2 and AVX2 versions; the best one supported by the CPU is chosen at runtime, once.
+ * The kernels work on plain C++ types so that they don't depend on the OPC-UA backend. */
+struct KernelSet
+{
+    const char* name;
+
+    //! out[i] = in[i] ? 1 : 0 -- e.g. for OpcUa_Boolean (unsigned char in the UASDK), where any non-zero value means true.
+    void (*normalizeBooleans) (const unsigned char* in, unsigned char* out, size_t n);
+
+    //! Float -> Double, always exact.
+    void (*widenFloats) (const float* in, double* out, size_t n);
+
+    /** Double -> Float. Returns false (and leaves out partially written) if any finite input doesn't fit into a float.
+     * NaN and infinities are converted as they are. */
+    bool (*narrowDoubles) (const double* in, float* out, size_t n);
+};
+
+const KernelSet& scalarKernels ();
+
+//! The fastest kernels this CPU supports.
+const KernelSet& bestKernels ();
+
+}
+
+}
+
+#endif /* ARRAYTOOLSKERNELS_H_ */
@@ -24,7 +24,9 @@
 
 #include <opcua_basedatavariabletype.h>
 #include <functional>
-#include <list>
+#include <vector>
+#include <atomic>
+#include <mutex>
 
 namespace AddressSpace
 {
@@ -34,6 +36,7 @@ class ChangeNotifyingVariable: public OpcUa::BaseDataVariableType
 public:
 
     typedef std::function<void (ChangeNotifyingVariable& fromWhere, const UaDataValue& newValue)> OnChangeListener;
+    typedef unsigned int ListenerHandle;
 
     ChangeNotifyingVariable(
         const UaNodeId&    nodeId,
@@ -51,12 +54,59 @@ public:
         const UaDataValue& dataValue,
         OpcUa_Boolean checkAccessLevel);
 
-    virtual void addChangeListener (OnChangeListener onChangeListener);
-    virtual size_t changeListenerSize () const { return m_changeListeners.size(); }
-    virtual void removeAllChangeListeners () { m_changeListeners.clear(); }
+    /* The two halves of setValue(), for batched updates (see AS<Class>::Update): first set all values of a batch,
+     * then notify the listeners, so that they (e.g. calculated variables) see all the new values at once. */
+    UaStatus setValueWithoutNotifying(
+        Session* pSession,
+        const UaDataValue& dataValue,
+        OpcUa_Boolean checkAccessLevel);
+    void notifyChangeListeners (const UaDataValue& dataValue);
+
+    /* Listeners may be added and removed at any time, also concurrently with setValue().
+     * A listener removed while setValue() is running might still get called by that very setValue(). */
+    virtual ListenerHandle addChangeListener (OnChangeListener onChangeListener);
+    virtual bool removeChangeListener (ListenerHandle handle);
+    virtual size_t changeListenerSize () const;
+    virtual void removeAllChangeListeners ();
+
+    //! Bytes taken by the listener arrays, including replaced ones which weren't reclaimed yet. For statistics.
+    size_t listenersMemoryUsage ();
+    /** Frees the listener arrays replaced by adding or removing listeners, also those which a setValue() running
+     * concurrently may be using: only safe when none may be running, e.g. while the address space is being
+     * configured. (Otherwise they're freed as soon as no setValue() is notifying.) */
+    void reclaimRetiredListeners ();
 
 private:
-    std::list<OnChangeListener> m_changeListeners;
+    struct Listener
+    {
+        ListenerHandle   handle;
+        OnChangeListener onChange;
+    };
+    typedef std::vector<Listener> Listeners;
+
+    //! Replaces the published listeners; the caller must hold m_listenersWriteLock.
+    void publish (Listeners* listeners);
+    //! Frees the retired arrays no notification may be using anymore; the caller must hold m_listenersWriteLock.
+    void reclaimRetiredListenersNotInUse ();
+
+    struct Retired
+    {
+        const Listeners* listeners;
+        unsigned char    seenAtZero; //!< bit n: m_notificationsInFlight[n] was seen at 0 since it was retired
+    };
+
+    /* RCU-style: setValue() only loads the pointer and walks the (immutable) array, no locks.
+     * Writers copy, modify and publish a new array. Arrays which were replaced can't be freed while a setValue()
+     * may be walking them: notifications count themselves in and out of the counter of the current epoch (of two),
+     * and a retired array is freed once both counters were seen at zero - by the next writer, or by the last
+     * notification out of an epoch. So only the arrays retired during the notifications in flight are kept. */
+    std::atomic<const Listeners*> m_listeners;
+    std::atomic<unsigned int> m_epoch;
+    std::atomic<unsigned int> m_notificationsInFlight[2]; //!< by the parity of m_epoch
+    std::atomic<bool> m_hasRetiredListeners; //!< so that notifications don't take the write lock for nothing
+    std::mutex m_listenersWriteLock;
+    std::vector<Retired> m_retiredListeners;
+    ListenerHandle m_nextListenerHandle;
 };
 
 }
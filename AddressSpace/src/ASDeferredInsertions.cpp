@@ -0,0 +1,105 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * ASDeferredInsertions.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <exception>
+#include <algorithm>
+
+#include <ASDeferredInsertions.h>
+#include <Utils.h>
+
+namespace AddressSpace
+{
+
+thread_local DeferredInsertions* DeferredInsertions::s_current = nullptr;
+
+DeferredInsertions::Scope::Scope(DeferredInsertions& insertions):
+        m_previous(s_current)
+{
+    s_current = &insertions;
+}
+
+DeferredInsertions::Scope::~Scope()
+{
+    s_current = m_previous;
+}
+
+void DeferredInsertions::runOrDefer(std::function<void()> action)
+{
+    if (s_current)
+        s_current->m_actions.push_back(std::move(action));
+    else
+        action();
+}
+
+void DeferredInsertions::replay()
+{
+    if (s_current)
+        throw_runtime_error_with_origin("Can't replay deferred insertions from a thread which defers them");
+    std::vector<std::function<void()>> actions;
+    actions.swap(m_actions);
+    for (const std::function<void()>& action : actions)
+        action();
+}
+
+void buildConcurrently(const std::vector<std::function<void()>>& jobs, unsigned int numThreads)
+{
+    std::vector<std::unique_ptr<DeferredInsertions>> insertions;
+    std::vector<std::exception_ptr> errors (jobs.size());
+    for (size_t i = 0; i < jobs.size(); ++i)
+        insertions.emplace_back(new DeferredInsertions);
+
+    // jobs are taken in order, so that the big ones at the start of a configuration don't end up last
+    std::atomic<size_t> nextJob (0);
+    auto worker = [&]()
+    {
+        for (size_t job = nextJob++; job < jobs.size(); job = nextJob++)
+        {
+            DeferredInsertions::Scope scope (*insertions[job]);
+            try
+            {
+                jobs[job]();
+            }
+            catch (...)
+            {
+                errors[job] = std::current_exception();
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    const size_t numWorkers = std::min<size_t>(std::max(numThreads, 1u), jobs.size());
+    for (size_t i = 1; i < numWorkers; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread& thread : threads)
+        thread.join();
+
+    for (size_t job = 0; job < jobs.size(); ++job)
+    {
+        if (errors[job])
+            std::rethrow_exception(errors[job]);
+        insertions[job]->replay();
+    }
+}
+
+}
@@ -25,8 +25,10 @@
 #include <boost/xpressive/xpressive.hpp>
 
 #include <ASNodeManager.h>
+#include <ASDeferredInsertions.h>
 #include <ASInformationModel.h>
 #include <ASSourceVariable.h>
+#include <ASSourceVariableIoManager.h>
 #include <Utils.h>
 
 #include <LogIt.h>
@@ -40,6 +42,9 @@ namespace AddressSpace
 ASNodeManager::ASNodeManager () :
 		NodeManagerBase("OPCUASERVER", OpcUa_False, 1000),
 		m_afterStartUpDelegate(0)
+#ifndef BACKEND_OPEN62541
+		,m_sourceVariableIoManager(new ASSourceVariableIoManager(this))
+#endif
 {
 
 }
@@ -51,6 +56,9 @@ ASNodeManager::~ASNodeManager()
 		(*it)->releaseReference();
 	}
 	m_unreferencedNodes.clear();
+#ifndef BACKEND_OPEN62541
+	delete m_sourceVariableIoManager;
+#endif
 
 }
 
@@ -60,7 +68,14 @@ UaStatus ASNodeManager::addNodeAndReferenceThrows(
 	const UaNodeId&   referenceTypeId,
 	const UaNodeId&   targetNodeId)
 	{
-
+		if (DeferredInsertions::isDeferring())
+		{
+			DeferredInsertions::runOrDefer([this, parentNodeId, pNewNode, referenceTypeId, targetNodeId]()
+			{
+				this->addNodeAndReferenceThrows(parentNodeId, pNewNode, referenceTypeId, targetNodeId);
+			});
+			return OpcUa_Good;
+		}
 		LOG(Log::TRC, "AddressSpace") << "addNodeAndReferenceThrows: adding target node at [" <<
 				targetNodeId.toString().toUtf8() << "] from parent at [" << parentNodeId.toString().toUtf8() << "]";
 		UaStatus status = this->addNodeAndReference(parentNodeId, pNewNode, referenceTypeId);
@@ -70,6 +85,7 @@ UaStatus ASNodeManager::addNodeAndReferenceThrows(
 				+ status.toString().toUtf8()
 				+ "(from: " + parentNodeId.toString().toUtf8()
 				+ " to: " + targetNodeId.toString().toUtf8() + " )");
+		indexNode(pNewNode);
 		return status;
 	}
 
@@ -80,6 +96,14 @@ UaStatus ASNodeManager::addNodeAndReferenceThrows(
 		const UaNodeId&   sourceNodeId,
 		const UaNodeId&   targetNodeId)
 		{
+			if (DeferredInsertions::isDeferring())
+			{
+				DeferredInsertions::runOrDefer([this, pSourceNode, pNewNode, referenceTypeId, sourceNodeId, targetNodeId]()
+				{
+					this->addNodeAndReferenceThrows(pSourceNode, pNewNode, referenceTypeId, sourceNodeId, targetNodeId);
+				});
+				return OpcUa_Good;
+			}
 			LOG(Log::TRC, "AddressSpace") << "addNodeAndReferenceThrows: adding target node at [" <<
 					targetNodeId.toString().toUtf8() << "] from parent at [" << sourceNodeId.toString().toUtf8() << "]";
 			UaStatus status = this->addNodeAndReference(pSourceNode, pNewNode, referenceTypeId);
@@ -89,6 +113,7 @@ UaStatus ASNodeManager::addNodeAndReferenceThrows(
 					+ status.toString().toUtf8()
 					+ "(from: " + sourceNodeId.toString().toUtf8()
 					+ " to: " + targetNodeId.toString().toUtf8() + " )");
+			indexNode(pNewNode);
 			return status;
 		}
 
@@ -160,12 +185,17 @@ UaStatus ASNodeManager::beforeShutDown()
 			  ASSourceVariable *sv = dynamic_cast<ASSourceVariable*>(pUaNode);
 			  if (sv == pUaNode)
 			  {
-				  return sv->getIOManager();
+				  return m_sourceVariableIoManager;
 			  }
 		  }
 
 		  return NodeManagerBase::getIOManager (pUaNode, attributeId);
 	  }
+
+	  void ASNodeManager::stopSourceVariableSampling ()
+	  {
+		  m_sourceVariableIoManager->stopSampling();
+	  }
 #endif // BACKEND_OPEN62541
 
 
@@ -177,9 +207,23 @@ UaStatus ASNodeManager::beforeShutDown()
 
 	UaStatus ASNodeManager::addUnreferencedNode( UaNode* node )
 	{
+		if (DeferredInsertions::isDeferring())
+		{
+			DeferredInsertions::runOrDefer([this, node](){ this->addUnreferencedNode(node); });
+			return OpcUa_Good;
+		}
 		LOG(Log::TRC, "AddressSpace") << "Adding unreferenced node with nodeId: " << node->nodeId().toString().toUtf8();
 		m_unreferencedNodes.push_back(node);
+		m_nodeIndex.add(node);
 		return OpcUa_Good;
 	}
 
+	void ASNodeManager::indexNode( UaReferenceLists* newNode )
+	{
+		// the node we were given, no need to look it up by its id
+		UaNode* node = dynamic_cast<UaNode*>(newNode);
+		if (node)
+			m_nodeIndex.add(node);
+	}
+
 }
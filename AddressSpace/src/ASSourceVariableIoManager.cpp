@@ -21,7 +21,14 @@
 
 #ifndef BACKEND_OPEN62541
 
+#include <algorithm>
+
 #include <ASSourceVariableIoManager.h>
+#include <ASSourceVariable.h>
+#include <ASNodeManager.h>
+#include <ASSourceVariableReadCache.h>
+#include <ASSourceVariableSamplingEngine.h>
+#include <iomanageruanode.h>
 #include <LogIt.h>
 
 using namespace std;
@@ -29,6 +36,71 @@ using namespace std;
 namespace AddressSpace
 {
 
+ASSourceVariableIoManager::ASSourceVariableIoManager (ASNodeManager* nodeManager):
+	m_nodeManager (nodeManager),
+	m_samplingEngine (new ASSourceVariableSamplingEngine)
+{}
+
+ASSourceVariableIoManager::~ASSourceVariableIoManager ()
+{
+	// unique_ptr's deleter needs the complete type, hence here and not in the header
+	for (Transaction* transaction : m_freeTransactions)
+		delete transaction;
+}
+
+void ASSourceVariableIoManager::stopSampling ()
+{
+	m_samplingEngine->stop();
+}
+
+ASSourceVariable* ASSourceVariableIoManager::sourceVariable (VariableHandle* variableHandle) const
+{
+	/* ASNodeManager::getIOManager() gives this IOManager only for the value of an ASSourceVariable, and the handles
+	 * of the nodes of a NodeManagerUaNode are VariableHandleUaNode - so no lookup by node id and no dynamic_cast */
+	if (!variableHandle || variableHandle->m_pIOManager != this)
+	{
+		LOG(Log::ERR) << "Source variable IOManager was given a variable handle which isn't one of its own";
+		return nullptr;
+	}
+	return static_cast<ASSourceVariable*>(static_cast<VariableHandleUaNode*>(variableHandle)->pUaNode());
+}
+
+/* Finished transactions are kept for reuse, together with the storage of their deferred reads. Both the number kept
+ * and the storage kept with each are bounded, so that a burst of huge transactions doesn't pin its memory. */
+static const size_t MaxFreeTransactions = 64;
+static const size_t MaxKeptDeferredReads = 1024;
+
+ASSourceVariableIoManager::Transaction* ASSourceVariableIoManager::acquireTransaction ()
+{
+	{
+		std::lock_guard<std::mutex> lock (m_freeTransactionsLock);
+		if (!m_freeTransactions.empty())
+		{
+			Transaction* transaction = m_freeTransactions.back();
+			m_freeTransactions.pop_back();
+			return transaction;
+		}
+	}
+	return new Transaction;
+}
+
+void ASSourceVariableIoManager::releaseTransaction (Transaction* transaction)
+{
+	if (transaction->deferredReads.capacity() > MaxKeptDeferredReads)
+		std::vector<DeferredRead>().swap(transaction->deferredReads);
+	else
+		transaction->deferredReads.clear();
+	{
+		std::lock_guard<std::mutex> lock (m_freeTransactionsLock);
+		if (m_freeTransactions.size() < MaxFreeTransactions)
+		{
+			m_freeTransactions.push_back(transaction);
+			return;
+		}
+	}
+	delete transaction;
+}
+
 UaStatus ASSourceVariableIoManager::beginTransaction (
     IOManagerCallback*       pCallback,
     const ServiceContext&    serviceContext,
@@ -39,8 +111,77 @@ UaStatus ASSourceVariableIoManager::beginTransaction (
     TransactionType          transactionType,
     OpcUa_Handle&            hIOManagerContext)
 {
-	m_callback = pCallback;
-	m_transaction = hTransaction;
+	Transaction* transaction = acquireTransaction();
+	transaction->callback = pCallback;
+	transaction->hTransaction = hTransaction;
+	transaction->maxAge = maxAge;
+	if (transactionType == IOManager::TransactionRead)
+		transaction->deferredReads.reserve(totalItemCountHint);
+	hIOManagerContext = transaction;
+	return OpcUa_Good;
+}
+
+UaStatus ASSourceVariableIoManager::beginStartMonitoring(
+    OpcUa_Handle        hIOManagerContext,
+    OpcUa_UInt32        callbackHandle,
+    IOVariableCallback* pIOVariableCallback,
+    VariableHandle*     pVariableHandle,
+    MonitoringContext&  monitoringContext)
+{
+	Transaction* transaction = static_cast<Transaction*>(hIOManagerContext);
+	ASSourceVariable* variable = sourceVariable(pVariableHandle);
+	if (!variable)
+		return OpcUa_BadInternalError;
+	if (variable->readOperationJobId() == ASSOURCEVARIABLE_NOTHING)
+		return OpcUa_BadNotReadable;
+	OpcUa_Double samplingInterval = monitoringContext.samplingInterval;
+	OpcUa_UInt32 hIOVariable = 0;
+	UaStatus status = m_samplingEngine->startMonitoring(variable, pIOVariableCallback, samplingInterval, hIOVariable);
+	LOG(Log::DBG) << "beginStartMonitoring op=" << variable->readOperationJobId() << " samplingInterval=" << samplingInterval << " hIOVariable=" << hIOVariable;
+	UaDataValue noInitialValue; // will come with the first sample
+	transaction->callback->finishStartMonitoring(
+			transaction->hTransaction,
+			callbackHandle,
+			hIOVariable,
+			samplingInterval,
+			OpcUa_False,
+			noInitialValue,
+			status);
+	return OpcUa_Good;
+}
+
+UaStatus ASSourceVariableIoManager::beginModifyMonitoring(
+    OpcUa_Handle        hIOManagerContext,
+    OpcUa_UInt32        callbackHandle,
+    OpcUa_UInt32        hIOVariable,
+    MonitoringContext&  monitoringContext)
+{
+	Transaction* transaction = static_cast<Transaction*>(hIOManagerContext);
+	OpcUa_Double samplingInterval = monitoringContext.samplingInterval;
+	UaStatus status = m_samplingEngine->modifyMonitoring(hIOVariable, samplingInterval);
+	transaction->callback->finishModifyMonitoring(
+			transaction->hTransaction,
+			callbackHandle,
+			samplingInterval,
+			status);
+	return OpcUa_Good;
+}
+
+UaStatus ASSourceVariableIoManager::beginStopMonitoring(
+    OpcUa_Handle        hIOManagerContext,
+    OpcUa_UInt32        callbackHandle,
+    OpcUa_UInt32        hIOVariable)
+{
+	Transaction* transaction = static_cast<Transaction*>(hIOManagerContext);
+	// the transaction may be over by the time the item is stopped (see stopMonitoring)
+	IOManagerCallback* callback = transaction->callback;
+	const OpcUa_UInt32 hTransaction = transaction->hTransaction;
+	UaStatus status = m_samplingEngine->stopMonitoring(hIOVariable, [callback, hTransaction, callbackHandle]()
+	{
+		callback->finishStopMonitoring(hTransaction, callbackHandle, OpcUa_Good);
+	});
+	if (!status.isGood())
+		callback->finishStopMonitoring(hTransaction, callbackHandle, status);
 	return OpcUa_Good;
 }
 
@@ -50,17 +191,60 @@ UaStatus ASSourceVariableIoManager::beginRead (
     VariableHandle*     pVariableHandle,
     OpcUa_ReadValueId*  pReadValueId)
 {
-	m_callbackHandle = callbackHandle;
-	LOG(Log::DBG) << "beginRead op=" << m_readOperationJobId << " cbkHandle=" <<callbackHandle << endl;
-	if (m_readOperationJobId == ASSOURCEVARIABLE_NOTHING)
+	Transaction* transaction = static_cast<Transaction*>(hIOManagerContext);
+	ASSourceVariable* variable = sourceVariable(pVariableHandle);
+	if (!variable)
+		return OpcUa_BadInternalError;
+	LOG(Log::DBG) << "beginRead op=" << variable->readOperationJobId() << " cbkHandle=" <<callbackHandle << endl;
+	return startRead (
+			variable,
+			transaction->callback,
+			transaction->hTransaction,
+			callbackHandle,
+			transaction->maxAge,
+			transaction->deferredReads);
+}
+
+UaStatus ASSourceVariableIoManager::startRead (
+		ASSourceVariable*          variable,
+		IOManagerCallback*         callback,
+		OpcUa_UInt32               hTransaction,
+		OpcUa_UInt32               callbackHandle,
+		OpcUa_Double               maxAge,
+		std::vector<DeferredRead>& deferredReads)
+{
+	ASSourceVariableJobId jobId = variable->readOperationJobId();
+	if (jobId == ASSOURCEVARIABLE_NOTHING)
 		return OpcUa_BadUserAccessDenied;
+	if (SourceVariables_isReadAsynchronous(jobId))
+	{
+		ASSourceVariableReadCache* cache = variable->readCache();
+		if (cache)
+		{
+			UaDataValue cachedValue;
+			switch (cache->beginRead(maxAge, callback, hTransaction, callbackHandle, cachedValue))
+			{
+			case ASSourceVariableReadCache::SERVED:
+				callback->finishRead(hTransaction, callbackHandle, cachedValue);
+				return OpcUa_Good;
+			case ASSourceVariableReadCache::COALESCED:
+				return OpcUa_Good; // finishRead will come from whoever reads the device now
+			case ASSourceVariableReadCache::MUST_READ:
+				break;
+			}
+		}
+		// will be spawned (together with other reads of the same object) in spawnDeferredReads
+		DeferredRead deferredRead = { variable->parentObjectNode(), {jobId, callbackHandle, cache} };
+		deferredReads.push_back(deferredRead);
+		return OpcUa_Good;
+	}
 	else
 		return SourceVariables_spawnIoJobRead (
-				m_readOperationJobId,
-				m_callback,
-				m_transaction,
-				m_callbackHandle,
-				m_variableParentNode
+				jobId,
+				callback,
+				hTransaction,
+				callbackHandle,
+				variable->parentObjectNode()
 				);
 
 }
@@ -71,24 +255,91 @@ UaStatus ASSourceVariableIoManager::beginWrite (
     VariableHandle*     pVariableHandle,
     OpcUa_WriteValue*   pWriteValue)
 {
-	m_callbackHandle = callbackHandle;
-	LOG(Log::DBG) << "beginWrite op=" << m_writeOperationJobId << " cbkHandle=" <<callbackHandle << endl;
-	if (m_writeOperationJobId == ASSOURCEVARIABLE_NOTHING)
+	Transaction* transaction = static_cast<Transaction*>(hIOManagerContext);
+	ASSourceVariable* variable = sourceVariable(pVariableHandle);
+	if (!variable)
+		return OpcUa_BadInternalError;
+	ASSourceVariableJobId jobId = variable->writeOperationJobId();
+	LOG(Log::DBG) << "beginWrite op=" << jobId << " cbkHandle=" <<callbackHandle << endl;
+	if (jobId == ASSOURCEVARIABLE_NOTHING)
 		return OpcUa_BadUserAccessDenied;
 	else
 		return SourceVariables_spawnIoJobWrite (
-				m_writeOperationJobId,
-				m_callback,
-				m_transaction,
-				m_callbackHandle,
-				m_variableParentNode,
+				jobId,
+				transaction->callback,
+				transaction->hTransaction,
+				callbackHandle,
+				variable->parentObjectNode(),
 				pWriteValue
 				);
 }
 
+void ASSourceVariableIoManager::spawnDeferredReads (
+		IOManagerCallback*         callback,
+		OpcUa_UInt32               hTransaction,
+		std::vector<DeferredRead>& reads)
+{
+	// group by object; stable so that within an object the order of the request is kept
+	std::stable_sort(reads.begin(), reads.end(), [](const DeferredRead& a, const DeferredRead& b){ return a.parentObjectNode < b.parentObjectNode; });
+	for (auto groupBegin = reads.begin(); groupBegin != reads.end(); )
+	{
+		auto groupEnd = std::find_if(groupBegin, reads.end(), [groupBegin](const DeferredRead& r){ return r.parentObjectNode != groupBegin->parentObjectNode; });
+		UaStatus status;
+		try
+		{
+			if (groupEnd - groupBegin == 1)
+				status = SourceVariables_spawnIoJobRead (
+						groupBegin->item.jobId,
+						callback,
+						hTransaction,
+						groupBegin->item.callbackHandle,
+						groupBegin->parentObjectNode,
+						groupBegin->item.cache);
+			else
+			{
+				// the job copies the items, so one scratch array per thread does for all groups
+				static thread_local std::vector<ASSourceVariableReadItem> items;
+				items.clear();
+				for (auto it = groupBegin; it != groupEnd; ++it)
+					items.push_back(it->item);
+				status = SourceVariables_spawnIoJobReadMany (
+						callback,
+						hTransaction,
+						groupBegin->parentObjectNode,
+						items.data(),
+						items.size());
+			}
+		}
+		catch (const std::exception& e)
+		{
+			LOG(Log::ERR) << "While spawning source variable reads: " << e.what();
+			status = OpcUa_BadInternalError;
+		}
+		if (!status.isGood())
+		{
+			// beginRead has already said "good" for these items, so the failure has to be delivered through the callback
+			UaDataValue result (UaVariant(), status.statusCode(), UaDateTime(), UaDateTime::now());
+			for (auto it = groupBegin; it != groupEnd; ++it)
+			{
+				callback->finishRead (
+						hTransaction,
+						it->item.callbackHandle,
+						result);
+				if (it->item.cache) // the reads coalesced onto this one get the failure too, but it's not cached
+					it->item.cache->completeRead(result, /*storeInCache*/ false);
+			}
+		}
+		groupBegin = groupEnd;
+	}
+}
+
 UaStatus ASSourceVariableIoManager::finishTransaction (
     OpcUa_Handle        hIOManagerContext)
 {
+	Transaction* transaction = static_cast<Transaction*>(hIOManagerContext);
+	if (!transaction->deferredReads.empty())
+		spawnDeferredReads(transaction->callback, transaction->hTransaction, transaction->deferredReads);
+	releaseTransaction(transaction);
 	return OpcUa_Good;
 }
 
@@ -0,0 +1,89 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * ASSourceVariableReadCache.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BACKEND_OPEN62541
+
+#include <algorithm>
+
+#include <ASSourceVariableReadCache.h>
+
+namespace AddressSpace
+{
+
+ASSourceVariableReadCache::ASSourceVariableReadCache (unsigned int maxAgeMs):
+		m_maxAge(std::chrono::milliseconds(maxAgeMs)),
+		m_hasValue(false),
+		m_readInFlight(false)
+{
+}
+
+ASSourceVariableReadCache::Outcome ASSourceVariableReadCache::beginRead (
+		double             clientMaxAgeMs,
+		IOManagerCallback* callback,
+		OpcUa_UInt32       hTransaction,
+		OpcUa_UInt32       callbackHandle,
+		UaDataValue&       cachedValue)
+{
+	Clock::duration maxAge = m_maxAge;
+	if (clientMaxAgeMs >= 0)
+		maxAge = std::min(maxAge, std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(clientMaxAgeMs)));
+
+	std::lock_guard<std::mutex> lock (m_lock);
+	if (m_hasValue && Clock::now() - m_valueObtainedAt <= maxAge)
+	{
+		cachedValue = m_value;
+		return SERVED;
+	}
+	if (m_readInFlight)
+	{
+		PendingRead pendingRead = { callback, hTransaction, callbackHandle };
+		m_pendingReads.push_back(pendingRead);
+		return COALESCED;
+	}
+	m_readInFlight = true;
+	return MUST_READ;
+}
+
+void ASSourceVariableReadCache::completeRead (const UaDataValue& result, bool storeInCache)
+{
+	std::vector<PendingRead> pendingReads;
+	{
+		std::lock_guard<std::mutex> lock (m_lock);
+		if (storeInCache)
+		{
+			m_value = result;
+			m_valueObtainedAt = Clock::now();
+			m_hasValue = true;
+		}
+		m_readInFlight = false;
+		pendingReads.swap(m_pendingReads);
+	}
+	// callbacks are called without the lock held - they may be slow and they may even come back to us
+	for (const PendingRead& pendingRead : pendingReads)
+	{
+		UaDataValue copy (result);
+		pendingRead.callback->finishRead(pendingRead.hTransaction, pendingRead.callbackHandle, copy);
+	}
+}
+
+}
+
+#endif // BACKEND_OPEN62541
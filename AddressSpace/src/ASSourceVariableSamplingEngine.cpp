@@ -0,0 +1,351 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * ASSourceVariableSamplingEngine.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BACKEND_OPEN62541
+
+#include <algorithm>
+#include <chrono>
+
+#include <ASSourceVariableSamplingEngine.h>
+#include <ASSourceVariableIoManager.h>
+#include <ASSourceVariable.h>
+#include <LogIt.h>
+
+namespace AddressSpace
+{
+
+// one day; longer sampling intervals make no sense for hardware anyway
+static const unsigned int MAX_INTERVAL_TICKS = 24 * 3600 * 1000 / ASSourceVariableSamplingEngine::TICK_MS;
+
+// if the sampling thread got this late (e.g. the machine was suspended), it skips the missed ticks instead of catching up
+static const unsigned int MAX_TICKS_BEHIND = 100;
+
+ASSourceVariableSamplingEngine::ASSourceVariableSamplingEngine ():
+		m_quit(false),
+		m_stopped(false),
+		m_currentTick(0),
+		m_wheel(WHEEL_SIZE),
+		m_nextId(1)
+{
+}
+
+ASSourceVariableSamplingEngine::~ASSourceVariableSamplingEngine ()
+{
+	stop();
+	// no fan-outs anymore (the thread pool is gone), so only the registered ones are left
+	for (auto& keyAndSampledVariable : m_sampledVariables)
+		release(keyAndSampledVariable.second);
+}
+
+unsigned int ASSourceVariableSamplingEngine::toIntervalTicks (OpcUa_Double samplingInterval)
+{
+	if (!(samplingInterval > TICK_MS)) // also catches NaN and the negative "use publishing interval" values
+		return 1;
+	if (samplingInterval >= static_cast<OpcUa_Double>(MAX_INTERVAL_TICKS) * TICK_MS)
+		return MAX_INTERVAL_TICKS;
+	unsigned int ticks = static_cast<unsigned int>(samplingInterval / TICK_MS);
+	if (static_cast<OpcUa_Double>(ticks) * TICK_MS < samplingInterval)
+		ticks++;
+	return ticks;
+}
+
+void ASSourceVariableSamplingEngine::schedule (Bucket* bucket, unsigned long long fromTick)
+{
+	unsigned long long dueTick = fromTick + bucket->intervalTicks;
+	bucket->remainingRounds = (bucket->intervalTicks - 1) / WHEEL_SIZE;
+	m_wheel[dueTick % WHEEL_SIZE].push_back(bucket);
+}
+
+ASSourceVariableSamplingEngine::SampledVariable* ASSourceVariableSamplingEngine::subscribe (
+		ASSourceVariable*   variable,
+		unsigned int        intervalTicks,
+		IOVariableCallback* callback)
+{
+	std::pair<ASSourceVariable*, unsigned int> key (variable, intervalTicks);
+	auto it = m_sampledVariables.find(key);
+	if (it == m_sampledVariables.end())
+	{
+		// a bucket is in m_buckets exactly as long as it is in the wheel
+		auto bucketIt = m_buckets.find(intervalTicks);
+		if (bucketIt == m_buckets.end())
+		{
+			bucketIt = m_buckets.insert(std::make_pair(intervalTicks, Bucket())).first;
+			bucketIt->second.intervalTicks = intervalTicks;
+			schedule(&bucketIt->second, m_currentTick);
+		}
+		SampledVariable* sampledVariable = new SampledVariable;
+		sampledVariable->id = m_nextId++;
+		sampledVariable->variable = variable;
+		sampledVariable->bucket = &bucketIt->second;
+		sampledVariable->readInFlight = false;
+		sampledVariable->fanOutsInFlight = 0;
+		sampledVariable->references = 1;
+		it = m_sampledVariables.insert(std::make_pair(key, sampledVariable)).first;
+		bucketIt->second.variables.push_back(sampledVariable);
+		m_sampledVariablesById[sampledVariable->id] = sampledVariable;
+	}
+	SampledVariable* sampledVariable = it->second;
+	sampledVariable->subscribers.push_back(callback);
+	if (std::find(m_firstSamplePending.begin(), m_firstSamplePending.end(), sampledVariable) == m_firstSamplePending.end())
+		m_firstSamplePending.push_back(sampledVariable);
+	return sampledVariable;
+}
+
+void ASSourceVariableSamplingEngine::release (SampledVariable* sampledVariable)
+{
+	if (--sampledVariable->references == 0)
+		delete sampledVariable;
+}
+
+void ASSourceVariableSamplingEngine::unsubscribe (SampledVariable* sampledVariable, IOVariableCallback* callback)
+{
+	std::vector<IOVariableCallback*>& subscribers = sampledVariable->subscribers;
+	subscribers.erase(std::find(subscribers.begin(), subscribers.end(), callback));
+	if (!subscribers.empty())
+		return;
+	// the bucket itself goes away (lazily) when it's due and found empty
+	std::vector<SampledVariable*>& bucketVariables = sampledVariable->bucket->variables;
+	bucketVariables.erase(std::find(bucketVariables.begin(), bucketVariables.end(), sampledVariable));
+	m_firstSamplePending.erase(
+			std::remove(m_firstSamplePending.begin(), m_firstSamplePending.end(), sampledVariable),
+			m_firstSamplePending.end());
+	m_sampledVariablesById.erase(sampledVariable->id);
+	// a read still in flight will find no sampled variable of its id and will be dropped
+	m_sampledVariables.erase(std::make_pair(sampledVariable->variable, sampledVariable->bucket->intervalTicks));
+	// a fan-out in flight keeps it until it's done
+	release(sampledVariable);
+}
+
+UaStatus ASSourceVariableSamplingEngine::startMonitoring (
+		ASSourceVariable*   variable,
+		IOVariableCallback* callback,
+		OpcUa_Double&       samplingInterval,
+		OpcUa_UInt32&       hIOVariable)
+{
+	unsigned int intervalTicks = toIntervalTicks(samplingInterval);
+	std::lock_guard<std::mutex> lock (m_lock);
+	if (m_stopped)
+		return OpcUa_BadShutdown;
+	MonitoredItem monitoredItem = { subscribe(variable, intervalTicks, callback), callback };
+	hIOVariable = m_nextId++;
+	m_monitoredItems[hIOVariable] = monitoredItem;
+	samplingInterval = static_cast<OpcUa_Double>(intervalTicks) * TICK_MS;
+	if (!m_thread.joinable())
+		m_thread = std::thread(&ASSourceVariableSamplingEngine::run, this);
+	return OpcUa_Good;
+}
+
+UaStatus ASSourceVariableSamplingEngine::modifyMonitoring (OpcUa_UInt32 hIOVariable, OpcUa_Double& samplingInterval)
+{
+	unsigned int intervalTicks = toIntervalTicks(samplingInterval);
+	std::lock_guard<std::mutex> lock (m_lock);
+	auto it = m_monitoredItems.find(hIOVariable);
+	if (it == m_monitoredItems.end())
+		return OpcUa_BadMonitoredItemIdInvalid;
+	MonitoredItem& monitoredItem = it->second;
+	if (monitoredItem.sampledVariable->bucket->intervalTicks != intervalTicks)
+	{
+		SampledVariable* previous = monitoredItem.sampledVariable;
+		monitoredItem.sampledVariable = subscribe(previous->variable, intervalTicks, monitoredItem.callback);
+		unsubscribe(previous, monitoredItem.callback);
+	}
+	samplingInterval = static_cast<OpcUa_Double>(intervalTicks) * TICK_MS;
+	return OpcUa_Good;
+}
+
+UaStatus ASSourceVariableSamplingEngine::stopMonitoring (OpcUa_UInt32 hIOVariable, const std::function<void()>& whenStopped)
+{
+	{
+		std::lock_guard<std::mutex> lock (m_lock);
+		auto it = m_monitoredItems.find(hIOVariable);
+		if (it == m_monitoredItems.end())
+			return OpcUa_BadMonitoredItemIdInvalid;
+		const MonitoredItem monitoredItem = it->second;
+		m_monitoredItems.erase(it);
+		SampledVariable* sampledVariable = monitoredItem.sampledVariable;
+		const bool fanningOut = sampledVariable->fanOutsInFlight > 0;
+		if (fanningOut)
+			sampledVariable->whenFannedOut.push_back(whenStopped);
+		unsubscribe(sampledVariable, monitoredItem.callback); // the fan-out keeps it, if any
+		if (fanningOut)
+			return OpcUa_Good;
+	}
+	whenStopped();
+	return OpcUa_Good;
+}
+
+void ASSourceVariableSamplingEngine::stop ()
+{
+	{
+		std::lock_guard<std::mutex> lock (m_lock);
+		m_quit = true;
+		m_stopped = true;
+	}
+	m_wakeUp.notify_all();
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void ASSourceVariableSamplingEngine::addSample (SampledVariable* sampledVariable, std::vector<Sample>& due)
+{
+	if (sampledVariable->readInFlight)
+		return; // the device is slower than the sampling interval; don't pile up reads
+	sampledVariable->readInFlight = true;
+	// any value not older than one sampling interval (e.g. just read for another client) is good enough
+	Sample sample = {
+			sampledVariable->id,
+			sampledVariable->variable,
+			static_cast<OpcUa_Double>(sampledVariable->bucket->intervalTicks) * TICK_MS };
+	due.push_back(sample);
+}
+
+void ASSourceVariableSamplingEngine::collectDue (std::vector<Sample>& due)
+{
+	for (SampledVariable* sampledVariable : m_firstSamplePending)
+		addSample(sampledVariable, due);
+	m_firstSamplePending.clear();
+
+	std::vector<Bucket*> slot;
+	slot.swap(m_wheel[m_currentTick % WHEEL_SIZE]);
+	for (Bucket* bucket : slot)
+	{
+		if (bucket->remainingRounds > 0)
+		{
+			bucket->remainingRounds--;
+			m_wheel[m_currentTick % WHEEL_SIZE].push_back(bucket);
+		}
+		else if (bucket->variables.empty())
+			m_buckets.erase(bucket->intervalTicks);
+		else
+		{
+			for (SampledVariable* sampledVariable : bucket->variables)
+				addSample(sampledVariable, due);
+			schedule(bucket, m_currentTick);
+		}
+	}
+}
+
+void ASSourceVariableSamplingEngine::sample (const std::vector<Sample>& due)
+{
+	std::vector<ASSourceVariableIoManager::DeferredRead> deferredReads;
+	for (const Sample& sample : due)
+	{
+		UaStatus status;
+		try
+		{
+			status = ASSourceVariableIoManager::startRead(sample.variable, this, /*hTransaction*/ 0, sample.id, sample.maxAge, deferredReads);
+		}
+		catch (const std::exception& e)
+		{
+			LOG(Log::ERR) << "While sampling a source variable: " << e.what();
+			status = OpcUa_BadInternalError;
+		}
+		if (!status.isGood())
+		{
+			UaDataValue result (UaVariant(), status.statusCode(), UaDateTime(), UaDateTime::now());
+			finishRead(0, sample.id, result);
+		}
+	}
+	if (!deferredReads.empty())
+		ASSourceVariableIoManager::spawnDeferredReads(this, /*hTransaction*/ 0, deferredReads);
+}
+
+void ASSourceVariableSamplingEngine::run ()
+{
+	typedef std::chrono::steady_clock Clock;
+	const Clock::duration tick = std::chrono::milliseconds(TICK_MS);
+	Clock::time_point nextTick = Clock::now();
+	std::vector<Sample> due;
+	std::unique_lock<std::mutex> lock (m_lock);
+	while (!m_quit)
+	{
+		nextTick += tick;
+		if (Clock::now() - nextTick > MAX_TICKS_BEHIND * tick)
+		{
+			LOG(Log::WRN) << "Source variable sampling is late by more than " << MAX_TICKS_BEHIND << " ticks, skipping them";
+			nextTick = Clock::now();
+		}
+		m_wakeUp.wait_until(lock, nextTick, [this](){ return m_quit; });
+		if (m_quit)
+			break;
+		m_currentTick++;
+		due.clear();
+		collectDue(due);
+		if (due.empty())
+			continue;
+		// the reads may finish synchronously (synchronous source variables, cached values), and finishRead locks
+		lock.unlock();
+		sample(due);
+		lock.lock();
+	}
+}
+
+UaStatus ASSourceVariableSamplingEngine::finishRead (
+		OpcUa_UInt32  hTransaction,
+		OpcUa_UInt32  callbackHandle,
+		UaDataValue&  dataValue,
+		OpcUa_Boolean detach,
+		OpcUa_Boolean allowCopy)
+{
+	/* The fan-out goes to the SDK, which has locks of its own - and its threads take m_lock in (start|stop)Monitoring,
+	 * possibly holding them: dataChange() is called without m_lock, and (start|modify|stop)Monitoring never wait for
+	 * a fan-out. The fan-out holds a reference to the sampled variable instead (the last one frees it) and calls
+	 * only the subscribers which are still there: an item unsubscribed meanwhile is skipped. The items stopped
+	 * meanwhile are only reported stopped once it's over, as until then their dataChange() may be running. */
+	std::vector<IOVariableCallback*> subscribers;
+	SampledVariable* sampledVariable;
+	{
+		std::lock_guard<std::mutex> lock (m_lock);
+		auto it = m_sampledVariablesById.find(callbackHandle);
+		if (it == m_sampledVariablesById.end())
+			return OpcUa_Good; // nobody's interested anymore
+		sampledVariable = it->second;
+		subscribers = sampledVariable->subscribers;
+		sampledVariable->fanOutsInFlight++;
+		sampledVariable->references++;
+	}
+	for (IOVariableCallback* subscriber : subscribers)
+	{
+		{
+			std::lock_guard<std::mutex> lock (m_lock);
+			const std::vector<IOVariableCallback*>& current = sampledVariable->subscribers;
+			if (std::find(current.begin(), current.end(), subscriber) == current.end())
+				continue;
+		}
+		subscriber->dataChange(dataValue);
+	}
+	std::vector<std::function<void()>> whenFannedOut;
+	{
+		std::lock_guard<std::mutex> lock (m_lock);
+		// not sampled again until the fan-out is over, so that fan-outs don't pile up either
+		sampledVariable->readInFlight = false;
+		if (--sampledVariable->fanOutsInFlight == 0)
+			whenFannedOut.swap(sampledVariable->whenFannedOut);
+		release(sampledVariable);
+	}
+	for (const std::function<void()>& whenStopped : whenFannedOut)
+		whenStopped();
+	return OpcUa_Good;
+}
+
+}
+
+#endif // BACKEND_OPEN62541
@@ -21,7 +21,10 @@
  */
 
 #include <ArrayTools.h>
+#include <ArrayToolsKernels.h>
 #include <algorithm>
+#include <cstring>
+#include <type_traits>
 
 namespace AddressSpace
 {
@@ -29,15 +32,25 @@ namespace AddressSpace
 namespace ArrayTools
 {
 
-/** This templatized function is applicable to "simple types" like arrays of ints, where an assignment operator does well... */
+#ifndef BACKEND_OPEN62541
+/** With detach the setter takes over the buffer of the array instead of copying it again. */
+static const OpcUa_Boolean s_detach = OpcUa_True;
+#else
+static const OpcUa_Boolean s_detach = OpcUa_False; // detaching arrays is not something open62541-compat promises
+#endif
+
+/** This templatized function is applicable to "simple types" like arrays of ints, where the element is the very stack type, so a memcpy does well... */
 template<typename Type, typename ArrayType>
 static void vectorToUaVariant( const std::vector<Type>& input, UaVariant& output, void (UaVariant::*setterFunction)(ArrayType& array, OpcUa_Boolean detach) )
 {
     ArrayType array;
     array.create( input.size() );
-    for (unsigned int i=0; i<input.size(); ++i)
-        array[i] = input[i];
-    (output.*setterFunction)(array, /*detach*/ OpcUa_False); // TODO @pnikiel: one day we should switch to detach=true, after testing...
+    if (!input.empty())
+    {
+        static_assert( sizeof (Type) == sizeof (typename std::remove_reference<decltype(array[0])>::type), "vector element and stack type differ" );
+        std::memcpy( &array[0], &input[0], input.size() * sizeof (Type) );
+    }
+    (output.*setterFunction)(array, s_detach);
 }
 
 /** This templatized function is applicable to "complex types" like arrays of UaByteString, where an assignment operator to the stack type is not defined... */
@@ -48,12 +61,38 @@ static void vectorToUaVariantByCopyTo( const std::vector<Type>& input, UaVariant
     array.create( input.size() );
     for (unsigned int i=0; i<input.size(); ++i)
         input[i].copyTo(&array[i]);
-    (output.*setterFunction)(array, /*detach*/ OpcUa_False); // TODO @pnikiel: one day we should switch to detach=true, after testing...
+    (output.*setterFunction)(array, s_detach);
+}
+
+/** Like vectorToUaVariantByCopyTo but the elements are detached (moved) from the input, so their contents are not copied at all. */
+template<typename Type, typename ArrayType>
+static void vectorToUaVariantByDetach( std::vector<Type>& input, UaVariant& output, void (UaVariant::*setterFunction)(ArrayType& array, OpcUa_Boolean detach) )
+{
+#ifndef BACKEND_OPEN62541
+    ArrayType array;
+    array.create( input.size() );
+    for (unsigned int i=0; i<input.size(); ++i)
+        input[i].detach(&array[i]);
+    (output.*setterFunction)(array, s_detach);
+#else
+    vectorToUaVariantByCopyTo( input, output, setterFunction );
+#endif
 }
 
 void convertBooleanVectorToUaVariant( const std::vector<OpcUa_Boolean>& input, UaVariant& output )
 {
-    vectorToUaVariant (input, output, &UaVariant::setBoolArray);
+    // not through vectorToUaVariant(): with open62541 OpcUa_Boolean is bool, and std::vector<bool> has no contiguous storage to memcpy from
+    UaBooleanArray array;
+    array.create( input.size() );
+#ifndef BACKEND_OPEN62541
+    // OpcUa_Boolean is unsigned char here and device logic may well put e.g. 0xFF for true; OPC-UA wants exactly 1.
+    if (!input.empty())
+        bestKernels().normalizeBooleans( &input[0], &array[0], input.size() );
+#else
+    for (unsigned int i=0; i<input.size(); ++i)
+        array[i] = input[i];
+#endif // BACKEND_OPEN62541
+    output.setBoolArray(array, s_detach);
 }
 
 void convertByteVectorToUaVariant( const std::vector <OpcUa_Byte>& input, UaVariant &output )
@@ -63,7 +102,7 @@ void convertByteVectorToUaVariant( const std::vector <OpcUa_Byte>& input, UaVari
     {
         array = UaByteArray( reinterpret_cast<const char*>(&input[0]), input.size() );
     }
-    output.setByteArray(array, /*detach*/ OpcUa_False);
+    output.setByteArray(array, s_detach);
 }
 
 void convertVectorToUaVariant( const std::vector <OpcUa_SByte>& input, UaVariant &output )
@@ -126,9 +165,46 @@ void convertVectorToUaVariant( const std::vector <UaString>& input, UaVariant& o
     vectorToUaVariantByCopyTo ( input, output, &UaVariant::setStringArray);
 }
 
+void convertVectorToUaVariant( std::vector <UaString>&& input, UaVariant& output )
+{
+    vectorToUaVariantByDetach ( input, output, &UaVariant::setStringArray);
+}
+
+void convertVectorToUaVariant( std::vector <UaVariant>&& input, UaVariant& output )
+{
+    vectorToUaVariantByDetach ( input, output, &UaVariant::setVariantArray);
+}
+
+void convertVectorToUaVariant( std::vector <UaByteString>&& input, UaVariant& output )
+{
+    vectorToUaVariantByDetach ( input, output, &UaVariant::setByteStringArray);
+}
+
+#ifndef BACKEND_OPEN62541
+/** Dispatches to the in-place copy. Note that in uaVariantToVector() a vector of OpcUa_Boolean always means Boolean: in the UASDK
+ * Boolean and Byte are the same primitive type, and Byte has its own converter. */
+template<typename Type>
+static UaStatus copyInPlace( const OpcUa_Variant& input, std::vector<Type>& output )
+{
+    return copyOpcUaVariantToVector( input, output );
+}
+
+static UaStatus copyInPlace( const OpcUa_Variant& input, std::vector<OpcUa_Boolean>& output )
+{
+    return copyOpcUaVariantToBooleanVector( input, output );
+}
+#endif // BACKEND_OPEN62541
+
 template<typename Type, typename ArrayType>
 static  UaStatus uaVariantToVector( const UaVariant& input, std::vector<Type>& output, OpcUa_StatusCode (UaVariant::*getterFunction)(ArrayType& array) const )
 {
+#ifndef BACKEND_OPEN62541
+    // Typically the variant holds exactly the requested type; then its array is copied just once, straight into the output.
+    const OpcUa_Variant* raw = input;
+    if (copyInPlace( *raw, output ).isGood())
+        return OpcUa_Good;
+#endif // BACKEND_OPEN62541
+    // Otherwise let the SDK do the conversion.
     ArrayType array;
     UaStatus status = (input.*getterFunction)(array);
     if (!status.isGood())
@@ -146,6 +222,11 @@ UaStatus convertUaVariantToBooleanVector( const UaVariant& input, std::vector <O
 
 UaStatus convertUaVariantToByteVector( const UaVariant& input, std::vector <OpcUa_Byte> &output )
 {
+#ifndef BACKEND_OPEN62541
+    const OpcUa_Variant* raw = input;
+    if (copyOpcUaVariantToByteVector( *raw, output ).isGood())
+        return OpcUa_Good;
+#endif // BACKEND_OPEN62541
     UaByteArray array;
     UaStatus status = input.toByteArray(array);
     if (!status.isGood())
@@ -192,11 +273,36 @@ UaStatus convertUaVariantToVector( const UaVariant& input, std::vector <OpcUa_UI
 
 UaStatus convertUaVariantToVector( const UaVariant& input, std::vector <OpcUa_Float> &output )
 {
+#ifndef BACKEND_OPEN62541
+    const OpcUa_Variant* raw = input;
+    if (raw->ArrayType == OpcUa_VariantArrayType_Array && raw->Datatype == OpcUaType_Double)
+    {
+        const size_t length = raw->Value.Array.Length > 0 ? raw->Value.Array.Length : 0;
+        output.resize( length );
+        if (length > 0 && !bestKernels().narrowDoubles( raw->Value.Array.Value.DoubleArray, &output[0], length ))
+        {
+            output.clear();
+            return OpcUa_BadOutOfRange;
+        }
+        return OpcUa_Good;
+    }
+#endif // BACKEND_OPEN62541
     return uaVariantToVector(input, output, &UaVariant::toFloatArray);
 }
 
 UaStatus convertUaVariantToVector( const UaVariant& input, std::vector <OpcUa_Double> &output )
 {
+#ifndef BACKEND_OPEN62541
+    const OpcUa_Variant* raw = input;
+    if (raw->ArrayType == OpcUa_VariantArrayType_Array && raw->Datatype == OpcUaType_Float)
+    {
+        const size_t length = raw->Value.Array.Length > 0 ? raw->Value.Array.Length : 0;
+        output.resize( length );
+        if (length > 0)
+            bestKernels().widenFloats( raw->Value.Array.Value.FloatArray, &output[0], length );
+        return OpcUa_Good;
+    }
+#endif // BACKEND_OPEN62541
     return uaVariantToVector(input, output, &UaVariant::toDoubleArray);
 }
 
@@ -215,6 +321,110 @@ UaStatus convertUaVariantToVector( const UaVariant& input, std::vector <UaVarian
     return uaVariantToVector<UaVariant, UaVariantArray>(input, output, &UaVariant::toVariantArray);
 }
 
+#ifndef BACKEND_OPEN62541 // relies on the layout of OpcUa_Variant of the UA-SDK
+
+/** Applicable to "simple types", where the stack type is the same as the element type of the vector. */
+template<typename Type>
+static UaStatus opcUaVariantToVector( const OpcUa_Variant& input, std::vector<Type>& output, OpcUa_BuiltInType dataType, Type* OpcUa_VariantArrayUnion::*member )
+{
+    if (input.ArrayType != OpcUa_VariantArrayType_Array || input.Datatype != dataType)
+        return OpcUa_BadTypeMismatch;
+    const Type* data = input.Value.Array.Value.*member;
+    const size_t length = input.Value.Array.Length > 0 ? input.Value.Array.Length : 0;
+    output.assign( data, data + length );
+    return OpcUa_Good;
+}
+
+/** Applicable to "complex types" like UaString, which have to be constructed out of their stack type. */
+template<typename Type, typename StackType, typename Constructor>
+static UaStatus opcUaVariantToVectorByConstruction( const OpcUa_Variant& input, std::vector<Type>& output, OpcUa_BuiltInType dataType, StackType* OpcUa_VariantArrayUnion::*member, Constructor construct )
+{
+    if (input.ArrayType != OpcUa_VariantArrayType_Array || input.Datatype != dataType)
+        return OpcUa_BadTypeMismatch;
+    const StackType* data = input.Value.Array.Value.*member;
+    const size_t length = input.Value.Array.Length > 0 ? input.Value.Array.Length : 0;
+    output.clear();
+    output.reserve( length );
+    for (size_t i=0; i<length; ++i)
+        output.push_back( construct(data[i]) );
+    return OpcUa_Good;
+}
+
+UaStatus copyOpcUaVariantToBooleanVector( const OpcUa_Variant& input, std::vector <OpcUa_Boolean>& output )
+{
+    return opcUaVariantToVector( input, output, OpcUaType_Boolean, &OpcUa_VariantArrayUnion::BooleanArray );
+}
+
+UaStatus copyOpcUaVariantToByteVector( const OpcUa_Variant& input, std::vector <OpcUa_Byte>& output )
+{
+    return opcUaVariantToVector( input, output, OpcUaType_Byte, &OpcUa_VariantArrayUnion::ByteArray );
+}
+
+UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_SByte>& output )
+{
+    return opcUaVariantToVector( input, output, OpcUaType_SByte, &OpcUa_VariantArrayUnion::SByteArray );
+}
+
+UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_Int16>& output )
+{
+    return opcUaVariantToVector( input, output, OpcUaType_Int16, &OpcUa_VariantArrayUnion::Int16Array );
+}
+
+UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_UInt16>& output )
+{
+    return opcUaVariantToVector( input, output, OpcUaType_UInt16, &OpcUa_VariantArrayUnion::UInt16Array );
+}
+
+UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_Int32>& output )
+{
+    return opcUaVariantToVector( input, output, OpcUaType_Int32, &OpcUa_VariantArrayUnion::Int32Array );
+}
+
+UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_UInt32>& output )
+{
+    return opcUaVariantToVector( input, output, OpcUaType_UInt32, &OpcUa_VariantArrayUnion::UInt32Array );
+}
+
+UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_Int64>& output )
+{
+    return opcUaVariantToVector( input, output, OpcUaType_Int64, &OpcUa_VariantArrayUnion::Int64Array );
+}
+
+UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_UInt64>& output )
+{
+    return opcUaVariantToVector( input, output, OpcUaType_UInt64, &OpcUa_VariantArrayUnion::UInt64Array );
+}
+
+UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_Float>& output )
+{
+    return opcUaVariantToVector( input, output, OpcUaType_Float, &OpcUa_VariantArrayUnion::FloatArray );
+}
+
+UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <OpcUa_Double>& output )
+{
+    return opcUaVariantToVector( input, output, OpcUaType_Double, &OpcUa_VariantArrayUnion::DoubleArray );
+}
+
+UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <UaString>& output )
+{
+    return opcUaVariantToVectorByConstruction( input, output, OpcUaType_String, &OpcUa_VariantArrayUnion::StringArray,
+        [](const OpcUa_String& x) { return UaString(&x); } );
+}
+
+UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <UaByteString>& output )
+{
+    return opcUaVariantToVectorByConstruction( input, output, OpcUaType_ByteString, &OpcUa_VariantArrayUnion::ByteStringArray,
+        [](const OpcUa_ByteString& x) { return UaByteString(x); } );
+}
+
+UaStatus copyOpcUaVariantToVector( const OpcUa_Variant& input, std::vector <UaVariant>& output )
+{
+    return opcUaVariantToVectorByConstruction( input, output, OpcUaType_Variant, &OpcUa_VariantArrayUnion::VariantArray,
+        [](const OpcUa_Variant& x) { return UaVariant(x); } );
+}
+
+#endif // BACKEND_OPEN62541
+
 std::vector<UaString> convertStdStringsToUaStrings( const std::vector<std::string>& input )
 {
     std::vector<UaString> output (input.size());
@@ -0,0 +1,193 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * ArrayToolsKernels.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <ArrayToolsKernels.h>
+
+#include <cmath>
+#include <cfloat>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QUASAR_ARRAYTOOLS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace AddressSpace
+{
+
+namespace ArrayTools
+{
+
+static void normalizeBooleansScalar (const unsigned char* in, unsigned char* out, size_t n)
+{
+    for (size_t i=0; i<n; ++i)
+        out[i] = in[i] ? 1 : 0;
+}
+
+static void widenFloatsScalar (const float* in, double* out, size_t n)
+{
+    for (size_t i=0; i<n; ++i)
+        out[i] = in[i];
+}
+
+static bool narrowDoublesScalar (const double* in, float* out, size_t n)
+{
+    bool inRange = true;
+    for (size_t i=0; i<n; ++i)
+    {
+        if (std::fabs(in[i]) > FLT_MAX && !std::isinf(in[i]))
+            inRange = false; // converting it would be undefined behaviour
+        else
+            out[i] = static_cast<float>(in[i]);
+    }
+    return inRange;
+}
+
+#ifdef QUASAR_ARRAYTOOLS_X86_KERNELS
+
+/* Each vectorized kernel does the bulk in full registers and leaves the tail (less than one register) to the scalar kernel. */
+
+__attribute__((target("sse2")))
+static void normalizeBooleansSse2 (const unsigned char* in, unsigned char* out, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    size_t i=0;
+    for (; i+16 <= n; i+=16)
+    {
+        __m128i isFalse = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in+i)), zero);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out+i), _mm_andnot_si128(isFalse, one));
+    }
+    normalizeBooleansScalar(in+i, out+i, n-i);
+}
+
+__attribute__((target("sse2")))
+static void widenFloatsSse2 (const float* in, double* out, size_t n)
+{
+    size_t i=0;
+    for (; i+4 <= n; i+=4)
+    {
+        __m128 f = _mm_loadu_ps(in+i);
+        _mm_storeu_pd(out+i, _mm_cvtps_pd(f));
+        _mm_storeu_pd(out+i+2, _mm_cvtps_pd(_mm_movehl_ps(f, f)));
+    }
+    widenFloatsScalar(in+i, out+i, n-i);
+}
+
+__attribute__((target("sse2")))
+static bool narrowDoublesSse2 (const double* in, float* out, size_t n)
+{
+    const __m128d signMask = _mm_set1_pd(-0.0);
+    const __m128d floatMax = _mm_set1_pd(FLT_MAX);
+    const __m128d infinity = _mm_set1_pd(std::numeric_limits<double>::infinity());
+    __m128d outOfRange = _mm_setzero_pd();
+    size_t i=0;
+    for (; i+4 <= n; i+=4)
+    {
+        __m128d lo = _mm_loadu_pd(in+i);
+        __m128d hi = _mm_loadu_pd(in+i+2);
+        __m128d absLo = _mm_andnot_pd(signMask, lo);
+        __m128d absHi = _mm_andnot_pd(signMask, hi);
+        // finite and too big; NaN compares false on both
+        outOfRange = _mm_or_pd(outOfRange, _mm_and_pd(_mm_cmpgt_pd(absLo, floatMax), _mm_cmplt_pd(absLo, infinity)));
+        outOfRange = _mm_or_pd(outOfRange, _mm_and_pd(_mm_cmpgt_pd(absHi, floatMax), _mm_cmplt_pd(absHi, infinity)));
+        _mm_storeu_ps(out+i, _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+    }
+    bool tailInRange = narrowDoublesScalar(in+i, out+i, n-i);
+    return tailInRange && _mm_movemask_pd(outOfRange) == 0;
+}
+
+__attribute__((target("avx2")))
+static void normalizeBooleansAvx2 (const unsigned char* in, unsigned char* out, size_t n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    size_t i=0;
+    for (; i+32 <= n; i+=32)
+    {
+        __m256i isFalse = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in+i)), zero);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out+i), _mm256_andnot_si256(isFalse, one));
+    }
+    normalizeBooleansSse2(in+i, out+i, n-i);
+}
+
+__attribute__((target("avx2")))
+static void widenFloatsAvx2 (const float* in, double* out, size_t n)
+{
+    size_t i=0;
+    for (; i+8 <= n; i+=8)
+    {
+        _mm256_storeu_pd(out+i, _mm256_cvtps_pd(_mm_loadu_ps(in+i)));
+        _mm256_storeu_pd(out+i+4, _mm256_cvtps_pd(_mm_loadu_ps(in+i+4)));
+    }
+    widenFloatsSse2(in+i, out+i, n-i);
+}
+
+__attribute__((target("avx2")))
+static bool narrowDoublesAvx2 (const double* in, float* out, size_t n)
+{
+    const __m256d signMask = _mm256_set1_pd(-0.0);
+    const __m256d floatMax = _mm256_set1_pd(FLT_MAX);
+    const __m256d infinity = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    __m256d outOfRange = _mm256_setzero_pd();
+    size_t i=0;
+    for (; i+4 <= n; i+=4)
+    {
+        __m256d x = _mm256_loadu_pd(in+i);
+        __m256d absX = _mm256_andnot_pd(signMask, x);
+        outOfRange = _mm256_or_pd(outOfRange, _mm256_and_pd(_mm256_cmp_pd(absX, floatMax, _CMP_GT_OQ), _mm256_cmp_pd(absX, infinity, _CMP_LT_OQ)));
+        _mm_storeu_ps(out+i, _mm256_cvtpd_ps(x));
+    }
+    bool tailInRange = narrowDoublesScalar(in+i, out+i, n-i);
+    return tailInRange && _mm256_movemask_pd(outOfRange) == 0;
+}
+
+#endif // QUASAR_ARRAYTOOLS_X86_KERNELS
+
+const KernelSet& scalarKernels ()
+{
+    static const KernelSet kernels = { "scalar", normalizeBooleansScalar, widenFloatsScalar, narrowDoublesScalar };
+    return kernels;
+}
+
+static const KernelSet& selectBestKernels ()
+{
+#ifdef QUASAR_ARRAYTOOLS_X86_KERNELS
+    static const KernelSet avx2 = { "AVX2", normalizeBooleansAvx2, widenFloatsAvx2, narrowDoublesAvx2 };
+    static const KernelSet sse2 = { "SSE2", normalizeBooleansSse2, widenFloatsSse2, narrowDoublesSse2 };
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return sse2;
+#endif // QUASAR_ARRAYTOOLS_X86_KERNELS
+    return scalarKernels();
+}
+
+const KernelSet& bestKernels ()
+{
+    static const KernelSet& best = selectBestKernels(); // thread-safe, done once
+    return best;
+}
+
+}
+
+}
@@ -40,13 +40,21 @@ ChangeNotifyingVariable::ChangeNotifyingVariable(
         initialValue,
         accessLevel,
         pNodeConfig,
-        pSharedMutex)
+        pSharedMutex),
+    m_listeners(nullptr),
+    m_epoch(0),
+    m_hasRetiredListeners(false),
+    m_nextListenerHandle(0)
 {
-
+    m_notificationsInFlight[0].store(0, std::memory_order_relaxed);
+    m_notificationsInFlight[1].store(0, std::memory_order_relaxed);
 }
 
 ChangeNotifyingVariable::~ChangeNotifyingVariable()
 {
+    delete m_listeners.load(std::memory_order_relaxed);
+    for (const Retired& retired : m_retiredListeners)
+        delete retired.listeners;
 }
 
 UaStatus ChangeNotifyingVariable::setValue(
@@ -54,18 +62,147 @@ UaStatus ChangeNotifyingVariable::setValue(
     const UaDataValue& dataValue,
     OpcUa_Boolean checkAccessLevel)
 {
-    UaStatus status = OpcUa::BaseDataVariableType::setValue(pSession, dataValue, checkAccessLevel);
+    UaStatus status = setValueWithoutNotifying(pSession, dataValue, checkAccessLevel);
     if (status.isGood())
-        for (OnChangeListener& changeListener : m_changeListeners)
+        notifyChangeListeners(dataValue);
+    return status;
+}
+
+UaStatus ChangeNotifyingVariable::setValueWithoutNotifying(
+    Session* pSession,
+    const UaDataValue& dataValue,
+    OpcUa_Boolean checkAccessLevel)
+{
+    return OpcUa::BaseDataVariableType::setValue(pSession, dataValue, checkAccessLevel);
+}
+
+void ChangeNotifyingVariable::notifyChangeListeners (const UaDataValue& dataValue)
+{
+    // counted in before the array is loaded: see reclaimRetiredListenersNotInUse()
+    std::atomic<unsigned int>& notificationsInFlight = m_notificationsInFlight[m_epoch.load(std::memory_order_seq_cst) & 1];
+    notificationsInFlight.fetch_add(1, std::memory_order_seq_cst);
+    const Listeners* listeners = m_listeners.load(std::memory_order_seq_cst);
+    if (listeners)
+        for (const Listener& listener : *listeners)
         {
-            changeListener(*this, dataValue);
+            listener.onChange(*this, dataValue);
         }
-    return status;
+    if (notificationsInFlight.fetch_sub(1, std::memory_order_seq_cst) == 1 &&
+        m_hasRetiredListeners.load(std::memory_order_relaxed))
+    {
+        // the last one out of its epoch frees what it can - unless a writer is at it, then the writer does
+        std::unique_lock<std::mutex> lock (m_listenersWriteLock, std::try_to_lock);
+        if (lock.owns_lock())
+            reclaimRetiredListenersNotInUse();
+    }
+}
+
+void ChangeNotifyingVariable::reclaimRetiredListenersNotInUse ()
+{
+    if (m_retiredListeners.empty())
+        return;
+    /* A notification which may still walk a retired array loaded it before it was retired, so it has been counted
+     * in one of the two counters since before that, and until it's done (all seq_cst). So an array is free once both
+     * counters were seen at zero after it was retired. Flipping the epoch sends new notifications to the other
+     * counter, so that the one in use drains even if notifications never stop. */
+    m_epoch.fetch_add(1, std::memory_order_seq_cst);
+    const unsigned char seenAtZero =
+        (m_notificationsInFlight[0].load(std::memory_order_seq_cst) == 0 ? 1 : 0) |
+        (m_notificationsInFlight[1].load(std::memory_order_seq_cst) == 0 ? 2 : 0);
+    std::vector<Retired>::iterator kept = m_retiredListeners.begin();
+    for (Retired& retired : m_retiredListeners)
+    {
+        retired.seenAtZero |= seenAtZero;
+        if (retired.seenAtZero == 3)
+            delete retired.listeners;
+        else
+            *kept++ = retired;
+    }
+    m_retiredListeners.erase(kept, m_retiredListeners.end());
+    if (m_retiredListeners.empty() && m_retiredListeners.capacity() > 64)
+        std::vector<Retired>().swap(m_retiredListeners); // after a burst of changes
+    m_hasRetiredListeners.store(!m_retiredListeners.empty(), std::memory_order_relaxed);
+}
+
+void ChangeNotifyingVariable::publish (Listeners* listeners)
+{
+    if (listeners && listeners->empty())
+    {
+        delete listeners;
+        listeners = nullptr;
+    }
+    const Listeners* previous = m_listeners.exchange(listeners, std::memory_order_seq_cst);
+    if (previous)
+    {
+        Retired retired = { previous, 0 };
+        m_retiredListeners.push_back(retired);
+        m_hasRetiredListeners.store(true, std::memory_order_relaxed);
+    }
+    reclaimRetiredListenersNotInUse();
+}
+
+ChangeNotifyingVariable::ListenerHandle ChangeNotifyingVariable::addChangeListener (OnChangeListener onChangeListener)
+{
+    std::lock_guard<std::mutex> lock (m_listenersWriteLock);
+    const Listeners* current = m_listeners.load(std::memory_order_relaxed);
+    Listeners* updated = current ? new Listeners(*current) : new Listeners;
+    Listener listener = { m_nextListenerHandle++, onChangeListener };
+    updated->push_back(listener);
+    publish(updated);
+    return listener.handle;
+}
+
+bool ChangeNotifyingVariable::removeChangeListener (ListenerHandle handle)
+{
+    std::lock_guard<std::mutex> lock (m_listenersWriteLock);
+    const Listeners* current = m_listeners.load(std::memory_order_relaxed);
+    if (!current)
+        return false;
+    Listeners* updated = new Listeners;
+    updated->reserve(current->size());
+    for (const Listener& listener : *current)
+        if (listener.handle != handle)
+            updated->push_back(listener);
+    if (updated->size() == current->size())
+    {
+        delete updated;
+        return false;
+    }
+    publish(updated);
+    return true;
+}
+
+size_t ChangeNotifyingVariable::changeListenerSize () const
+{
+    const Listeners* listeners = m_listeners.load(std::memory_order_acquire);
+    return listeners ? listeners->size() : 0;
+}
+
+void ChangeNotifyingVariable::removeAllChangeListeners ()
+{
+    std::lock_guard<std::mutex> lock (m_listenersWriteLock);
+    publish(nullptr);
+}
+
+size_t ChangeNotifyingVariable::listenersMemoryUsage ()
+{
+    std::lock_guard<std::mutex> lock (m_listenersWriteLock);
+    size_t bytes = m_retiredListeners.capacity() * sizeof(Retired);
+    const Listeners* current = m_listeners.load(std::memory_order_relaxed);
+    if (current)
+        bytes += sizeof(Listeners) + current->capacity() * sizeof(Listener);
+    for (const Retired& retired : m_retiredListeners)
+        bytes += sizeof(Listeners) + retired.listeners->capacity() * sizeof(Listener);
+    return bytes;
 }
 
-void ChangeNotifyingVariable::addChangeListener (OnChangeListener onChangeListener)
+void ChangeNotifyingVariable::reclaimRetiredListeners ()
 {
-    m_changeListeners.push_back(onChangeListener);
+    std::lock_guard<std::mutex> lock (m_listenersWriteLock);
+    for (const Retired& retired : m_retiredListeners)
+        delete retired.listeners;
+    std::vector<Retired>().swap(m_retiredListeners);
+    m_hasRetiredListeners.store(false, std::memory_order_relaxed);
 }
 
 }
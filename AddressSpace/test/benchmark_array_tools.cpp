@@ -0,0 +1,275 @@
+/*
+ * benchmark_array_tools.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  Compares the ArrayTools vector<->UaVariant conversions against the former implementation (element-wise copy into
+ *  a stack array which the setter then copied again; getters going through a temporary UaXxxArray; reproduced
+ *  below in namespace Former), for every supported array type and array sizes from 10 to 1M elements.
+ *  For UaString, UaByteString and UaVariant the rvalue (detaching) overloads are measured as well.
+ *  Then the bulk conversion kernels (ArrayToolsKernels) are compared: scalar vs. the ones chosen for this CPU.
+ *  Results are in ns per element.
+ *
+ *  Usage: benchmark_array_tools [maxSize] [elementsPerMeasurement]
+ */
+
+#include <ArrayTools.h>
+#include <ArrayToolsKernels.h>
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+
+typedef std::chrono::steady_clock Clock;
+
+using namespace AddressSpace::ArrayTools;
+
+//! The reference: this is how ArrayTools converted before the detach/memcpy rewrite.
+namespace Former
+{
+
+template<typename Type, typename ArrayType>
+void vectorToUaVariant( const std::vector<Type>& input, UaVariant& output, void (UaVariant::*setterFunction)(ArrayType& array, OpcUa_Boolean detach) )
+{
+    ArrayType array;
+    array.create( input.size() );
+    for (unsigned int i=0; i<input.size(); ++i)
+        array[i] = input[i];
+    (output.*setterFunction)(array, /*detach*/ OpcUa_False);
+}
+
+template<typename Type, typename ArrayType>
+void vectorToUaVariantByCopyTo( const std::vector<Type>& input, UaVariant& output, void (UaVariant::*setterFunction)(ArrayType& array, OpcUa_Boolean detach) )
+{
+    ArrayType array;
+    array.create( input.size() );
+    for (unsigned int i=0; i<input.size(); ++i)
+        input[i].copyTo(&array[i]);
+    (output.*setterFunction)(array, /*detach*/ OpcUa_False);
+}
+
+template<typename Type, typename ArrayType>
+UaStatus uaVariantToVector( const UaVariant& input, std::vector<Type>& output, OpcUa_StatusCode (UaVariant::*getterFunction)(ArrayType& array) const )
+{
+    ArrayType array;
+    UaStatus status = (input.*getterFunction)(array);
+    if (!status.isGood())
+        return status;
+    output.assign( array.length(), Type());
+    for (unsigned int i=0; i<array.length(); ++i)
+        output[i] = array[i];
+    return OpcUa_Good;
+}
+
+void byteVectorToUaVariant( const std::vector<OpcUa_Byte>& input, UaVariant& output )
+{
+    UaByteArray array;
+    if (input.size() > 0)
+        array = UaByteArray( reinterpret_cast<const char*>(&input[0]), input.size() );
+    output.setByteArray(array, /*detach*/ OpcUa_False);
+}
+
+UaStatus uaVariantToByteVector( const UaVariant& input, std::vector<OpcUa_Byte>& output )
+{
+    UaByteArray array;
+    UaStatus status = input.toByteArray(array);
+    if (!status.isGood())
+        return status;
+    output.assign( array.size(), 0);
+    std::copy( array.data(), array.data()+array.size(), output.begin());
+    return OpcUa_Good;
+}
+
+}
+
+template<typename Type>
+struct Conversions
+{
+    std::function<Type(size_t)> makeElement;
+    std::function<void(const std::vector<Type>&, UaVariant&)> formerToVariant;
+    std::function<void(const std::vector<Type>&, UaVariant&)> toVariant;
+    std::function<void(std::vector<Type>&&, UaVariant&)> movedToVariant; // empty where there's no rvalue overload
+    std::function<UaStatus(const UaVariant&, std::vector<Type>&)> formerFromVariant;
+    std::function<UaStatus(const UaVariant&, std::vector<Type>&)> fromVariant;
+};
+
+//! Runs f(r) for all repetitions and returns ns per element. The outputs are prepared up front so that destroying them is not measured.
+template<typename F>
+static double nsPerElement (size_t size, size_t repetitions, F f)
+{
+    Clock::time_point start = Clock::now();
+    for (size_t r=0; r<repetitions; ++r)
+        f(r);
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (size * repetitions);
+}
+
+template<typename Type>
+static void runBenchmark (const std::string& typeName, const Conversions<Type>& c, size_t maxSize, size_t elementsPerMeasurement)
+{
+    for (size_t size=10; size<=maxSize; size*=10)
+    {
+        const size_t repetitions = std::max<size_t>(1, elementsPerMeasurement / size);
+        std::vector<Type> input;
+        input.reserve(size);
+        for (size_t i=0; i<size; ++i)
+            input.push_back( c.makeElement(i) );
+
+        std::vector<UaVariant> variants (repetitions);
+        const double formerTo = nsPerElement(size, repetitions, [&](size_t r){ c.formerToVariant(input, variants[r]); });
+        variants.assign(repetitions, UaVariant());
+        const double nowTo = nsPerElement(size, repetitions, [&](size_t r){ c.toVariant(input, variants[r]); });
+
+        double movedTo = -1;
+        if (c.movedToVariant)
+        {
+            std::vector< std::vector<Type> > inputs (repetitions, input);
+            variants.assign(repetitions, UaVariant());
+            movedTo = nsPerElement(size, repetitions, [&](size_t r){ c.movedToVariant(std::move(inputs[r]), variants[r]); });
+        }
+
+        UaVariant variant;
+        c.toVariant(input, variant);
+        std::vector< std::vector<Type> > outputs (repetitions);
+        const double formerFrom = nsPerElement(size, repetitions, [&](size_t r){ c.formerFromVariant(variant, outputs[r]); });
+        outputs.assign(repetitions, std::vector<Type>());
+        const double nowFrom = nsPerElement(size, repetitions, [&](size_t r){ c.fromVariant(variant, outputs[r]); });
+        if (outputs.back().size() != size)
+        {
+            std::cout << typeName << ": conversion from UaVariant failed at size=" << size << std::endl;
+            exit(1);
+        }
+
+        std::cout << std::left << std::setw(14) << typeName << std::setw(9) << size <<
+            " toVariant[ns/el] former=" << std::setw(9) << formerTo << " now=" << std::setw(9) << nowTo;
+        if (movedTo >= 0)
+            std::cout << " moved=" << std::setw(9) << movedTo;
+        else
+            std::cout << std::setw(16) << "";
+        std::cout << " fromVariant[ns/el] former=" << std::setw(9) << formerFrom << " now=" << std::setw(9) << nowFrom << std::endl;
+    }
+}
+
+//! For the simple types where the vector element is the stack type.
+template<typename Type, typename ArrayType>
+static Conversions<Type> simpleConversions (
+        void (UaVariant::*setter)(ArrayType&, OpcUa_Boolean),
+        OpcUa_StatusCode (UaVariant::*getter)(ArrayType&) const,
+        void (*toVariant)(const std::vector<Type>&, UaVariant&),
+        UaStatus (*fromVariant)(const UaVariant&, std::vector<Type>&))
+{
+    Conversions<Type> c;
+    c.makeElement = [](size_t i){ return static_cast<Type>(i); };
+    c.formerToVariant = [setter](const std::vector<Type>& in, UaVariant& out){ Former::vectorToUaVariant(in, out, setter); };
+    c.toVariant = toVariant;
+    c.formerFromVariant = [getter](const UaVariant& in, std::vector<Type>& out){ return Former::uaVariantToVector(in, out, getter); };
+    c.fromVariant = fromVariant;
+    return c;
+}
+
+//! For UaString, UaByteString and UaVariant.
+template<typename Type, typename ArrayType>
+static Conversions<Type> complexConversions (
+        std::function<Type(size_t)> makeElement,
+        void (UaVariant::*setter)(ArrayType&, OpcUa_Boolean),
+        OpcUa_StatusCode (UaVariant::*getter)(ArrayType&) const)
+{
+    Conversions<Type> c;
+    c.makeElement = makeElement;
+    c.formerToVariant = [setter](const std::vector<Type>& in, UaVariant& out){ Former::vectorToUaVariantByCopyTo(in, out, setter); };
+    c.toVariant = [](const std::vector<Type>& in, UaVariant& out){ convertVectorToUaVariant(in, out); };
+    c.movedToVariant = [](std::vector<Type>&& in, UaVariant& out){ convertVectorToUaVariant(std::move(in), out); };
+    c.formerFromVariant = [getter](const UaVariant& in, std::vector<Type>& out){ return Former::uaVariantToVector(in, out, getter); };
+    c.fromVariant = [](const UaVariant& in, std::vector<Type>& out){ return convertUaVariantToVector(in, out); };
+    return c;
+}
+
+//! Also checks that the selected kernels give the same results as the scalar ones.
+static void runKernelsBenchmark (size_t maxSize, size_t elementsPerMeasurement)
+{
+    const KernelSet& scalar = scalarKernels();
+    const KernelSet& best = bestKernels();
+    std::cout << "kernels: " << scalar.name << " vs. " << best.name << std::endl;
+    for (size_t size=10; size<=maxSize; size*=10)
+    {
+        const size_t repetitions = std::max<size_t>(1, elementsPerMeasurement / size);
+        std::vector<unsigned char> booleans (size), normalizedScalar (size), normalizedBest (size);
+        std::vector<float> floats (size), narrowedScalar (size), narrowedBest (size);
+        std::vector<double> doubles (size), widenedScalar (size), widenedBest (size);
+        for (size_t i=0; i<size; ++i)
+        {
+            booleans[i] = (i % 3) * 0x7F;
+            floats[i] = i * 0.25f - 1000;
+            doubles[i] = i * 0.125 - 1000;
+        }
+
+        const double normalizeScalarNs = nsPerElement(size, repetitions, [&](size_t){ scalar.normalizeBooleans(&booleans[0], &normalizedScalar[0], size); });
+        const double normalizeBestNs = nsPerElement(size, repetitions, [&](size_t){ best.normalizeBooleans(&booleans[0], &normalizedBest[0], size); });
+        const double widenScalarNs = nsPerElement(size, repetitions, [&](size_t){ scalar.widenFloats(&floats[0], &widenedScalar[0], size); });
+        const double widenBestNs = nsPerElement(size, repetitions, [&](size_t){ best.widenFloats(&floats[0], &widenedBest[0], size); });
+        const double narrowScalarNs = nsPerElement(size, repetitions, [&](size_t){ scalar.narrowDoubles(&doubles[0], &narrowedScalar[0], size); });
+        const double narrowBestNs = nsPerElement(size, repetitions, [&](size_t){ best.narrowDoubles(&doubles[0], &narrowedBest[0], size); });
+
+        if (normalizedScalar != normalizedBest || widenedScalar != widenedBest ||
+            std::memcmp(&narrowedScalar[0], &narrowedBest[0], size * sizeof (float)) != 0)
+        {
+            std::cout << best.name << " kernels differ from the scalar ones at size=" << size << std::endl;
+            exit(1);
+        }
+
+        std::cout << std::left << std::setw(9) << size <<
+            " normalizeBooleans[ns/el] " << std::setw(9) << normalizeScalarNs << " -> " << std::setw(9) << normalizeBestNs <<
+            " widenFloats[ns/el] " << std::setw(9) << widenScalarNs << " -> " << std::setw(9) << widenBestNs <<
+            " narrowDoubles[ns/el] " << std::setw(9) << narrowScalarNs << " -> " << std::setw(9) << narrowBestNs << std::endl;
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    const size_t maxSize = argc > 1 ? std::atol(argv[1]) : 1000000;
+    const size_t elementsPerMeasurement = argc > 2 ? std::atol(argv[2]) : 2000000;
+    std::cout << "maxSize=" << maxSize << " elementsPerMeasurement=" << elementsPerMeasurement << std::endl;
+
+    Conversions<OpcUa_Boolean> booleans;
+    booleans.makeElement = [](size_t i){ return i%2 ? OpcUa_True : OpcUa_False; };
+    booleans.formerToVariant = [](const std::vector<OpcUa_Boolean>& in, UaVariant& out){ Former::vectorToUaVariant(in, out, &UaVariant::setBoolArray); };
+    booleans.toVariant = convertBooleanVectorToUaVariant;
+    booleans.formerFromVariant = [](const UaVariant& in, std::vector<OpcUa_Boolean>& out){ return Former::uaVariantToVector(in, out, &UaVariant::toBoolArray); };
+    booleans.fromVariant = convertUaVariantToBooleanVector;
+    runBenchmark("Boolean", booleans, maxSize, elementsPerMeasurement);
+
+    Conversions<OpcUa_Byte> bytes;
+    bytes.makeElement = [](size_t i){ return static_cast<OpcUa_Byte>(i); };
+    bytes.formerToVariant = Former::byteVectorToUaVariant;
+    bytes.toVariant = convertByteVectorToUaVariant;
+    bytes.formerFromVariant = Former::uaVariantToByteVector;
+    bytes.fromVariant = convertUaVariantToByteVector;
+    runBenchmark("Byte", bytes, maxSize, elementsPerMeasurement);
+
+    runBenchmark("SByte", simpleConversions<OpcUa_SByte>(&UaVariant::setSByteArray, &UaVariant::toSByteArray, convertVectorToUaVariant, convertUaVariantToVector), maxSize, elementsPerMeasurement);
+    runBenchmark("Int16", simpleConversions<OpcUa_Int16>(&UaVariant::setInt16Array, &UaVariant::toInt16Array, convertVectorToUaVariant, convertUaVariantToVector), maxSize, elementsPerMeasurement);
+    runBenchmark("UInt16", simpleConversions<OpcUa_UInt16>(&UaVariant::setUInt16Array, &UaVariant::toUInt16Array, convertVectorToUaVariant, convertUaVariantToVector), maxSize, elementsPerMeasurement);
+    runBenchmark("Int32", simpleConversions<OpcUa_Int32>(&UaVariant::setInt32Array, &UaVariant::toInt32Array, convertVectorToUaVariant, convertUaVariantToVector), maxSize, elementsPerMeasurement);
+    runBenchmark("UInt32", simpleConversions<OpcUa_UInt32>(&UaVariant::setUInt32Array, &UaVariant::toUInt32Array, convertVectorToUaVariant, convertUaVariantToVector), maxSize, elementsPerMeasurement);
+    runBenchmark("Int64", simpleConversions<OpcUa_Int64>(&UaVariant::setInt64Array, &UaVariant::toInt64Array, convertVectorToUaVariant, convertUaVariantToVector), maxSize, elementsPerMeasurement);
+    runBenchmark("UInt64", simpleConversions<OpcUa_UInt64>(&UaVariant::setUInt64Array, &UaVariant::toUInt64Array, convertVectorToUaVariant, convertUaVariantToVector), maxSize, elementsPerMeasurement);
+    runBenchmark("Float", simpleConversions<OpcUa_Float>(&UaVariant::setFloatArray, &UaVariant::toFloatArray, convertVectorToUaVariant, convertUaVariantToVector), maxSize, elementsPerMeasurement);
+    runBenchmark("Double", simpleConversions<OpcUa_Double>(&UaVariant::setDoubleArray, &UaVariant::toDoubleArray, convertVectorToUaVariant, convertUaVariantToVector), maxSize, elementsPerMeasurement);
+
+    runBenchmark("UaString", complexConversions<UaString>(
+        [](size_t i){ return UaString(("element " + std::to_string(i)).c_str()); },
+        &UaVariant::setStringArray, &UaVariant::toStringArray), maxSize, elementsPerMeasurement);
+    runBenchmark("UaByteString", complexConversions<UaByteString>(
+        [](size_t i){ std::string s ("element " + std::to_string(i)); return UaByteString(s.size(), reinterpret_cast<OpcUa_Byte*>(&s[0])); },
+        &UaVariant::setByteStringArray, &UaVariant::toByteStringArray), maxSize, elementsPerMeasurement);
+    runBenchmark("UaVariant", complexConversions<UaVariant>(
+        [](size_t i){ UaVariant v; v.setUInt32(i); return v; },
+        &UaVariant::setVariantArray, &UaVariant::toVariantArray), maxSize, elementsPerMeasurement);
+
+    runKernelsBenchmark(maxSize, elementsPerMeasurement);
+}
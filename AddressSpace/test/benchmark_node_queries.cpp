@@ -0,0 +1,226 @@
+/*
+ * benchmark_node_queries.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  Compares finding nodes through the NodeIndex against walking the address space the way
+ *  findAllObjectsByPatternInNodeManager did (recursively from the Objects folder, copying the string id of every
+ *  node, matching it with the regex and dynamic_cast'ing it; reproduced below in namespace Legacy). The address
+ *  space is synthetic and needs no OPC-UA toolkit: crates of boards of channels, each channel with a few
+ *  variables, as plain polymorphic nodes. The index side runs the queries of ASNodeIndexQueries.h, the very
+ *  templates which the find...InNodeManager functions of ASNodeQueries.h forward to (those are checked on a
+ *  server by the CI test case test_node_queries).
+ *  Queries: all objects of a type, as unlinkAllDevices() does for every class; a regex, a glob and a prefix
+ *  for the channels of one board. Both must find the same nodes, otherwise the benchmark fails.
+ *
+ *  Usage: benchmark_node_queries [numCrates] [numRepetitions]
+ */
+
+#include <ASNodeIndexQueries.h>
+
+#include <boost/xpressive/xpressive.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+struct Node
+{
+    Node(const std::string& id, bool isObject): id(id), isObject(isObject) {}
+    virtual ~Node() {}
+    std::string id;
+    bool isObject;
+    std::vector<Node*> children;
+};
+struct Crate: Node { explicit Crate(const std::string& id): Node(id, true) {} };
+struct Board: Node { explicit Board(const std::string& id): Node(id, true) {} };
+struct Channel: Node { explicit Channel(const std::string& id): Node(id, true) {} };
+struct Variable: Node { explicit Variable(const std::string& id): Node(id, false) {} };
+
+namespace AddressSpace
+{
+template<>
+struct NodeIndexTraits<Node>
+{
+    static bool stringId (Node* node, std::string& id) { id = node->id; return true; }
+    static bool isObject (Node* node) { return node->isObject; }
+};
+}
+
+typedef AddressSpace::NodeIndex<Node> Index;
+
+namespace Legacy
+{
+
+//! As findAllByRegex, restricted to objects
+template<typename T>
+unsigned int findAllByRegex (Node* startNode, const boost::xpressive::sregex & expression, std::vector<T*> &storage)
+{
+    unsigned int numAdded = 0;
+    if (startNode->isObject)
+    {
+        std::string sId = startNode->id;
+        boost::xpressive::smatch what;
+        if (boost::xpressive::regex_match( sId, what, expression ))
+        {
+            T* t = dynamic_cast<T*>(startNode);
+            if (t)
+            {
+                storage.push_back( t );
+                numAdded++;
+            }
+        }
+        for (Node* child : startNode->children)
+            numAdded += findAllByRegex(child, expression, storage);
+    }
+    return numAdded;
+}
+
+template<typename T>
+unsigned int findAllByPattern (Node* root, const std::string& pattern, std::vector<T*> &storage)
+{
+    return findAllByRegex(root, boost::xpressive::sregex::compile(pattern), storage);
+}
+
+}
+
+//! Returns the time per run, in ms
+static double measure (unsigned int numRepetitions, const std::function<void()>& run)
+{
+    Clock::time_point start = Clock::now();
+    for (unsigned int i = 0; i < numRepetitions; ++i)
+        run();
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / numRepetitions;
+}
+
+template<typename T>
+static bool sameNodes (std::vector<T*> a, std::vector<T*> b)
+{
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    return a == b;
+}
+
+int main (int argc, char* argv[])
+{
+    const unsigned int numCrates = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20;
+    const unsigned int numRepetitions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5;
+    const unsigned int numBoards = 50, numChannels = 128;
+    const char* variables[] = {"voltage", "current", "temperature", "status"};
+
+    std::vector<std::unique_ptr<Node>> nodes;
+    Node objectsFolder ("", true);
+    for (unsigned int crate = 0; crate < numCrates; ++crate)
+    {
+        nodes.emplace_back(new Crate("crate" + std::to_string(crate)));
+        objectsFolder.children.push_back(nodes.back().get());
+        Node* crateNode = nodes.back().get();
+        for (unsigned int board = 0; board < numBoards; ++board)
+        {
+            nodes.emplace_back(new Board(crateNode->id + ".board" + std::to_string(board)));
+            crateNode->children.push_back(nodes.back().get());
+            Node* boardNode = nodes.back().get();
+            for (unsigned int channel = 0; channel < numChannels; ++channel)
+            {
+                nodes.emplace_back(new Channel(boardNode->id + ".ch" + std::to_string(channel)));
+                boardNode->children.push_back(nodes.back().get());
+                Node* channelNode = nodes.back().get();
+                for (const char* variable : variables)
+                {
+                    nodes.emplace_back(new Variable(channelNode->id + "." + variable));
+                    channelNode->children.push_back(nodes.back().get());
+                }
+            }
+        }
+    }
+
+    Index index;
+    const double msIndexing = measure(1, [&]()
+    {
+        for (const std::unique_ptr<Node>& node : nodes)
+            index.add(node.get());
+    });
+    const double msFirstPrefixQuery = measure(1, [&]()
+    {
+        std::vector<Channel*> found;
+        AddressSpace::findAllIndexedObjectsByPrefix(index, "crate0.board0.", found);
+    });
+
+    std::cout << "nodes: " << nodes.size() << std::fixed << std::setprecision(3) << std::endl <<
+            "indexing while adding: " << msIndexing << " ms, sorting ids at the first prefix query: " << msFirstPrefixQuery << " ms" << std::endl <<
+            std::setw(48) << "query" << std::setw(10) << "found" << std::setw(14) << "walk [ms]" << std::setw(14) << "index [ms]" <<
+            std::setw(10) << "speedup" << std::endl;
+
+    bool failed = false;
+    auto compare = [&](const std::string& name, size_t numFound, bool same, double msLegacy, double msIndexed)
+    {
+        std::cout << std::setw(48) << name << std::setw(10) << numFound << std::setw(14) << msLegacy << std::setw(14) << msIndexed <<
+                std::setw(10) << std::setprecision(1) << msLegacy / msIndexed << std::setprecision(3) << (same ? "" : "  DIFFERENT") << std::endl;
+        failed = failed || !same;
+    };
+
+    {
+        // unlinkAllDevices(): every class with device logic
+        std::vector<Crate*> legacyCrates, crates;
+        std::vector<Board*> legacyBoards, boards;
+        std::vector<Channel*> legacyChannels, channels;
+        const double msLegacy = measure(numRepetitions, [&]()
+        {
+            legacyCrates.clear(); legacyBoards.clear(); legacyChannels.clear();
+            Legacy::findAllByPattern(&objectsFolder, ".*", legacyCrates);
+            Legacy::findAllByPattern(&objectsFolder, ".*", legacyBoards);
+            Legacy::findAllByPattern(&objectsFolder, ".*", legacyChannels);
+        });
+        const double msIndexed = measure(numRepetitions, [&]()
+        {
+            crates.clear(); boards.clear(); channels.clear();
+            AddressSpace::findAllIndexedObjectsByPattern(index, ".*", crates);
+            AddressSpace::findAllIndexedObjectsByPattern(index, ".*", boards);
+            AddressSpace::findAllIndexedObjectsByPattern(index, ".*", channels);
+        });
+        compare("\".*\" for Crate, Board and Channel", crates.size() + boards.size() + channels.size(),
+                sameNodes(legacyCrates, crates) && sameNodes(legacyBoards, boards) && sameNodes(legacyChannels, channels),
+                msLegacy, msIndexed);
+    }
+
+    const std::string board = "crate" + std::to_string(numCrates / 2) + ".board17";
+    {
+        const std::string pattern = "crate" + std::to_string(numCrates / 2) + "\\.board17\\.ch1[0-9]+";
+        std::vector<Channel*> legacyFound, found;
+        const double msLegacy = measure(numRepetitions, [&]() { legacyFound.clear(); Legacy::findAllByPattern(&objectsFolder, pattern, legacyFound); });
+        const double msIndexed = measure(numRepetitions, [&]() { found.clear(); AddressSpace::findAllIndexedObjectsByPattern(index, pattern, found); });
+        compare("regex " + pattern, found.size(), sameNodes(legacyFound, found), msLegacy, msIndexed);
+    }
+    {
+        const std::string glob = board + ".ch1?";
+        std::vector<Channel*> legacyFound, found;
+        const std::string pattern = "crate" + std::to_string(numCrates / 2) + "\\.board17\\.ch1.";
+        const double msLegacy = measure(numRepetitions, [&]() { legacyFound.clear(); Legacy::findAllByPattern(&objectsFolder, pattern, legacyFound); });
+        const double msIndexed = measure(numRepetitions, [&]() { found.clear(); AddressSpace::findAllIndexedObjectsByGlob(index, glob, found); });
+        compare("glob " + glob, found.size(), sameNodes(legacyFound, found), msLegacy, msIndexed);
+    }
+    {
+        const std::string prefix = board + ".";
+        std::vector<Channel*> legacyFound, found;
+        const std::string pattern = "crate" + std::to_string(numCrates / 2) + "\\.board17\\..*";
+        const double msLegacy = measure(numRepetitions, [&]() { legacyFound.clear(); Legacy::findAllByPattern(&objectsFolder, pattern, legacyFound); });
+        const double msIndexed = measure(numRepetitions, [&]() { found.clear(); AddressSpace::findAllIndexedObjectsByPrefix(index, prefix, found); });
+        compare("prefix " + prefix, found.size(), sameNodes(legacyFound, found), msLegacy, msIndexed);
+    }
+
+    if (failed)
+    {
+        std::cout << "queries differ, FAILED" << std::endl;
+        return 1;
+    }
+    return 0;
+}
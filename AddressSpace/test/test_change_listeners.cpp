@@ -0,0 +1,102 @@
+/*
+ * test_change_listeners.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  Adds and removes change listeners of a ChangeNotifyingVariable over and over, first alone and then while other
+ *  threads keep notifying the listeners, and checks that the memory taken by listener arrays stays bounded: the
+ *  arrays replaced by every add/remove must get freed once no notification may be using them, not pile up until
+ *  the variable goes.
+ *
+ *  Usage: test_change_listeners [numIterations] [numNotifyingThreads]
+ */
+
+#include <ChangeNotifyingVariable.h>
+
+#include <LogIt.h>
+
+#include <iostream>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+
+int main (int argc, char* argv[])
+{
+    const unsigned int numIterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    const unsigned int numNotifyingThreads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+    Log::initializeLogging(Log::WRN);
+
+    AddressSpace::ChangeNotifyingVariable variable (
+        UaNodeId("test_change_listeners", 2), "test_change_listeners", 2, UaVariant(), OpcUa_AccessLevels_CurrentRead, nullptr);
+    std::atomic<unsigned long long> numCalls (0);
+    auto listener = [&numCalls](AddressSpace::ChangeNotifyingVariable&, const UaDataValue&) { numCalls++; };
+    // one listener stays all the time, so that there's always an array to retire
+    variable.addChangeListener(listener);
+    const size_t baseline = variable.listenersMemoryUsage();
+    /* Without reclamation every add and every remove would retire an array of one or two listeners, so the memory
+     * would grow by about 2 * numIterations * baseline. With it, arrays are only kept while a notification which
+     * began before they were retired is running - on a loaded machine a notifying thread may get preempted for a
+     * while, so allow some of that, but nothing near growing with the number of changes. */
+    const size_t bound = baseline + 2 * numIterations * baseline / 20;
+    // freed: all that may stay is the (small) list of retired arrays itself
+    const size_t freed = baseline + 64 * sizeof(void*);
+
+    bool failed = false;
+    auto churn = [&](const char* what)
+    {
+        size_t peak = 0;
+        for (unsigned int i = 0; i < numIterations; ++i)
+        {
+            variable.removeChangeListener(variable.addChangeListener(listener));
+            if (i % 64 == 0)
+                peak = std::max(peak, variable.listenersMemoryUsage());
+        }
+        const size_t after = variable.listenersMemoryUsage();
+        peak = std::max(peak, after);
+        std::cout << what << ": " << numIterations << " times added and removed a listener, listener arrays took at most " <<
+            peak << " bytes, " << after << " at the end (" << baseline << " with the one listener only)" << std::endl;
+        if (peak > bound)
+        {
+            std::cout << "  more than " << bound << " bytes, FAILED" << std::endl;
+            failed = true;
+        }
+    };
+
+    churn("no notifications");
+    if (variable.listenersMemoryUsage() > freed)
+    {
+        std::cout << "  replaced arrays not freed though no notification was in flight, FAILED" << std::endl;
+        failed = true;
+    }
+
+    std::atomic<bool> stop (false);
+    std::vector<std::thread> notifiers;
+    for (unsigned int i = 0; i < numNotifyingThreads; ++i)
+        notifiers.emplace_back([&]()
+        {
+            const UaDataValue value;
+            while (!stop)
+                variable.notifyChangeListeners(value);
+        });
+    churn("notifications from other threads");
+    stop = true;
+    for (std::thread& notifier : notifiers)
+        notifier.join();
+    std::cout << numCalls << " listener calls" << std::endl;
+
+    // with the notifications gone quiet, the next change frees everything that was left
+    variable.removeChangeListener(variable.addChangeListener(listener));
+    if (variable.listenersMemoryUsage() > freed)
+    {
+        std::cout << "replaced arrays not freed after the notifications stopped, FAILED" << std::endl;
+        failed = true;
+    }
+
+    if (failed)
+        return 1;
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,124 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * AsyncEvaluator.h
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALCULATEDVARIABLES_INCLUDE_ASYNCEVALUATOR_H_
+#define CALCULATEDVARIABLES_INCLUDE_ASYNCEVALUATOR_H_
+
+#include <list>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <condition_variable>
+#include <unordered_map>
+
+#include <ParserVariable.h>
+
+namespace Quasar
+{
+class ThreadPool;
+}
+
+namespace CalculatedVariables
+{
+
+/* Optional asynchronous evaluation of CalculatedVariables.
+ *
+ * When running, a change of an input doesn't evaluate the formulas depending on it in the thread which made
+ * the change (typically a device logic / hardware polling thread). Instead, the CalculatedVariables to
+ * re-evaluate are marked dirty in their synchronization domain, and the domain is queued for a pool of evaluation
+ * threads. Changes arriving before the domain gets evaluated are coalesced: a dirty CalculatedVariable is
+ * evaluated only once, with the latest values of its inputs. Optionally the evaluations of every domain are
+ * limited to a maximum rate. */
+class AsyncEvaluator
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /** Starts the evaluation threads for the given domains. maxRatePerDomain is in evaluations per second,
+     * 0 means unlimited. */
+    static void start(const std::vector<SharedSynchronizer>& domains, unsigned int numThreads, double maxRatePerDomain);
+
+    //! Stops the evaluation threads; changes still pending are dropped. From then on evaluation is synchronous again.
+    static void stop();
+
+    //! Non-null when running.
+    static AsyncEvaluator* instance() { return s_instance.load(std::memory_order_acquire); }
+
+    /** Marks the given variables dirty and queues their domains for evaluation. Must be called with their
+     * synchronizers locked. Returns false (and does nothing) if a variable's domain isn't known to the evaluator. */
+    bool markDirty(const std::list<CalculatedVariable*>& variables);
+
+    //! The shortest time between two evaluations of a domain; zero if the rate isn't limited.
+    Clock::duration minInterval() const { return m_minInterval; }
+
+private:
+    struct Domain
+    {
+        Domain(Synchronizer* synchronizer): synchronizer(synchronizer), isQueued(false) {}
+        Synchronizer* const synchronizer;
+        //! Protected by the synchronizer.
+        std::vector<CalculatedVariable*> dirty;
+        //! Protected by m_lock.
+        bool isQueued;
+        Clock::time_point lastEvaluation;
+    };
+
+    struct Due
+    {
+        Clock::time_point when;
+        Domain* domain;
+        bool operator<(const Due& other) const { return when > other.when; } // earliest on top
+    };
+
+    AsyncEvaluator(const std::vector<SharedSynchronizer>& domains, unsigned int numThreads, double maxRatePerDomain);
+    ~AsyncEvaluator();
+
+    void queue(Domain* domain);
+    void submit(Domain* domain);
+    void evaluate(Domain* domain);
+    //! Body of the thread which submits rate-limited domains when they are due.
+    void delayDueDomains();
+
+    static std::atomic<AsyncEvaluator*> s_instance;
+
+    std::unordered_map<Synchronizer*, std::unique_ptr<Domain>> m_domains;
+    const Clock::duration m_minInterval;
+
+    std::unique_ptr<Quasar::ThreadPool> m_pool;
+
+    std::mutex m_lock;
+    std::condition_variable m_dueChanged;
+    std::priority_queue<Due> m_due;
+    bool m_quit;
+    std::thread m_delayThread;
+
+    std::atomic<size_t> m_numChanges;
+    std::atomic<size_t> m_numEvaluations;
+    std::atomic<size_t> m_numFormulasEvaluated;
+};
+
+}
+
+#endif /* CALCULATEDVARIABLES_INCLUDE_ASYNCEVALUATOR_H_ */
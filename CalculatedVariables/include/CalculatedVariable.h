@@ -22,14 +22,19 @@
 #ifndef CALCULATEDVARIABLES_INCLUDE_CALCULATEDVARIABLE_H_
 #define CALCULATEDVARIABLES_INCLUDE_CALCULATEDVARIABLE_H_
 
+#include <list>
+#include <memory>
+
 #include <ChangeNotifyingVariable.h>
-#include <muParser.h>
+#include <FormulaEvaluator.h>
 #include <ParserVariableRequestUserData.h>
 
 namespace CalculatedVariables
 {
 
 class ParserVariable;
+class Synchronizer;
+class BytecodeFormula;
 
 class CalculatedVariable: public AddressSpace::ChangeNotifyingVariable
 {
@@ -47,6 +52,11 @@ public:
         UaMutexRefCounted* pSharedMutex = NULL);
 
     void update();
+    //! Like update(), but the value formula was already evaluated (e.g. in a batch), giving value
+    void update(double value);
+
+    //! The value formula if it's evaluated by the bytecode backend, nullptr otherwise (e.g. muParser)
+    BytecodeFormula* bytecodeValueFormula() const { return m_bytecodeValueFormula; }
 
     void addDependentVariableForValue(ParserVariable* variable);
     void addDependentVariableForStatus(ParserVariable* variable);
@@ -59,14 +69,32 @@ public:
 
     bool isConstant () const { return m_valueVariables.size() + m_statusVariables.size() == 0; }
 
+    /** Level in the calculation graph: 0 if the formulas read no other CalculatedVariable, otherwise one more than
+     * the highest level among those read. Variables of the same level don't depend on each other.
+     * See Engine::computeTopologicalOrder() */
+    size_t topologicalRank() const { return m_topologicalRank; }
+    void setTopologicalRank(size_t rank) { m_topologicalRank = rank; }
+
+    //! True while waiting for evaluation in an ongoing propagation of changes, see ParserVariable
+    bool isScheduled() const { return m_isScheduled; }
+    void setScheduled(bool scheduled) { m_isScheduled = scheduled; }
+
+    //! Of the synchronization domain this variable is evaluated in, see Engine::setupSynchronization()
+    Synchronizer* synchronizer() const { return m_synchronizer; }
+    void setSynchronizer(Synchronizer* synchronizer) { m_synchronizer = synchronizer; }
+
 private:
-    void initializeParser(
-            mu::Parser& parser,
+    //! Shared by both update()s: value is where the value formula result is, nullptr to evaluate it
+    void update(const double* value);
+
+    //! Uses the backend chosen in the Engine; throws std::runtime_error (after logging the details) if the formula is wrong
+    std::unique_ptr<FormulaEvaluator> createEvaluator(
             const std::string& formula,
             ParserVariableRequestUserData::Type formulaType);
 
     /* Value-Formula part */
-    mu::Parser m_valueParser;
+    std::unique_ptr<FormulaEvaluator> m_valueEvaluator;
+    BytecodeFormula* m_bytecodeValueFormula;
     std::list<ParserVariable*> m_valueVariables;
 
     //! True if the output should be boolean instead of double (e.g. when logical operators are used in formula)
@@ -74,13 +102,17 @@ private:
 
     /* Status-Formula part */
     bool m_hasStatusFormula;
-    mu::Parser m_statusParser;
+    std::unique_ptr<FormulaEvaluator> m_statusEvaluator;
     //! Points to ParserVariables which are used by statusFormula
     std::list<ParserVariable*> m_statusVariables;
 
     //! Keeping this reference is necessary to efficiently construct synchronization graph
     ParserVariable* m_notifiedVariable;
 
+    size_t m_topologicalRank;
+    bool m_isScheduled;
+    Synchronizer* m_synchronizer;
+
 };
 
 }
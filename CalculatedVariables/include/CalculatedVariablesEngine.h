@@ -23,11 +23,17 @@
 #define CALCULATEDVARIABLES_INCLUDE_CALCULATEDVARIABLESENGINE_H_
 
 #include <list>
+#include <unordered_map>
+#include <vector>
+#include <chrono>
+#include <mutex>
 
 #include <uanodeid.h>
 
 #include <Configuration.hxx>
 #include <ParserVariable.h>
+#include <FormulaEvaluator.h>
+#include <FormulaElaboration.h>
 
 // forward-decls
 namespace AddressSpace
@@ -60,10 +66,14 @@ public:
 
     static void setupSynchronization();
 
+    /** Ranks all CalculatedVariables so that each one comes after every CalculatedVariable its formulas read,
+     * then switches ParserVariables to glitch-free (ordered) propagation. Done at the end of setupSynchronization. */
+    static void computeTopologicalOrder();
+
     static void optimize ();
 
-    //! Perform a dfs, each found node is bound to particular synchronization domain
-    static void dfsAndSetSynchronizer(ParserVariable& pv, SharedSynchronizer& synchronizer);
+    //! Domain sizes and lock contention so far; also printed by printInstantiationStatistics() and at shutdown
+    static void printSynchronizationStatistics ();
 
     //! Resolves all dollar operators until a formuls is free of them.
     static std::string elaborateFormula (
@@ -77,12 +87,41 @@ public:
     static bool isConstantDefined (const std::string& id);
     static double getValueOfConstant (const std::string& id);
 
+    //! Should be chosen before any CalculatedVariable gets instantiated. MuParser is the default.
+    static void setFormulaBackend (FormulaBackend backend) { s_formulaBackend = backend; }
+    static FormulaBackend formulaBackend () { return s_formulaBackend; }
+
+    //! For the statistics: which backend a formula ended up with
+    static void countFormula (FormulaBackend backend);
+
+    /** Should be chosen before setupSynchronization(). With numThreads > 0, changes of inputs only mark the
+     * dependent CalculatedVariables dirty and a pool of numThreads evaluates them, coalescing changes which arrive
+     * meanwhile. maxRatePerDomain limits evaluations per synchronization domain per second (0 means unlimited).
+     * By default (numThreads == 0) evaluation is synchronous, in the thread making the change. */
+    static void setAsyncEvaluation (unsigned int numThreads, double maxRatePerDomain);
+
+    //! Stops asynchronous evaluation, if it was running. To be called before the address space gets destroyed.
+    static void shutdown ();
+
 private:
+    //! Keeps the ParserVariables: their addresses must stay stable and optimize() erases from the middle
     static std::list <ParserVariable> s_parserVariables;
+    //! Index of s_parserVariables by (escaped) name, for resolving formula variables
+    static std::unordered_map <std::string, ParserVariable*> s_parserVariablesByName;
     static std::map <std::string, double> s_parserConstants;
-    static size_t s_numSynchronizers;
+    //! Variables and constants get registered from the threads of parallel configuration
+    static std::mutex s_registrationLock;
+    static std::vector<SharedSynchronizer> s_synchronizers;
     static size_t s_numCalculatedVariables;
-    static std::map<std::string, std::string> s_genericFormulas;
+    //! Resolves the dollar expressions, keeps the generic formulas
+    static FormulaElaborator s_formulaElaborator;
+    static FormulaBackend s_formulaBackend;
+    static size_t s_numBytecodeFormulas;
+    static size_t s_numMuParserFormulas;
+    //! Total time spent instantiating CalculatedVariables, for the startup statistics
+    static std::chrono::steady_clock::duration s_instantiationTime;
+    static unsigned int s_asyncEvaluationThreads;
+    static double s_asyncEvaluationMaxRate;
 };
 
 } /* namespace CalculatedVariables */
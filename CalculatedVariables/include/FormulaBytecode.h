@@ -0,0 +1,148 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * FormulaBytecode.h
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALCULATEDVARIABLES_INCLUDE_FORMULABYTECODE_H_
+#define CALCULATEDVARIABLES_INCLUDE_FORMULABYTECODE_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+#include <FormulaEvaluator.h>
+
+namespace CalculatedVariables
+{
+
+/* The bytecode backend of CalculatedVariables.
+ *
+ * It understands the subset of the muParser syntax which is documented for CalculatedVariables: numbers, variables,
+ * the _pi and _e constants, + - * / ^, unary + and -, comparisons, && ||, the ternary ?: and the built-in functions
+ * (sin ... atanh, log2, log10, log, ln, exp, sqrt, sign, rint, abs, atan2, min, max, sum, avg), with muParser's
+ * precedence rules. Anything else makes compile() return nullptr so that the caller can fall back to muParser,
+ * which then also reports syntax errors as before.
+ *
+ * Constant sub-expressions are folded at compile time. The compiled program doesn't refer to the variables
+ * directly but through slots, so formulas of the same shape (e.g. a generic formula applied to many objects)
+ * share a single program. */
+
+class FormulaProgram;
+
+class BytecodeFormula: public FormulaEvaluator
+{
+public:
+    //! Returns true and sets value if name is a (user) constant.
+    typedef std::function<bool(const std::string& name, double& value)> ConstantResolver;
+    //! Returns where the value of the given variable is kept; may throw if there's no such variable.
+    typedef std::function<const double*(const std::string& name)> VariableResolver;
+
+    /** Returns nullptr if the formula can't be compiled. Variables are resolved only once parsing succeeded,
+     * each distinct one once, in the order of appearance. */
+    static std::unique_ptr<BytecodeFormula> compile(
+            const std::string& formula,
+            const ConstantResolver& resolveConstant,
+            const VariableResolver& resolveVariable);
+
+    virtual double evaluate();
+
+    const std::vector<const double*>& variables() const { return m_variables; }
+    const std::shared_ptr<const FormulaProgram>& program() const { return m_program; }
+
+    //! Number of distinct programs compiled so far (i.e. formulas of distinct shapes).
+    static size_t numDistinctPrograms();
+
+    /** Evaluates n formulas which all have the same program (e.g. instances of one generic formula) together,
+     * a batch of instances at a time, instruction by instruction. Gives the same results as evaluate() of each. */
+    static void evaluateBatch(BytecodeFormula* const* formulas, size_t n, double* results);
+
+private:
+    BytecodeFormula(const std::shared_ptr<const FormulaProgram>& program, const std::vector<const double*>& variables);
+
+    std::shared_ptr<const FormulaProgram> m_program;
+    std::vector<const double*> m_variables;
+};
+
+class FormulaProgram
+{
+public:
+    enum Opcode: uint8_t
+    {
+        PushConstant, PushVariable,
+        /* binary operators: for each there's the form taking both operands from the stack, then the ones where
+         * the right operand is a variable or a constant (keep this order, see the interpreter) */
+        Add, AddVariable, AddConstant,
+        Subtract, SubtractVariable, SubtractConstant,
+        Multiply, MultiplyVariable, MultiplyConstant,
+        Divide, DivideVariable, DivideConstant,
+        Power, PowerVariable, PowerConstant,
+        Less, LessVariable, LessConstant,
+        LessEqual, LessEqualVariable, LessEqualConstant,
+        Greater, GreaterVariable, GreaterConstant,
+        GreaterEqual, GreaterEqualVariable, GreaterEqualConstant,
+        Equal, EqualVariable, EqualConstant,
+        NotEqual, NotEqualVariable, NotEqualConstant,
+        And, AndVariable, AndConstant,
+        Or, OrVariable, OrConstant,
+        Negate,
+        Call1, Call2, Sum, Average, Minimum, Maximum,
+        JumpIfZero, Jump,
+        Return // the last instruction of every program
+    };
+
+    struct Instruction
+    {
+        Opcode op;
+        uint32_t operand; // variable slot, number of arguments or jump target
+        union
+        {
+            double value;
+            double (*function1)(double);
+            double (*function2)(double, double);
+        };
+    };
+
+    enum { MaxStackDepth = 64 };
+    //! Max number of instances runBatch() takes
+    enum { BatchSize = 32 };
+
+    FormulaProgram(const std::vector<Instruction>& code, size_t stackDepth);
+
+    double run(const double* const* variables) const;
+
+    /** Runs the program for n (at most BatchSize) instances, variables[i] are the variables of instance i.
+     * The stack is kept as structure-of-arrays (a row of BatchSize values per stack element) so that every
+     * instruction is a loop over the instances, which the compiler vectorizes. Programs with jumps (the ternary
+     * operator) can't be run in lockstep and get run() for every instance. */
+    void runBatch(const double* const* const* variables, size_t n, double* results) const;
+
+    const std::vector<Instruction>& code() const { return m_code; }
+    size_t stackDepth() const { return m_stackDepth; }
+
+private:
+    const std::vector<Instruction> m_code;
+    const size_t m_stackDepth;
+    bool m_hasJumps;
+};
+
+}
+
+#endif /* CALCULATEDVARIABLES_INCLUDE_FORMULABYTECODE_H_ */
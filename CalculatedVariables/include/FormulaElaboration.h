@@ -0,0 +1,77 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * FormulaElaboration.h
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALCULATEDVARIABLES_INCLUDE_FORMULAELABORATION_H_
+#define CALCULATEDVARIABLES_INCLUDE_FORMULAELABORATION_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace CalculatedVariables
+{
+
+extern const std::string DashSignVariableRepr;
+extern const std::string SlashSignVariableRepr;
+
+//! Replaces escaped dashes and slashes ("\-", "\/") the way they are named in the parser
+std::string escapeSpecialCharactersInFormula (const std::string& inputFormula);
+//! Replaces dashes and slashes of an address-space name so that it can be used in a formula
+std::string escapeSpecialCharactersInParserVariableName (const std::string& input);
+
+/* Resolves the meta-functions (dollar expressions) of formulas: $_ / $thisObjectAddress, $parentObjectAddress(...)
+ * and $applyGenericFormula(...).
+ *
+ * A formula text is tokenized once, into pieces of plain text and dollar expressions (a "template"), the templates
+ * are kept by text - the formula of a CalculatedVariable of a class is typically the same for all its objects -
+ * and for every generic formula. Elaborating is then a single pass over the pieces.
+ * Errors are reported by throwing std::runtime_error with the message to log. */
+class FormulaElaborator
+{
+public:
+    FormulaElaborator() {}
+    FormulaElaborator(const FormulaElaborator&) = delete;
+    FormulaElaborator& operator=(const FormulaElaborator&) = delete;
+
+    //! Returns false if there's a generic formula of that id already. Not to be called concurrently with elaborate().
+    bool addGenericFormula (const std::string& id, const std::string& formula);
+
+    //! Thread-safe
+    std::string elaborate (const std::string& formula, const std::string& parentObjectAddress);
+
+    struct Piece;
+    typedef std::vector<Piece> Template;
+
+private:
+    std::shared_ptr<const Template> templateOf (const std::string& formula);
+    void expand (const Template& pieces, const std::string& parentObjectAddress, unsigned int depth, std::string& output) const;
+
+    std::unordered_map<std::string, std::shared_ptr<const Template>> m_genericFormulas;
+
+    std::mutex m_templatesLock;
+    std::unordered_map<std::string, std::shared_ptr<const Template>> m_templates;
+};
+
+}
+
+#endif /* CALCULATEDVARIABLES_INCLUDE_FORMULAELABORATION_H_ */
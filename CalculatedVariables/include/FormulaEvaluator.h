@@ -0,0 +1,45 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * FormulaEvaluator.h
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CALCULATEDVARIABLES_INCLUDE_FORMULAEVALUATOR_H_
+#define CALCULATEDVARIABLES_INCLUDE_FORMULAEVALUATOR_H_
+
+namespace CalculatedVariables
+{
+
+//! Which evaluator a CalculatedVariable formula is given to.
+enum class FormulaBackend
+{
+    MuParser, //!< every formula gets its own mu::Parser (the default)
+    Bytecode  //!< opt-in (--calculated_variables_backend bytecode): formulas are compiled to (shared) bytecode; those using features the compiler doesn't know fall back to muParser
+};
+
+//! A formula, ready to be evaluated. The inputs are bound (by pointer) when the evaluator gets created.
+class FormulaEvaluator
+{
+public:
+    virtual ~FormulaEvaluator() {}
+    virtual double evaluate() = 0;
+};
+
+}
+
+#endif /* CALCULATEDVARIABLES_INCLUDE_FORMULAEVALUATOR_H_ */
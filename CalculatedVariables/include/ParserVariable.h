@@ -24,19 +24,49 @@
 
 #include <string>
 #include <list>
+#include <vector>
+#include <memory>
+#include <atomic>
 
 #include <boost/thread/recursive_mutex.hpp>
 
-// forward-decls
-namespace AddressSpace
-{
-class ChangeNotifyingVariable;
-}
+#include <ChangeNotifyingVariable.h>
 
 namespace CalculatedVariables
 {
 
-typedef boost::recursive_mutex Synchronizer;
+/* Mutual exclusion of a synchronization domain, i.e. of a set of CalculatedVariables which read each other.
+ * Besides locking, it counts how often it was taken and how often that meant waiting for another thread. */
+class Synchronizer
+{
+public:
+    Synchronizer(): m_numAcquisitions(0), m_numContentions(0), m_numCalculatedVariables(0) {}
+
+    void lock()
+    {
+        if (!m_mutex.try_lock())
+        {
+            m_numContentions.fetch_add(1, std::memory_order_relaxed);
+            m_mutex.lock();
+        }
+        m_numAcquisitions.fetch_add(1, std::memory_order_relaxed);
+    }
+    void unlock() { m_mutex.unlock(); }
+
+    size_t numAcquisitions() const { return m_numAcquisitions.load(std::memory_order_relaxed); }
+    size_t numContentions() const { return m_numContentions.load(std::memory_order_relaxed); }
+
+    //! The size of the domain, for the statistics
+    size_t numCalculatedVariables() const { return m_numCalculatedVariables; }
+    void setNumCalculatedVariables(size_t n) { m_numCalculatedVariables = n; }
+
+private:
+    boost::recursive_mutex m_mutex;
+    std::atomic<size_t> m_numAcquisitions;
+    std::atomic<size_t> m_numContentions;
+    size_t m_numCalculatedVariables;
+};
+
 typedef std::shared_ptr<Synchronizer> SharedSynchronizer;
 
 class CalculatedVariable;
@@ -63,15 +93,35 @@ public:
     std::string name() const;
 
     void addNotifiedVariable( CalculatedVariable* notifiedVariable );
-    std::list<CalculatedVariable*> notifiedVariables() { return m_notifiedVariables; }
+    const std::list<CalculatedVariable*>& notifiedVariables() const { return m_notifiedVariables; }
 
     AddressSpace::ChangeNotifyingVariable* notifyingVariable() { return m_notifyingVariable; }
 
-    SharedSynchronizer& synchronizer() { return m_synchronizer; }
+    //! The handle of the ChangeListener through which m_notifyingVariable updates us
+    AddressSpace::ChangeNotifyingVariable::ListenerHandle listenerHandle() const { return m_listenerHandle; }
+    void setListenerHandle(AddressSpace::ChangeNotifyingVariable::ListenerHandle handle) { m_listenerHandle = handle; }
+
+    //! Approximate bytes taken by this ParserVariable, for statistics
+    size_t memoryUsage() const;
+
+    /** The synchronizers of all domains where this variable is an input: usually one, more for an input
+     * shared by otherwise unrelated formulas. Kept in the global lock order (by address). A change locks all
+     * of them, a formula reading the variable runs under one of them. */
+    const std::vector<SharedSynchronizer>& synchronizers() const { return m_synchronizers; }
+    void addSynchronizer(const SharedSynchronizer& synchronizer);
 
     bool isConstant() const { return m_isConstant; }
     void setIsConstant(bool v) { m_isConstant = v; }
 
+    /** Once enabled (i.e. when every CalculatedVariable has its topological rank), a change is propagated glitch-free:
+     * all CalculatedVariables it affects are evaluated once each, in topological order, instead of recursively
+     * following every path of the calculation graph. */
+    static void setOrderedPropagation(bool enabled) { s_orderedPropagation = enabled; }
+
+    /** Evaluates the given CalculatedVariables (already marked as scheduled) and whatever depends on them.
+     * The caller must have their synchronizer locked. Used by the asynchronous evaluation. */
+    static void evaluateScheduled(const std::vector<CalculatedVariable*>& variables);
+
 private:
     //! Ptr to our Address Space counterpart, will notify us on change
     AddressSpace::ChangeNotifyingVariable* const m_notifyingVariable;
@@ -86,13 +136,17 @@ private:
     //! List of all variables that should be recomputed in case this one changes value.
     std::list<CalculatedVariable*>         m_notifiedVariables;
 
-    SharedSynchronizer m_synchronizer;
+    std::vector<SharedSynchronizer> m_synchronizers;
 
     bool m_isConstant;
 
+    AddressSpace::ChangeNotifyingVariable::ListenerHandle m_listenerHandle;
+
     void setValueNonSynchronized(double v, State state);
     void setValueSynchronized(double v, State state);
 
+    static bool s_orderedPropagation;
+
 };
 
 } /* namespace CalculatedVariables */
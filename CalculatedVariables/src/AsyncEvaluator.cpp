@@ -0,0 +1,190 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * AsyncEvaluator.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <LogIt.h>
+#include <QuasarThreadPool.h>
+#include <Utils.h>
+
+#include <AsyncEvaluator.h>
+#include <CalculatedVariable.h>
+#include <CalculatedVariablesLogComponentId.h>
+
+namespace CalculatedVariables
+{
+
+std::atomic<AsyncEvaluator*> AsyncEvaluator::s_instance (nullptr);
+
+void AsyncEvaluator::start(const std::vector<SharedSynchronizer>& domains, unsigned int numThreads, double maxRatePerDomain)
+{
+    if (instance())
+        throw_runtime_error_with_origin("Asynchronous evaluation of CalculatedVariables already started");
+    s_instance.store(new AsyncEvaluator(domains, numThreads, maxRatePerDomain), std::memory_order_release);
+    LOG(Log::INF, logComponentId) << "Asynchronous evaluation of CalculatedVariables started: " << numThreads << " thread(s), " <<
+            domains.size() << " synchronization domain(s), max rate per domain: " <<
+            (maxRatePerDomain > 0 ? std::to_string(maxRatePerDomain) + "/s" : std::string("unlimited"));
+}
+
+void AsyncEvaluator::stop()
+{
+    AsyncEvaluator* evaluator = s_instance.exchange(nullptr);
+    if (!evaluator)
+        return;
+    // markDirty() is only called under a synchronizer - once we had each of them, nobody is in there anymore
+    for (auto& domain : evaluator->m_domains)
+        std::lock_guard<Synchronizer> lock (*domain.first);
+    LOG(Log::INF, logComponentId) << "Asynchronous evaluation of CalculatedVariables stopped. Changes: " << evaluator->m_numChanges <<
+            ", domain evaluations: " << evaluator->m_numEvaluations << ", dirty formulas: " << evaluator->m_numFormulasEvaluated;
+    delete evaluator;
+}
+
+AsyncEvaluator::AsyncEvaluator(const std::vector<SharedSynchronizer>& domains, unsigned int numThreads, double maxRatePerDomain):
+        m_minInterval(maxRatePerDomain > 0 ?
+                std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / maxRatePerDomain)) :
+                Clock::duration::zero()),
+        m_quit(false),
+        m_numChanges(0),
+        m_numEvaluations(0),
+        m_numFormulasEvaluated(0)
+{
+    for (const SharedSynchronizer& synchronizer : domains)
+        m_domains[synchronizer.get()].reset(new Domain(synchronizer.get()));
+    // every domain is queued at most once
+    m_pool.reset(new Quasar::ThreadPool(numThreads, m_domains.size() + 1));
+    if (m_minInterval != Clock::duration::zero())
+        m_delayThread = std::thread(&AsyncEvaluator::delayDueDomains, this);
+}
+
+AsyncEvaluator::~AsyncEvaluator()
+{
+    {
+        std::lock_guard<std::mutex> lock (m_lock);
+        m_quit = true;
+    }
+    m_dueChanged.notify_all();
+    if (m_delayThread.joinable())
+        m_delayThread.join();
+    m_pool.reset();
+    // the changes which didn't get evaluated: let synchronous propagation schedule these variables again
+    for (auto& domain : m_domains)
+    {
+        std::lock_guard<Synchronizer> lock (*domain.first);
+        for (CalculatedVariable* variable : domain.second->dirty)
+            variable->setScheduled(false);
+    }
+}
+
+bool AsyncEvaluator::markDirty(const std::list<CalculatedVariable*>& variables)
+{
+    for (CalculatedVariable* variable : variables)
+        if (m_domains.find(variable->synchronizer()) == m_domains.end())
+            return false;
+    m_numChanges++;
+    // a shared input feeds several domains, but the variables of one domain usually come in a row
+    Domain* domain = nullptr;
+    for (CalculatedVariable* variable : variables)
+    {
+        if (!domain || domain->synchronizer != variable->synchronizer())
+        {
+            if (domain)
+                queue(domain);
+            domain = m_domains[variable->synchronizer()].get();
+        }
+        if (!variable->isScheduled())
+        {
+            variable->setScheduled(true);
+            domain->dirty.push_back(variable);
+        }
+    }
+    if (domain)
+        queue(domain);
+    return true;
+}
+
+void AsyncEvaluator::queue(Domain* domain)
+{
+    std::lock_guard<std::mutex> lock (m_lock);
+    if (domain->isQueued || m_quit)
+        return; // coalesced with what's already queued
+    domain->isQueued = true;
+    const Clock::time_point due = domain->lastEvaluation + m_minInterval;
+    if (m_minInterval == Clock::duration::zero() || Clock::now() >= due)
+        submit(domain);
+    else
+    {
+        m_due.push(Due{due, domain});
+        m_dueChanged.notify_one();
+    }
+}
+
+void AsyncEvaluator::submit(Domain* domain)
+{
+    UaStatus status = m_pool->addFunctorJob(
+            [this, domain](){ this->evaluate(domain); },
+            [](){ return std::string("evaluation of CalculatedVariables"); });
+    if (!status.isGood())
+    {
+        LOG(Log::ERR, logComponentId) << "Couldn't queue evaluation of CalculatedVariables: " << status.toString().toUtf8() <<
+                ", it will be retried on the next change";
+        domain->isQueued = false;
+    }
+}
+
+void AsyncEvaluator::evaluate(Domain* domain)
+{
+    std::lock_guard<Synchronizer> domainLock (*domain->synchronizer);
+    {
+        std::lock_guard<std::mutex> lock (m_lock);
+        domain->isQueued = false;
+        domain->lastEvaluation = Clock::now();
+    }
+    std::vector<CalculatedVariable*> dirty;
+    dirty.swap(domain->dirty);
+    m_numEvaluations++;
+    m_numFormulasEvaluated += dirty.size();
+    try
+    {
+        ParserVariable::evaluateScheduled(dirty);
+    }
+    catch (const std::exception& e)
+    {
+        LOG(Log::ERR, logComponentId) << "Asynchronous evaluation of CalculatedVariables failed: " << e.what();
+    }
+}
+
+void AsyncEvaluator::delayDueDomains()
+{
+    std::unique_lock<std::mutex> lock (m_lock);
+    while (!m_quit)
+    {
+        if (m_due.empty())
+            m_dueChanged.wait(lock);
+        else if (Clock::now() < m_due.top().when)
+            m_dueChanged.wait_until(lock, m_due.top().when);
+        else
+        {
+            Domain* domain = m_due.top().domain;
+            m_due.pop();
+            submit(domain);
+        }
+    }
+}
+
+}
@@ -21,7 +21,10 @@
 
 #include <algorithm>
 
+#include <muParser.h>
+
 #include <CalculatedVariable.h>
+#include <FormulaBytecode.h>
 #include <LogIt.h>
 #include <CalculatedVariablesEngine.h>
 #include <CalculatedVariablesLogComponentId.h>
@@ -30,6 +33,21 @@
 namespace CalculatedVariables
 {
 
+//! The original backend: a mu::Parser per formula.
+class MuParserFormula: public FormulaEvaluator
+{
+public:
+    void initialize(
+            CalculatedVariable* requestor,
+            const std::string& formula,
+            ParserVariableRequestUserData::Type formulaType);
+
+    virtual double evaluate() { return m_parser.Eval(); }
+
+private:
+    mu::Parser m_parser;
+};
+
 CalculatedVariable::CalculatedVariable(
     const UaNodeId&    nodeId,
     const UaString&    name,
@@ -48,13 +66,18 @@ CalculatedVariable::CalculatedVariable(
                     OpcUa_AccessLevels_CurrentRead,
                     pNodeConfig,
                     pSharedMutex),
+                    m_bytecodeValueFormula(nullptr),
                     m_isBoolean(isBoolean),
                     m_hasStatusFormula(hasStatusFormula),
-                    m_notifiedVariable(nullptr)
+                    m_notifiedVariable(nullptr),
+                    m_topologicalRank(0),
+                    m_isScheduled(false),
+                    m_synchronizer(nullptr)
 {
-    this->initializeParser(m_valueParser, formula, ParserVariableRequestUserData::Type::Value);
+    m_valueEvaluator = this->createEvaluator(formula, ParserVariableRequestUserData::Type::Value);
+    m_bytecodeValueFormula = dynamic_cast<BytecodeFormula*>(m_valueEvaluator.get());
     if (m_hasStatusFormula)
-        this->initializeParser(m_statusParser, statusFormula, ParserVariableRequestUserData::Type::Status);
+        m_statusEvaluator = this->createEvaluator(statusFormula, ParserVariableRequestUserData::Type::Status);
 
     UaDataValue dataValue(UaVariant(), OpcUa_BadWaitingForInitialData, UaDateTime::now(), UaDateTime::now());
     this->setValue(nullptr, dataValue, OpcUa_False);
@@ -66,6 +89,16 @@ CalculatedVariable::CalculatedVariable(
 // otherwise do the computation and publish status according to status formula (if some of status formula are wrong
 // then publish uncertain, otherwise publish good
 void CalculatedVariable::update()
+{
+    this->update(nullptr);
+}
+
+void CalculatedVariable::update(double value)
+{
+    this->update(&value);
+}
+
+void CalculatedVariable::update(const double* value)
 {
     LOG(Log::TRC, logComponentId) << "update() on " << this->nodeId().toString().toUtf8();
 
@@ -93,13 +126,13 @@ void CalculatedVariable::update()
     UaStatus finalStatus = OpcUa_Good;
     if (m_hasStatusFormula)
     {
-        double status = m_statusParser.Eval();
+        double status = m_statusEvaluator->evaluate();
         LOG(Log::TRC, logComponentId) << "status evaluates to: " << status;
         finalStatus = (status != 0) ? OpcUa_Good : OpcUa_Bad; // conversion of double to OPC-UA status code
     }
 
 
-    double updatedValue = m_valueParser.Eval();
+    double updatedValue = value ? *value : m_valueEvaluator->evaluate();
     UaVariant variant;
     if (m_isBoolean)
         variant.setBool(updatedValue != 0);
@@ -111,21 +144,59 @@ void CalculatedVariable::update()
 
 }
 
+std::unique_ptr<FormulaEvaluator> CalculatedVariable::createEvaluator(
+        const std::string& formula,
+        ParserVariableRequestUserData::Type formulaType)
+{
+    if (Engine::formulaBackend() == FormulaBackend::Bytecode)
+    {
+        ParserVariableRequestUserData userData;
+        userData.type = formulaType;
+        userData.requestor = this;
+        std::unique_ptr<BytecodeFormula> compiled = BytecodeFormula::compile(
+                formula,
+                [](const std::string& name, double& value)
+                {
+                    if (!Engine::isConstantDefined(name))
+                        return false;
+                    value = Engine::getValueOfConstant(name);
+                    return true;
+                },
+                [&userData](const std::string& name)
+                {
+                    return Engine::parserVariableRequestHandler(name.c_str(), &userData);
+                });
+        if (compiled)
+        {
+            LOG(Log::TRC, logComponentId) << "At CalculatedVariable " << this->nodeId().toString().toUtf8() <<
+                    " formula compiled to bytecode, #instructions: " << compiled->program()->code().size();
+            Engine::countFormula(FormulaBackend::Bytecode);
+            return std::move(compiled);
+        }
+        LOG(Log::DBG, logComponentId) << "At CalculatedVariable " << this->nodeId().toString().toUtf8() <<
+                " formula not supported by the bytecode backend, will use muParser: " << formula;
+    }
+    std::unique_ptr<MuParserFormula> evaluator (new MuParserFormula);
+    evaluator->initialize(this, formula, formulaType);
+    Engine::countFormula(FormulaBackend::MuParser);
+    return std::move(evaluator);
+}
+
 //! Initializes parser, handles potential muParser-relevant exceptions throwing std except in exchange
-void CalculatedVariable::initializeParser(
-        mu::Parser& parser,
+void MuParserFormula::initialize(
+        CalculatedVariable* requestor,
         const std::string& formula,
         ParserVariableRequestUserData::Type formulaType)
 {
     const std::string typeAsStr = formulaType == ParserVariableRequestUserData::Type::Value ? "value" : "status";
     try
     {
-        parser.DefineNameChars("0123456789_abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ.");
-        parser.SetExpr(formula);
+        m_parser.DefineNameChars("0123456789_abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ.");
+        m_parser.SetExpr(formula);
         // after SetExpr parser knows the symbols(tokens),
         // we can supply constants.
-        auto usedVariables = parser.GetUsedVar();
-        LOG(Log::TRC, logComponentId) << "At CalculatedVariable " << this->nodeId().toString().toUtf8() << " recognized these operands:";
+        auto usedVariables = m_parser.GetUsedVar();
+        LOG(Log::TRC, logComponentId) << "At CalculatedVariable " << requestor->nodeId().toString().toUtf8() << " recognized these operands:";
         for (auto& x : usedVariables)
         {
             // check if we're dealing with a constant?
@@ -134,19 +205,19 @@ void CalculatedVariable::initializeParser(
             {
                 double value = Engine::getValueOfConstant(x.first);
                 LOG(Log::TRC, logComponentId) << "Recognized use of constant, name: " << x.first << " value: " << value;
-                parser.DefineConst(x.first, value);
+                m_parser.DefineConst(x.first, value);
             }
         }
         ParserVariableRequestUserData userData;
         userData.type = formulaType;
-        userData.requestor = this;
-        parser.SetVarFactory(&Engine::parserVariableRequestHandler, &userData );
-        parser.Eval(); // this compiles the expression and does 1st evaluation
+        userData.requestor = requestor;
+        m_parser.SetVarFactory(&Engine::parserVariableRequestHandler, &userData );
+        m_parser.Eval(); // this compiles the expression and does 1st evaluation
     }
     catch(const mu::Parser::exception_type &e)
     {
         LOG(Log::ERR, logComponentId) << "At CalculatedVariable " <<
-                this->nodeId().toString().toUtf8() << " in " << typeAsStr << " formula : "
+                requestor->nodeId().toString().toUtf8() << " in " << typeAsStr << " formula : "
                 << e.GetExpr() << ": " << e.GetMsg();
         throw std::runtime_error("Calculated item instantiation failed. Problem has been logged.");
     }
@@ -27,10 +27,14 @@
 #include <CalculatedVariablesChangeListener.h>
 #include <CalculatedVariablesEngine.h>
 #include <ParserVariableRequestUserData.h>
+#include <FormulaBytecode.h>
+#include <AsyncEvaluator.h>
+#include <FormulaElaboration.h>
 
 #include <Utils.h>
 
-#include <boost/xpressive/xpressive.hpp>
+#include <vector>
+#include <algorithm>
 
 #define LOG_AND_THROW_ERROR(FORMULA,ERROR) \
     { \
@@ -38,18 +42,9 @@
     throw std::runtime_error(ERROR); \
     }
 
-using namespace boost::xpressive;
-
 namespace CalculatedVariables
 {
 
-const std::string DashSignVariableRepr {"__dash__"};
-const std::string SlashSignVariableRepr {"__slash__"};
-
-std::string escapeSpecialCharactersInFormula (const std::string& inputFormula);
-std::string escapeSpecialCharactersInParserVariableName (const std::string& input);
-static std::string replaceAll (const std::string& input, const std::string& from, const std::string& to);
-
 void Engine::initialize()
 {
     logComponentId = Log::getComponentHandle("CalcVars");
@@ -58,17 +53,21 @@ void Engine::initialize()
 ParserVariable& Engine::registerVariableForCalculatedVariables(AddressSpace::ChangeNotifyingVariable* variable)
 {
     LOG(Log::TRC, logComponentId) << "Putting on list of ParserVariables: " << variable->nodeId().toString().toUtf8();
+    std::lock_guard<std::mutex> lock (s_registrationLock);
     /* see if we have to do some substitutions of minus sign, etc. */
     s_parserVariables.emplace_back(
         variable,
         escapeSpecialCharactersInParserVariableName(variable->nodeId().toString().toUtf8())); // might be different from the variable name! (OPCUA-2456)
-    variable->addChangeListener(ChangeListener(s_parserVariables.back())); // using back() because we just added it a line above
+    // using back() because we just added it a line above
+    s_parserVariables.back().setListenerHandle(variable->addChangeListener(ChangeListener(s_parserVariables.back())));
+    s_parserVariablesByName.emplace(s_parserVariables.back().name(), &s_parserVariables.back()); // the first one registered under a name wins
     return s_parserVariables.back();
 }
 
 void Engine::registerConstantForCalculatedVariables( const std::string& name, double value)
 {
 	LOG(Log::TRC, logComponentId) << "Putting *const* on list of ParserVariables: " << name << ", value=" << value;
+    std::lock_guard<std::mutex> lock (s_registrationLock);
     s_parserConstants.emplace(name, value);
 }
 
@@ -80,11 +79,8 @@ double* CalculatedVariables::Engine::parserVariableRequestHandler(const char* na
     LOG(Log::TRC, logComponentId) <<
             "muparser asks for this variable: " << name <<
             " while instantiating: " << requestor->nodeId().toString().toUtf8();
-    decltype(s_parserVariables)::iterator it = std::find_if(
-            std::begin(s_parserVariables),
-            std::end(s_parserVariables),
-            [name](const ParserVariable& variable){return variable.name()==name;});
-    if (it == std::end(s_parserVariables))
+    decltype(s_parserVariablesByName)::iterator it = s_parserVariablesByName.find(name);
+    if (it == std::end(s_parserVariablesByName))
     {
         LOG(Log::ERR, logComponentId) << "Variable " << name << " can't be found. Formula error most likely? (While instantiating '" << requestor->nodeId().toString().toUtf8() << "')";
         throw std::runtime_error("Couldnt find formula variable. The exact error has been logged.");
@@ -92,153 +88,34 @@ double* CalculatedVariables::Engine::parserVariableRequestHandler(const char* na
     else
     {
 
+        ParserVariable* variable = it->second;
         if (requestUserData->type == ParserVariableRequestUserData::Type::Value)
-            requestor->addDependentVariableForValue(&(*it));
+            requestor->addDependentVariableForValue(variable);
         else if (requestUserData->type == ParserVariableRequestUserData::Type::Status)
-            requestor->addDependentVariableForStatus(&(*it));
+            requestor->addDependentVariableForStatus(variable);
         else
             throw_runtime_error_with_origin("Enum value not handled. Report to quasar-developers.");
-        it->addNotifiedVariable(requestor);
-        return it->valuePtr();
-    }
-}
-
-static std::string elaborateParent(
-        const std::string& input,
-        unsigned int levels,
-        const std::string& thisFormulaAddress)
-{
-    // the assumption is that for every level to go up we find the dot and cut off at such place
-    LOG(Log::TRC, logComponentId) << "Elaborating parent of address='" << input << "' for numLevels='" << levels << "'";
-    std::size_t cutOffIndex = std::string::npos;
-    while (levels > 0)
-    {
-        cutOffIndex = input.rfind('.', cutOffIndex);
-        if (cutOffIndex == std::string::npos)
-            LOG_AND_THROW_ERROR(thisFormulaAddress, "Not enough levels to go up!");
-        levels--;
-        if (levels>0)
-        {
-            if (cutOffIndex>0)
-                cutOffIndex--;
-            else
-                LOG_AND_THROW_ERROR(thisFormulaAddress, "Not enough levels to go up!");
-        }
-    }
-    std::string result = input.substr(0, cutOffIndex);
-    LOG(Log::TRC, logComponentId) << "Elaboration parent result: '" << result << "'";
-    return result;
-}
-
-static std::string replaceAll (const std::string& input, const std::string& from, const std::string& to)
-{
-    std::string replica (input);
-    std::string::size_type pos;
-    do
-    {
-        pos = replica.find(from);
-        if (pos != std::string::npos)
-        {
-            replica.replace(pos, from.length(), to);
-        }
+        variable->addNotifiedVariable(requestor);
+        return variable->valuePtr();
     }
-    while (pos != std::string::npos);
-    return replica;
-}
-
-std::string escapeSpecialCharactersInFormula (const std::string& inputFormula)
-{
-    std::string dashReplaced { replaceAll(inputFormula, "\\-", DashSignVariableRepr) };
-    return replaceAll(dashReplaced, "\\/", SlashSignVariableRepr);
-}
-
-std::string escapeSpecialCharactersInParserVariableName (const std::string& input)
-{
-    std::string dashReplaced { replaceAll(input, "-", DashSignVariableRepr) };
-    return replaceAll(dashReplaced, "/", SlashSignVariableRepr);
 }
 
 std::string CalculatedVariables::Engine::elaborateFormula (
     const Configuration::CalculatedVariable& config,
     const std::string& parentObjectAddress)
 {
-    // We use this one just to print some debug info.
-    const std::string thisFormulaAddress = parentObjectAddress+"."+config.name();
-
-    // Note (Piotr): it's of course be preferred to use std::string::const_iterator here,
-    // but we need to be compatible with gcc 4.8 (CC7) and there C++11 std::string is not complete,
-    // e.g. without const_iterator support.
-
-    // Comment for the regex below:
-    // Will match two "kinds" of expressions:
-    // $xxxxxxxxx
-    // $xxxxxxxxx(yyyyy)
-    // Note: ?: is the non-captured group so in the end we get between 2 and 3 capture groups total.
-    basic_regex<std::string::iterator> cvSubstitutionRegex = basic_regex<std::string::iterator>::compile("\\$([A-Za-z0-9_]+)(?:(?:\\()([^ \r\n\t()]+)(?:\\)))?");
-
-    match_results<std::string::iterator> matched;
-    std::string formulaInWork (config.value());
-    bool matchedAnything (false);
-    do
+    try
     {
-        matchedAnything = regex_search(
-            formulaInWork.begin(),
-            formulaInWork.end(),
-            matched,
-            cvSubstitutionRegex);
-        if (matchedAnything)
-        {
-            std::string operation = matched[1];
-            bool argumentPresent = matched[2].matched;
-            std::string argument = matched[2];
-            if (operation == "_" || operation == "thisObjectAddress")
-            {
-                if (argumentPresent)
-                    LOG_AND_THROW_ERROR(thisFormulaAddress, "$"+operation+" expression does not take arguments!");
-                LOG(Log::TRC, logComponentId) << "Before expanding $_, formulaInWork=" << formulaInWork;
-                formulaInWork.replace(/*from*/ matched[0].first, /*to*/ matched[0].second, escapeSpecialCharactersInParserVariableName(parentObjectAddress));
-                LOG(Log::TRC, logComponentId) << "After expanding $_, formulaInWork=" << formulaInWork;
-            }
-            else if (operation == "applyGenericFormula")
-            {
-                if (!argumentPresent)
-                    LOG_AND_THROW_ERROR(thisFormulaAddress, "$applyGenericFormula expects a single argument -- formula id");
-                std::string formulaId = matched[2];
-                try
-                {
-                    formulaInWork.replace(
-                            /*from*/ matched[0].first,
-                            /*to*/ matched[0].second,
-                            s_genericFormulas.at(formulaId));
-                }
-                catch (std::out_of_range &e)
-                    LOG_AND_THROW_ERROR(thisFormulaAddress, "Generic Formula id='"+formulaId+"' was referenced but never declared.");
-                LOG(Log::TRC, logComponentId) << "After expanding $applyGenericFormula, formulaInWork=" << formulaInWork;
-            }
-            else if (operation == "parentObjectAddress")
-            {
-                if (!argumentPresent)
-                    LOG_AND_THROW_ERROR(thisFormulaAddress, "$"+operation+" expression requires an argument");
-                basic_regex<std::string::iterator> argumentFormat =
-                    basic_regex<std::string::iterator>::compile("^numLevelsUp=(\\d+)$");
-                match_results<std::string::iterator> myMatchResults;
-                if (!regex_match(argument, myMatchResults, argumentFormat))
-                    LOG_AND_THROW_ERROR(thisFormulaAddress, "Argument did not fit the expected syntax, for example: $parentObjectAddress(numLevelsUp=2)");
-                unsigned int numLevelsUp = std::stoi(myMatchResults[1]);
-                LOG(Log::TRC, logComponentId) << "Before expanding parentObjectAddress, formulaInWork=" << formulaInWork << ", levels=" << numLevelsUp;
-                formulaInWork.replace(
-                      /*from*/ matched[0].first,
-                      /*to*/ matched[0].second,
-                      escapeSpecialCharactersInParserVariableName(elaborateParent(parentObjectAddress, numLevelsUp, thisFormulaAddress)));
-                LOG(Log::TRC, logComponentId) << "After expanding parentObjectAddress, formulaInWork=" << formulaInWork;
-            }
-            else
-                LOG_AND_THROW_ERROR(thisFormulaAddress, "Invalid dollar expression: "+matched[0].str());
-        }
+        std::string elaborated = s_formulaElaborator.elaborate(config.value(), parentObjectAddress);
+        LOG(Log::TRC, logComponentId) << "Formula '" << config.value() << "' at " << parentObjectAddress << " elaborated to: " << elaborated;
+        return elaborated;
+    }
+    catch (const std::runtime_error& e)
+    {
+        // We use this one just to print some debug info.
+        const std::string thisFormulaAddress = parentObjectAddress+"."+config.name();
+        LOG_AND_THROW_ERROR(thisFormulaAddress, std::string(e.what()));
     }
-    while (matchedAnything);
-    formulaInWork = escapeSpecialCharactersInFormula(formulaInWork);
-    return formulaInWork;
 }
 
 void Engine::loadGenericFormulas (
@@ -246,7 +123,7 @@ void Engine::loadGenericFormulas (
 {
     for (const Configuration::CalculatedVariableGenericFormula& formula : config)
     {
-        bool insertionHappened = s_genericFormulas.emplace(formula.name(), formula.formula()).second;
+        bool insertionHappened = s_formulaElaborator.addGenericFormula(formula.name(), formula.formula());
         if (!insertionHappened)
         {
             // TODO: one day we could understand how to get line info
@@ -261,6 +138,7 @@ void Engine::instantiateCalculatedVariable(
         UaNodeId parentNodeId,
         const Configuration::CalculatedVariable& config)
 {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     // check if see any magic expression in the formula
     LOG(Log::TRC, logComponentId) << "Formula before elaboration: " <<  config.value();
     std::string elaboratedFormula = elaborateFormula(
@@ -298,6 +176,7 @@ void Engine::instantiateCalculatedVariable(
         calculatedVariable->update();
 
     s_numCalculatedVariables++;
+    s_instantiationTime += std::chrono::steady_clock::now() - start;
     LOG(Log::TRC, logComponentId) << "Instantiated Calculated Variable: " << calculatedVariable->nodeId().toString().toUtf8();
 }
 
@@ -305,12 +184,56 @@ void Engine::printInstantiationStatistics()
 {
     for (ParserVariable& pv : s_parserVariables)
     {
-        LOG(Log::TRC, logComponentId) << "PV: " << pv.name() << " synchronizer: " << pv.synchronizer();
+        LOG(Log::TRC, logComponentId) << "PV: " << pv.name() << " #synchronizers: " << pv.synchronizers().size();
     }
     LOG(Log::INF, logComponentId) <<
             " #ParserVariables: " << s_parserVariables.size() <<
             " #CalculatedVariables: " << s_numCalculatedVariables <<
-            " #Synchronizers: " << s_numSynchronizers;
+            " #Synchronizers: " << s_synchronizers.size() <<
+            " instantiation took: " << std::chrono::duration<double, std::milli>(s_instantiationTime).count() << "ms";
+    LOG(Log::INF, logComponentId) <<
+            " #BytecodeFormulas: " << s_numBytecodeFormulas <<
+            " (#distinct programs: " << BytecodeFormula::numDistinctPrograms() << ")" <<
+            " #MuParserFormulas: " << s_numMuParserFormulas;
+    printSynchronizationStatistics();
+}
+
+void Engine::printSynchronizationStatistics()
+{
+    if (s_synchronizers.empty())
+        return;
+    size_t largestDomain = 0;
+    size_t numInDomains = 0;
+    size_t numAcquisitions = 0;
+    size_t numContentions = 0;
+    const Synchronizer* mostContended = s_synchronizers.front().get();
+    for (const SharedSynchronizer& synchronizer : s_synchronizers)
+    {
+        largestDomain = std::max(largestDomain, synchronizer->numCalculatedVariables());
+        numInDomains += synchronizer->numCalculatedVariables();
+        numAcquisitions += synchronizer->numAcquisitions();
+        numContentions += synchronizer->numContentions();
+        if (synchronizer->numContentions() > mostContended->numContentions())
+            mostContended = synchronizer.get();
+    }
+    size_t numSharedInputs = 0;
+    size_t maxDomainsPerInput = 0;
+    for (const ParserVariable& pv : s_parserVariables)
+    {
+        if (pv.synchronizers().size() > 1)
+            numSharedInputs++;
+        maxDomainsPerInput = std::max(maxDomainsPerInput, pv.synchronizers().size());
+    }
+    LOG(Log::INF, logComponentId) <<
+            " Synchronization domains: #CalculatedVariables per domain: mean " << double(numInDomains) / s_synchronizers.size() <<
+            " max " << largestDomain <<
+            " #inputs shared by domains: " << numSharedInputs << " (max #domains per input: " << maxDomainsPerInput << ")";
+    LOG(Log::INF, logComponentId) <<
+            " Lock contention: #acquisitions: " << numAcquisitions <<
+            " #contended: " << numContentions <<
+            " (" << (numAcquisitions ? 100.0 * numContentions / numAcquisitions : 0.0) << "%)" <<
+            " most contended domain: " << mostContended->numContentions() << " of " << mostContended->numAcquisitions() <<
+            ", its #CalculatedVariables: " << mostContended->numCalculatedVariables();
 }
 
 /* This can be called at the end of instantiation step
@@ -320,88 +243,184 @@ void Engine::printInstantiationStatistics()
  */
 void Engine::optimize()
 {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const size_t numListenersBefore = s_parserVariables.size();
     size_t numOptimized = 0;
+    long long bytesSaved = 0;
     decltype(s_parserVariables)::iterator it;
     for (it = std::begin(s_parserVariables); it!=std::end(s_parserVariables); )
     {
-        if (it->notifiedVariables().size() == 0) // i.e. there is no formula 
+        if (it->notifiedVariables().size() == 0) // i.e. there is no formula
         {
-            if (it->notifyingVariable()->changeListenerSize() <= 1)
+            // other listeners (e.g. from device logic) stay, only ours goes away
+            AddressSpace::ChangeNotifyingVariable* variable = it->notifyingVariable();
+            const long long listenersBytes = variable->listenersMemoryUsage();
+            if (!variable->removeChangeListener(it->listenerHandle()))
+                LOG(Log::WRN, logComponentId) << "ChangeListener of " << it->name() << " was already gone";
+            variable->reclaimRetiredListeners(); // we're configuring, the address space isn't used yet
+            bytesSaved += listenersBytes - static_cast<long long>(variable->listenersMemoryUsage());
+            bytesSaved += it->memoryUsage() + 2 * sizeof(void*); // list node
+            CalculatedVariable* cv = dynamic_cast<CalculatedVariable*> (variable);
+            if (cv)
+                cv->setNotifiedVariable(nullptr);
+            LOG(Log::TRC, logComponentId) << "Optimizing out: " << it->name();
+            decltype(s_parserVariablesByName)::iterator indexed = s_parserVariablesByName.find(it->name());
+            if (indexed != s_parserVariablesByName.end() && indexed->second == &(*it))
             {
-                it->notifyingVariable()->removeAllChangeListeners();
-                CalculatedVariable* cv = dynamic_cast<CalculatedVariable*> (it->notifyingVariable());
-                if (cv)
-                    cv->setNotifiedVariable(nullptr);
-                LOG(Log::TRC, logComponentId) << "Optimizing out: " << it->name();
-                it = s_parserVariables.erase(it);
-                numOptimized++;
-                continue;
+                bytesSaved += sizeof(*indexed) + indexed->first.capacity() + 2 * sizeof(void*); // hash node
+                s_parserVariablesByName.erase(indexed);
             }
-            else
-                LOG(Log::WRN, logComponentId) << "Need to selectively remove change listeners - not implemented. Skipping optimization for this ParserVariable.";
+            it = s_parserVariables.erase(it);
+            numOptimized++;
+            continue;
         }
         it++;
     }
-    LOG(Log::INF, logComponentId) << "Optimized(suppresed) " << numOptimized << " ParserVariables not used in any formulas.";
-
+    LOG(Log::INF, logComponentId) << "Optimized(suppresed) " << numOptimized << " of " << numListenersBefore <<
+            " ParserVariables not used in any formulas, took: " <<
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << "ms";
+    LOG(Log::INF, logComponentId) << "Saved ~" << bytesSaved / 1024 << "kB; removed the change listeners of " << numOptimized <<
+            " variables (CalcVars listeners left: " << s_parserVariables.size() << ")";
 }
 
-void Engine::dfsAndSetSynchronizer(ParserVariable& pv, SharedSynchronizer& synchronizer)
+void Engine::setupSynchronization()
 {
-    LOG(Log::TRC, logComponentId) << "traverse pv adjacent: " << pv.name() << " new_s=" << pv.synchronizer();
-    pv.synchronizer() = synchronizer;
-    // first try going towards "ancestors" in the calculation graph
-    CalculatedVariable* notifyingCalculatedVariable = dynamic_cast<CalculatedVariable*> (pv.notifyingVariable());
-    if (notifyingCalculatedVariable)
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    LOG(Log::TRC, logComponentId) << "In setupSynchronization";
+
+    /* A domain is a set of CalculatedVariables connected by reading each other's values (union-find below).
+     * Inputs which aren't CalculatedVariables (e.g. cache-variables) don't merge domains: an input read by formulas
+     * of several domains gets all of their synchronizers instead, so a change of it locks all those domains, while
+     * a formula, which reads it under its own domain's synchronizer, doesn't get serialized with unrelated ones. */
+    std::unordered_map<CalculatedVariable*, CalculatedVariable*> parent;
+    auto find = [&parent](CalculatedVariable* cv)
     {
-        for (ParserVariable* variable : notifyingCalculatedVariable->valueVariables())
+        while (parent[cv] != cv)
         {
-            if (!variable->synchronizer() && !variable->isConstant())
-                dfsAndSetSynchronizer(*variable, synchronizer);
+            parent[cv] = parent[parent[cv]];
+            cv = parent[cv];
         }
-        for (ParserVariable* variable : notifyingCalculatedVariable->statusVariables())
+        return cv;
+    };
+    for (ParserVariable& pv : s_parserVariables)
+    {
+        if (pv.isConstant())
         {
-            if (!variable->synchronizer() && !variable->isConstant())
-                dfsAndSetSynchronizer(*variable, synchronizer);
+            LOG(Log::TRC, logComponentId) << "Skipping PV because it is constant. PV:" << pv.name();
+            continue;
+        }
+        CalculatedVariable* source = dynamic_cast<CalculatedVariable*> (pv.notifyingVariable());
+        if (source)
+            parent.insert(std::make_pair(source, source));
+        for (CalculatedVariable* notified : pv.notifiedVariables())
+        {
+            parent.insert(std::make_pair(notified, notified));
+            if (source)
+                parent[find(source)] = find(notified);
         }
     }
-    // then try to go towards "descendants" in the calculation graph
-    for (CalculatedVariable* cv : pv.notifiedVariables())
+
+    std::unordered_map<CalculatedVariable*, SharedSynchronizer> synchronizerOfRoot;
+    for (auto& node : parent)
     {
-        if (cv->notifiedVariable())
-            if (! cv->notifiedVariable()->synchronizer() && !cv->notifiedVariable()->isConstant())
-                dfsAndSetSynchronizer(*cv->notifiedVariable(), synchronizer);
+        SharedSynchronizer& synchronizer = synchronizerOfRoot[find(node.first)];
+        if (!synchronizer)
+        {
+            synchronizer.reset(new Synchronizer());
+            s_synchronizers.push_back(synchronizer);
+        }
+        node.first->setSynchronizer(synchronizer.get());
+        synchronizer->setNumCalculatedVariables(synchronizer->numCalculatedVariables() + 1);
+    }
+    for (ParserVariable& pv : s_parserVariables)
+    {
+        if (pv.isConstant())
+            continue;
+        for (CalculatedVariable* notified : pv.notifiedVariables())
+            pv.addSynchronizer(synchronizerOfRoot[find(notified)]);
+        if (pv.synchronizers().empty())
+            LOG(Log::TRC, logComponentId) << "PV notifies nothing, no synchronizer: " << pv.name();
     }
+
+    computeTopologicalOrder();
+    LOG(Log::INF, logComponentId) << "Synchronization set up, took: " <<
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << "ms";
+    if (s_asyncEvaluationThreads > 0)
+        AsyncEvaluator::start(s_synchronizers, s_asyncEvaluationThreads, s_asyncEvaluationMaxRate);
 }
 
-void Engine::setupSynchronization()
+void Engine::setAsyncEvaluation (unsigned int numThreads, double maxRatePerDomain)
 {
-    LOG(Log::TRC, logComponentId) << "In setupSynchronization";
-    decltype(s_parserVariables)::reverse_iterator it;
-    for (it = s_parserVariables.rbegin(); it != s_parserVariables.rend(); it++)
+    s_asyncEvaluationThreads = numThreads;
+    s_asyncEvaluationMaxRate = maxRatePerDomain;
+}
+
+void Engine::shutdown ()
+{
+    AsyncEvaluator::stop();
+    printSynchronizationStatistics();
+}
+
+void Engine::computeTopologicalOrder()
+{
+    // Kahn's algorithm. There is an edge A->B when B's formulas read A, i.e. B is notified by A's ParserVariable.
+    std::unordered_map<CalculatedVariable*, size_t> numInputsNotRanked;
+    for (ParserVariable& pv : s_parserVariables)
     {
-        if (it->notifiedVariables().size() < 1)
+        CalculatedVariable* source = dynamic_cast<CalculatedVariable*> (pv.notifyingVariable());
+        if (source)
+            numInputsNotRanked[source]; // also the ones reading no other CalculatedVariable
+        for (CalculatedVariable* notified : pv.notifiedVariables())
         {
-            LOG(Log::TRC, logComponentId) << "Skipping PV because it notifies nothing: " << it->name();
-            continue;
+            size_t& numInputs = numInputsNotRanked[notified];
+            if (source)
+                numInputs++;
         }
-        if (it->synchronizer())
-        {
-            LOG(Log::TRC, logComponentId) << "Skipping PV because it already has synchronization domain: " << it->name();
+    }
+    std::vector<CalculatedVariable*> ready;
+    for (auto& node : numInputsNotRanked)
+    {
+        node.first->setTopologicalRank(0);
+        if (node.second == 0)
+            ready.push_back(node.first);
+    }
+    // the rank is the level: the longest path from a CalculatedVariable reading no other one
+    size_t numRanked = 0;
+    size_t numLevels = 0;
+    while (!ready.empty())
+    {
+        CalculatedVariable* cv = ready.back();
+        ready.pop_back();
+        numRanked++;
+        numLevels = std::max(numLevels, cv->topologicalRank() + 1);
+        if (!cv->notifiedVariable())
             continue;
-        }
-        if (it->isConstant())
+        for (CalculatedVariable* notified : cv->notifiedVariable()->notifiedVariables())
         {
-            LOG(Log::TRC, logComponentId) << "Skipping PV because it is constant. PV:" << it->name();
-            continue;
+            notified->setTopologicalRank(std::max(notified->topologicalRank(), cv->topologicalRank() + 1));
+            if (--numInputsNotRanked[notified] == 0)
+                ready.push_back(notified);
         }
-        SharedSynchronizer synchronizer (new Synchronizer());
-        s_numSynchronizers++;
-        it->synchronizer() = synchronizer;
-        LOG(Log::TRC, logComponentId) << "Added new synchronizer to: " << it->name();
-        dfsAndSetSynchronizer(*it, synchronizer);
-
     }
+    if (numRanked < numInputsNotRanked.size())
+    {
+        LOG(Log::WRN, logComponentId) << "Calculation graph has cycle(s): " << numInputsNotRanked.size() - numRanked <<
+                " CalculatedVariables can't be ordered, their evaluation order will be arbitrary";
+        for (auto& node : numInputsNotRanked)
+            if (node.second != 0)
+                node.first->setTopologicalRank(numLevels++);
+    }
+    ParserVariable::setOrderedPropagation(true);
+    LOG(Log::INF, logComponentId) << "Topological order of " << numInputsNotRanked.size() << " CalculatedVariables computed (" <<
+            numLevels << " levels), propagation is glitch-free";
+}
+
+void Engine::countFormula (FormulaBackend backend)
+{
+    if (backend == FormulaBackend::Bytecode)
+        s_numBytecodeFormulas++;
+    else
+        s_numMuParserFormulas++;
 }
 
 bool Engine::isConstantDefined (const std::string& id)
@@ -416,10 +435,18 @@ double Engine::getValueOfConstant (const std::string& id)
 
 Log::LogComponentHandle logComponentId = Log::INVALID_HANDLE;
 std::list <ParserVariable> Engine::s_parserVariables;
+std::unordered_map <std::string, ParserVariable*> Engine::s_parserVariablesByName;
 std::map <std::string, double> Engine::s_parserConstants;
-size_t Engine::s_numSynchronizers = 0;
+std::mutex Engine::s_registrationLock;
+std::vector<SharedSynchronizer> Engine::s_synchronizers;
 size_t Engine::s_numCalculatedVariables = 0;
-std::map<std::string, std::string> Engine::s_genericFormulas;
+FormulaElaborator Engine::s_formulaElaborator;
+FormulaBackend Engine::s_formulaBackend = FormulaBackend::MuParser;
+size_t Engine::s_numBytecodeFormulas = 0;
+size_t Engine::s_numMuParserFormulas = 0;
+std::chrono::steady_clock::duration Engine::s_instantiationTime (0);
+unsigned int Engine::s_asyncEvaluationThreads = 0;
+double Engine::s_asyncEvaluationMaxRate = 0;
 
 
 } /* namespace CalculatedVariables */
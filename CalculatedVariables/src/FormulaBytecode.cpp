@@ -0,0 +1,848 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * FormulaBytecode.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <FormulaBytecode.h>
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <sstream>
+#include <locale>
+#include <map>
+#include <mutex>
+
+namespace CalculatedVariables
+{
+
+namespace
+{
+
+/* The built-in functions, with exactly the definitions muParser uses (see mu::MathImpl), so that both backends give
+ * the same results. */
+double fSin (double v) { return std::sin(v); }
+double fCos (double v) { return std::cos(v); }
+double fTan (double v) { return std::tan(v); }
+double fAsin (double v) { return std::asin(v); }
+double fAcos (double v) { return std::acos(v); }
+double fAtan (double v) { return std::atan(v); }
+double fSinh (double v) { return std::sinh(v); }
+double fCosh (double v) { return std::cosh(v); }
+double fTanh (double v) { return std::tanh(v); }
+double fAsinh (double v) { return std::log(v + std::sqrt(v * v + 1)); }
+double fAcosh (double v) { return std::log(v + std::sqrt(v * v - 1)); }
+double fAtanh (double v) { return 0.5 * std::log((1 + v) / (1 - v)); }
+double fLog2 (double v) { return std::log(v) / std::log(2.0); }
+double fLog10 (double v) { return std::log10(v); }
+double fLn (double v) { return std::log(v); }
+double fExp (double v) { return std::exp(v); }
+double fSqrt (double v) { return std::sqrt(v); }
+double fSign (double v) { return (v < 0) ? -1 : (v > 0) ? 1 : 0; }
+double fRint (double v) { return std::floor(v + 0.5); }
+double fAbs (double v) { return (v >= 0) ? v : -v; }
+double fAtan2 (double v1, double v2) { return std::atan2(v1, v2); }
+
+struct FunctionDefinition
+{
+    const char* name;
+    FormulaProgram::Opcode op; // Call1, Call2 or one of the variadic ones
+    double (*function1)(double);
+    double (*function2)(double, double);
+};
+
+const FunctionDefinition s_functions[] =
+{
+    {"sin", FormulaProgram::Call1, fSin, nullptr},
+    {"cos", FormulaProgram::Call1, fCos, nullptr},
+    {"tan", FormulaProgram::Call1, fTan, nullptr},
+    {"asin", FormulaProgram::Call1, fAsin, nullptr},
+    {"acos", FormulaProgram::Call1, fAcos, nullptr},
+    {"atan", FormulaProgram::Call1, fAtan, nullptr},
+    {"atan2", FormulaProgram::Call2, nullptr, fAtan2},
+    {"sinh", FormulaProgram::Call1, fSinh, nullptr},
+    {"cosh", FormulaProgram::Call1, fCosh, nullptr},
+    {"tanh", FormulaProgram::Call1, fTanh, nullptr},
+    {"asinh", FormulaProgram::Call1, fAsinh, nullptr},
+    {"acosh", FormulaProgram::Call1, fAcosh, nullptr},
+    {"atanh", FormulaProgram::Call1, fAtanh, nullptr},
+    {"log2", FormulaProgram::Call1, fLog2, nullptr},
+    {"log10", FormulaProgram::Call1, fLog10, nullptr},
+    {"log", FormulaProgram::Call1, fLn, nullptr},
+    {"ln", FormulaProgram::Call1, fLn, nullptr},
+    {"exp", FormulaProgram::Call1, fExp, nullptr},
+    {"sqrt", FormulaProgram::Call1, fSqrt, nullptr},
+    {"sign", FormulaProgram::Call1, fSign, nullptr},
+    {"rint", FormulaProgram::Call1, fRint, nullptr},
+    {"abs", FormulaProgram::Call1, fAbs, nullptr},
+    {"sum", FormulaProgram::Sum, nullptr, nullptr},
+    {"avg", FormulaProgram::Average, nullptr, nullptr},
+    {"min", FormulaProgram::Minimum, nullptr, nullptr},
+    {"max", FormulaProgram::Maximum, nullptr, nullptr}
+};
+
+const FunctionDefinition* findFunction (const std::string& name)
+{
+    for (const FunctionDefinition& definition : s_functions)
+        if (name == definition.name)
+            return &definition;
+    return nullptr;
+}
+
+//! Thrown while compiling whenever the formula uses something the bytecode backend doesn't handle.
+struct Unsupported {};
+
+struct Node
+{
+    enum Kind { Constant, Variable, Negate, Binary, Function, Ternary };
+
+    explicit Node(Kind k): kind(k), op(FormulaProgram::PushConstant), value(0), slot(0), function(nullptr) {}
+
+    Kind kind;
+    FormulaProgram::Opcode op; // for Binary: the operator taking both operands from the stack
+    double value;              // for Constant
+    std::string name;          // for Variable
+    unsigned int slot;         // for Variable, assigned once the formula got parsed
+    const FunctionDefinition* function;
+    std::vector<std::unique_ptr<Node>> children;
+};
+
+typedef std::unique_ptr<Node> NodePtr;
+
+NodePtr makeNode (Node::Kind kind, NodePtr a=nullptr, NodePtr b=nullptr, NodePtr c=nullptr)
+{
+    NodePtr node (new Node(kind));
+    for (NodePtr* child : {&a, &b, &c})
+        if (*child)
+            node->children.push_back(std::move(*child));
+    return node;
+}
+
+/* Recursive descent parser, mirroring the tokenization and operator precedence of muParser 2.2:
+ *   ?:  <  ||  <  &&  <  comparisons  <  + -  <  * /  <  unary + -  <  ^ (right associative)  */
+class Parser
+{
+public:
+    Parser(const std::string& formula, const BytecodeFormula::ConstantResolver& resolveConstant):
+        m_formula(formula + " "), // muParser appends it too; it matters for reading a number at the end
+        m_position(0),
+        m_nesting(0),
+        m_resolveConstant(resolveConstant)
+    {}
+
+    NodePtr parse ()
+    {
+        NodePtr root = ternary();
+        skipWhitespace();
+        if (m_position != m_formula.size())
+            throw Unsupported();
+        return root;
+    }
+
+private:
+    const std::string m_formula;
+    size_t m_position;
+    unsigned int m_nesting;
+    const BytecodeFormula::ConstantResolver& m_resolveConstant;
+
+    enum { MaxNesting = 256 };
+
+    static bool isNameChar (char c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '.';
+    }
+
+    void skipWhitespace ()
+    {
+        while (m_position < m_formula.size() && static_cast<unsigned char>(m_formula[m_position]) <= 0x20)
+            ++m_position;
+    }
+
+    bool accept (const char* token)
+    {
+        skipWhitespace();
+        size_t length = std::strlen(token);
+        if (m_formula.compare(m_position, length, token) != 0)
+            return false;
+        m_position += length;
+        return true;
+    }
+
+    void expect (const char* token)
+    {
+        if (!accept(token))
+            throw Unsupported();
+    }
+
+    NodePtr binary (FormulaProgram::Opcode op, NodePtr left, NodePtr right)
+    {
+        NodePtr node = makeNode(Node::Binary, std::move(left), std::move(right));
+        node->op = op;
+        return node;
+    }
+
+    NodePtr ternary ()
+    {
+        if (++m_nesting > MaxNesting)
+            throw Unsupported();
+        NodePtr node = logicalOr();
+        if (accept("?"))
+        {
+            NodePtr ifTrue = ternary();
+            expect(":");
+            NodePtr ifFalse = ternary();
+            node = makeNode(Node::Ternary, std::move(node), std::move(ifTrue), std::move(ifFalse));
+        }
+        --m_nesting;
+        return node;
+    }
+
+    NodePtr logicalOr ()
+    {
+        NodePtr node = logicalAnd();
+        while (accept("||"))
+            node = binary(FormulaProgram::Or, std::move(node), logicalAnd());
+        return node;
+    }
+
+    NodePtr logicalAnd ()
+    {
+        NodePtr node = comparison();
+        while (accept("&&"))
+            node = binary(FormulaProgram::And, std::move(node), comparison());
+        return node;
+    }
+
+    NodePtr comparison ()
+    {
+        NodePtr node = additive();
+        while (true)
+        {
+            // two-character operators go first, like in muParser
+            if (accept("<="))
+                node = binary(FormulaProgram::LessEqual, std::move(node), additive());
+            else if (accept(">="))
+                node = binary(FormulaProgram::GreaterEqual, std::move(node), additive());
+            else if (accept("!="))
+                node = binary(FormulaProgram::NotEqual, std::move(node), additive());
+            else if (accept("=="))
+                node = binary(FormulaProgram::Equal, std::move(node), additive());
+            else if (accept("<"))
+                node = binary(FormulaProgram::Less, std::move(node), additive());
+            else if (accept(">"))
+                node = binary(FormulaProgram::Greater, std::move(node), additive());
+            else
+                return node;
+        }
+    }
+
+    NodePtr additive ()
+    {
+        NodePtr node = multiplicative();
+        while (true)
+        {
+            if (accept("+"))
+                node = binary(FormulaProgram::Add, std::move(node), multiplicative());
+            else if (accept("-"))
+                node = binary(FormulaProgram::Subtract, std::move(node), multiplicative());
+            else
+                return node;
+        }
+    }
+
+    NodePtr multiplicative ()
+    {
+        NodePtr node = unary();
+        while (true)
+        {
+            if (accept("*"))
+                node = binary(FormulaProgram::Multiply, std::move(node), unary());
+            else if (accept("/"))
+                node = binary(FormulaProgram::Divide, std::move(node), unary());
+            else
+                return node;
+        }
+    }
+
+    //! At most one sign: muParser rejects e.g. "--a".
+    NodePtr unary ()
+    {
+        if (accept("-"))
+            return makeNode(Node::Negate, power());
+        accept("+");
+        return power();
+    }
+
+    NodePtr power ()
+    {
+        if (++m_nesting > MaxNesting)
+            throw Unsupported();
+        NodePtr node = primary();
+        if (accept("^"))
+            node = binary(FormulaProgram::Power, std::move(node), unary()); // right associative: unary() gets to power() again
+        --m_nesting;
+        return node;
+    }
+
+    NodePtr primary ()
+    {
+        skipWhitespace();
+        if (accept("("))
+        {
+            NodePtr node = ternary();
+            expect(")");
+            return node;
+        }
+        size_t end = m_position;
+        while (end < m_formula.size() && isNameChar(m_formula[end]))
+            ++end;
+        const std::string name (m_formula, m_position, end - m_position);
+        if (name.empty())
+            throw Unsupported();
+
+        // a function name counts only if directly followed by the opening bracket
+        const FunctionDefinition* function = findFunction(name);
+        if (function && end < m_formula.size() && m_formula[end] == '(')
+        {
+            m_position = end + 1;
+            NodePtr node (new Node(Node::Function));
+            node->function = function;
+            do
+                node->children.push_back(ternary());
+            while (accept(","));
+            expect(")");
+            const size_t numArguments = node->children.size();
+            if ((function->op == FormulaProgram::Call1 && numArguments != 1) ||
+                (function->op == FormulaProgram::Call2 && numArguments != 2) ||
+                numArguments >= FormulaProgram::MaxStackDepth)
+                throw Unsupported();
+            return node;
+        }
+
+        NodePtr node (new Node(Node::Constant));
+        if (name == "_pi")
+            node->value = M_PI;
+        else if (name == "_e")
+            node->value = M_E;
+        else if (!m_resolveConstant || !m_resolveConstant(name, node->value))
+        {
+            size_t numberEnd;
+            if (readNumber(node->value, numberEnd))
+            {
+                m_position = numberEnd;
+                return node;
+            }
+            node->kind = Node::Variable;
+            node->name = name;
+        }
+        m_position = end;
+        return node;
+    }
+
+    /* Numbers are read the way muParser does it (a stream in the classic locale, from the current position on),
+     * so e.g. "2x" is the number 2 followed by something which isn't valid. */
+    bool readNumber (double& value, size_t& end)
+    {
+        std::istringstream stream (m_formula.substr(m_position));
+        stream.imbue(std::locale::classic());
+        stream >> value;
+        std::istringstream::pos_type streamEnd = stream.tellg();
+        if (streamEnd == std::istringstream::pos_type(-1))
+            return false;
+        end = m_position + static_cast<size_t>(streamEnd);
+        return true;
+    }
+};
+
+class CodeGenerator
+{
+public:
+    CodeGenerator(): m_depth(0), m_maxDepth(0) {}
+
+    void generate (const Node& node)
+    {
+        switch (node.kind)
+        {
+        case Node::Constant:
+            emit(FormulaProgram::PushConstant, 0, node.value);
+            push(1);
+            break;
+        case Node::Variable:
+            emit(FormulaProgram::PushVariable, node.slot);
+            push(1);
+            break;
+        case Node::Negate:
+            generate(*node.children[0]);
+            emit(FormulaProgram::Negate);
+            break;
+        case Node::Binary:
+        {
+            generate(*node.children[0]);
+            const Node& right = *node.children[1];
+            // fused forms: the right operand doesn't go through the stack
+            if (right.kind == Node::Variable)
+                emit(static_cast<FormulaProgram::Opcode>(node.op + 1), right.slot);
+            else if (right.kind == Node::Constant)
+                emit(static_cast<FormulaProgram::Opcode>(node.op + 2), 0, right.value);
+            else
+            {
+                generate(right);
+                emit(node.op);
+                pop(1);
+            }
+            break;
+        }
+        case Node::Function:
+        {
+            for (const NodePtr& argument : node.children)
+                generate(*argument);
+            FormulaProgram::Instruction& instruction = emit(node.function->op, node.children.size());
+            if (node.function->op == FormulaProgram::Call1)
+                instruction.function1 = node.function->function1;
+            else if (node.function->op == FormulaProgram::Call2)
+                instruction.function2 = node.function->function2;
+            pop(node.children.size() - 1);
+            break;
+        }
+        case Node::Ternary:
+        {
+            generate(*node.children[0]);
+            const size_t jumpToElse = m_code.size();
+            emit(FormulaProgram::JumpIfZero);
+            pop(1);
+            generate(*node.children[1]);
+            const size_t jumpToEnd = m_code.size();
+            emit(FormulaProgram::Jump);
+            pop(1); // only one of the branches leaves its result
+            m_code[jumpToElse].operand = m_code.size();
+            generate(*node.children[2]);
+            m_code[jumpToEnd].operand = m_code.size();
+            break;
+        }
+        }
+    }
+
+    //! Call once the whole expression got generated.
+    void finish () { emit(FormulaProgram::Return); }
+
+    const std::vector<FormulaProgram::Instruction>& code() const { return m_code; }
+    size_t maxDepth() const { return m_maxDepth; }
+
+private:
+    std::vector<FormulaProgram::Instruction> m_code;
+    size_t m_depth;
+    size_t m_maxDepth;
+
+    FormulaProgram::Instruction& emit (FormulaProgram::Opcode op, size_t operand=0, double value=0)
+    {
+        FormulaProgram::Instruction instruction;
+        instruction.op = op;
+        instruction.operand = operand;
+        instruction.value = value; // also clears the function pointers, see programKey()
+        m_code.push_back(instruction);
+        return m_code.back();
+    }
+
+    void push (size_t n) { m_depth += n; m_maxDepth = std::max(m_maxDepth, m_depth); }
+    void pop (size_t n) { m_depth -= n; }
+};
+
+//! Gives every distinct variable a slot, in the order of their first appearance.
+void assignSlots (Node& node, std::vector<std::string>& variableNames)
+{
+    if (node.kind == Node::Variable)
+    {
+        auto it = std::find(variableNames.begin(), variableNames.end(), node.name);
+        node.slot = it - variableNames.begin();
+        if (it == variableNames.end())
+            variableNames.push_back(node.name);
+    }
+    for (NodePtr& child : node.children)
+        assignSlots(*child, variableNames);
+}
+
+/* Replaces every sub-expression which doesn't depend on variables by its value. The value is obtained by running
+ * the sub-expression's own code, so folding can't change the result. */
+void foldConstants (NodePtr& node)
+{
+    for (NodePtr& child : node->children)
+        foldConstants(child);
+    if (node->kind == Node::Constant || node->kind == Node::Variable)
+        return;
+    if (node->kind == Node::Ternary && node->children[0]->kind == Node::Constant)
+    {
+        NodePtr taken = std::move(node->children[node->children[0]->value != 0 ? 1 : 2]);
+        node = std::move(taken);
+        return;
+    }
+    for (const NodePtr& child : node->children)
+        if (child->kind != Node::Constant)
+            return;
+    CodeGenerator generator;
+    generator.generate(*node);
+    generator.finish();
+    const double value = FormulaProgram(generator.code(), generator.maxDepth()).run(nullptr);
+    node.reset(new Node(Node::Constant));
+    node->value = value;
+}
+
+//! Identifies a program: equal keys mean identical code.
+std::string programKey (const std::vector<FormulaProgram::Instruction>& code)
+{
+    std::string key;
+    key.reserve(code.size() * (1 + sizeof(uint32_t) + sizeof(double)));
+    for (const FormulaProgram::Instruction& instruction : code)
+    {
+        key.push_back(static_cast<char>(instruction.op));
+        key.append(reinterpret_cast<const char*>(&instruction.operand), sizeof instruction.operand);
+        key.append(reinterpret_cast<const char*>(&instruction.value), sizeof instruction.value);
+    }
+    return key;
+}
+
+std::mutex s_programsLock;
+std::map<std::string, std::shared_ptr<const FormulaProgram>> s_programs;
+
+}
+
+FormulaProgram::FormulaProgram(const std::vector<Instruction>& code, size_t stackDepth):
+        m_code(code),
+        m_stackDepth(stackDepth),
+        m_hasJumps(false)
+{
+    for (const Instruction& instruction : m_code)
+        if (instruction.op == JumpIfZero || instruction.op == Jump)
+            m_hasJumps = true;
+}
+
+/* The interpreter. With GCC/clang every handler jumps directly to the next one ("computed goto"), which the CPU
+ * predicts much better than the single jump of a switch; elsewhere it's the switch. */
+#if defined(__GNUC__)
+#define FORMULA_COMPUTED_GOTO
+#define FORMULA_HANDLER(OP) Handle##OP
+#define FORMULA_DISPATCH() goto *handlers[instruction->op]
+#else
+#define FORMULA_HANDLER(OP) case OP
+#define FORMULA_DISPATCH() continue
+#endif
+#define FORMULA_NEXT() { ++instruction; FORMULA_DISPATCH(); }
+
+double FormulaProgram::run(const double* const* variables) const
+{
+    // the top of the stack is kept in a local (i.e. a register), the rest of the stack in the array
+    double stack[MaxStackDepth];
+    double* below = stack;
+    double top = 0;
+    const Instruction* const begin = m_code.data();
+    const Instruction* instruction = begin;
+
+#ifdef FORMULA_COMPUTED_GOTO
+    // in the order of Opcode
+    static const void* const handlers[] =
+    {
+        &&HandlePushConstant, &&HandlePushVariable,
+        &&HandleAdd, &&HandleAddVariable, &&HandleAddConstant,
+        &&HandleSubtract, &&HandleSubtractVariable, &&HandleSubtractConstant,
+        &&HandleMultiply, &&HandleMultiplyVariable, &&HandleMultiplyConstant,
+        &&HandleDivide, &&HandleDivideVariable, &&HandleDivideConstant,
+        &&HandlePower, &&HandlePowerVariable, &&HandlePowerConstant,
+        &&HandleLess, &&HandleLessVariable, &&HandleLessConstant,
+        &&HandleLessEqual, &&HandleLessEqualVariable, &&HandleLessEqualConstant,
+        &&HandleGreater, &&HandleGreaterVariable, &&HandleGreaterConstant,
+        &&HandleGreaterEqual, &&HandleGreaterEqualVariable, &&HandleGreaterEqualConstant,
+        &&HandleEqual, &&HandleEqualVariable, &&HandleEqualConstant,
+        &&HandleNotEqual, &&HandleNotEqualVariable, &&HandleNotEqualConstant,
+        &&HandleAnd, &&HandleAndVariable, &&HandleAndConstant,
+        &&HandleOr, &&HandleOrVariable, &&HandleOrConstant,
+        &&HandleNegate,
+        &&HandleCall1, &&HandleCall2, &&HandleSum, &&HandleAverage, &&HandleMinimum, &&HandleMaximum,
+        &&HandleJumpIfZero, &&HandleJump,
+        &&HandleReturn
+    };
+    static_assert(sizeof handlers / sizeof handlers[0] == Return + 1, "Every Opcode needs its handler");
+    FORMULA_DISPATCH();
+#else
+    while (true)
+    switch (instruction->op)
+    {
+#endif
+
+    FORMULA_HANDLER(PushConstant): *below++ = top; top = instruction->value; FORMULA_NEXT();
+    FORMULA_HANDLER(PushVariable): *below++ = top; top = *variables[instruction->operand]; FORMULA_NEXT();
+
+#define FORMULA_BINARY_OPERATOR(NAME, EXPRESSION) \
+    FORMULA_HANDLER(NAME): { const double l = *--below; const double r = top; top = (EXPRESSION); FORMULA_NEXT(); } \
+    FORMULA_HANDLER(NAME##Variable): { const double l = top; const double r = *variables[instruction->operand]; top = (EXPRESSION); FORMULA_NEXT(); } \
+    FORMULA_HANDLER(NAME##Constant): { const double l = top; const double r = instruction->value; top = (EXPRESSION); FORMULA_NEXT(); }
+
+    FORMULA_BINARY_OPERATOR(Add, l + r)
+    FORMULA_BINARY_OPERATOR(Subtract, l - r)
+    FORMULA_BINARY_OPERATOR(Multiply, l * r)
+    FORMULA_BINARY_OPERATOR(Divide, l / r)
+    FORMULA_BINARY_OPERATOR(Power, std::pow(l, r))
+    FORMULA_BINARY_OPERATOR(Less, l < r)
+    FORMULA_BINARY_OPERATOR(LessEqual, l <= r)
+    FORMULA_BINARY_OPERATOR(Greater, l > r)
+    FORMULA_BINARY_OPERATOR(GreaterEqual, l >= r)
+    FORMULA_BINARY_OPERATOR(Equal, l == r)
+    FORMULA_BINARY_OPERATOR(NotEqual, l != r)
+    FORMULA_BINARY_OPERATOR(And, l && r)
+    FORMULA_BINARY_OPERATOR(Or, l || r)
+
+#undef FORMULA_BINARY_OPERATOR
+
+    FORMULA_HANDLER(Negate): top = -top; FORMULA_NEXT();
+    FORMULA_HANDLER(Call1): top = instruction->function1(top); FORMULA_NEXT();
+    FORMULA_HANDLER(Call2): { const double l = *--below; top = instruction->function2(l, top); FORMULA_NEXT(); }
+
+    // variadic functions: same order of operations as muParser's
+    FORMULA_HANDLER(Sum):
+    FORMULA_HANDLER(Average):
+    FORMULA_HANDLER(Minimum):
+    FORMULA_HANDLER(Maximum):
+    {
+        *below = top; // now all the arguments are in the array
+        double* arguments = below - (instruction->operand - 1);
+        const double* const argumentsEnd = below + 1;
+        double result;
+        if (instruction->op == Sum || instruction->op == Average)
+        {
+            result = 0;
+            for (const double* argument = arguments; argument != argumentsEnd; ++argument)
+                result += *argument;
+            if (instruction->op == Average)
+                result /= instruction->operand;
+        }
+        else
+        {
+            result = arguments[0];
+            for (const double* argument = arguments; argument != argumentsEnd; ++argument)
+                result = instruction->op == Minimum ? std::min(result, *argument) : std::max(result, *argument);
+        }
+        below = arguments;
+        top = result;
+        FORMULA_NEXT();
+    }
+
+    FORMULA_HANDLER(JumpIfZero):
+    {
+        const double condition = top;
+        top = *--below;
+        if (condition == 0)
+        {
+            instruction = begin + instruction->operand;
+            FORMULA_DISPATCH();
+        }
+        FORMULA_NEXT();
+    }
+    FORMULA_HANDLER(Jump): instruction = begin + instruction->operand; FORMULA_DISPATCH();
+    FORMULA_HANDLER(Return): return top;
+
+#ifndef FORMULA_COMPUTED_GOTO
+    }
+#endif
+}
+
+#undef FORMULA_NEXT
+#undef FORMULA_DISPATCH
+#undef FORMULA_HANDLER
+
+void FormulaProgram::runBatch(const double* const* const* variables, size_t n, double* results) const
+{
+    if (m_hasJumps)
+    {
+        for (size_t i=0; i<n; ++i)
+            results[i] = run(variables[i]);
+        return;
+    }
+    // the operations (and their order) are exactly the ones of run(), so are the results
+    double stack[MaxStackDepth][BatchSize];
+    size_t depth = 0;
+    for (const Instruction& instruction : m_code)
+    {
+        double* const top = stack[depth > 0 ? depth - 1 : 0];
+        switch (instruction.op)
+        {
+        case PushConstant:
+            std::fill(stack[depth], stack[depth] + n, instruction.value);
+            depth++;
+            break;
+        case PushVariable:
+            for (size_t i=0; i<n; ++i)
+                stack[depth][i] = *variables[i][instruction.operand];
+            depth++;
+            break;
+
+#define FORMULA_BATCH_BINARY_OPERATOR(NAME, EXPRESSION) \
+        case NAME: \
+        { \
+            double* const left = stack[depth - 2]; \
+            for (size_t i=0; i<n; ++i) { const double l = left[i]; const double r = top[i]; left[i] = (EXPRESSION); } \
+            depth--; \
+            break; \
+        } \
+        case NAME##Variable: \
+            for (size_t i=0; i<n; ++i) { const double l = top[i]; const double r = *variables[i][instruction.operand]; top[i] = (EXPRESSION); } \
+            break; \
+        case NAME##Constant: \
+        { \
+            const double r = instruction.value; \
+            for (size_t i=0; i<n; ++i) { const double l = top[i]; top[i] = (EXPRESSION); } \
+            break; \
+        }
+
+        FORMULA_BATCH_BINARY_OPERATOR(Add, l + r)
+        FORMULA_BATCH_BINARY_OPERATOR(Subtract, l - r)
+        FORMULA_BATCH_BINARY_OPERATOR(Multiply, l * r)
+        FORMULA_BATCH_BINARY_OPERATOR(Divide, l / r)
+        FORMULA_BATCH_BINARY_OPERATOR(Power, std::pow(l, r))
+        FORMULA_BATCH_BINARY_OPERATOR(Less, l < r)
+        FORMULA_BATCH_BINARY_OPERATOR(LessEqual, l <= r)
+        FORMULA_BATCH_BINARY_OPERATOR(Greater, l > r)
+        FORMULA_BATCH_BINARY_OPERATOR(GreaterEqual, l >= r)
+        FORMULA_BATCH_BINARY_OPERATOR(Equal, l == r)
+        FORMULA_BATCH_BINARY_OPERATOR(NotEqual, l != r)
+        FORMULA_BATCH_BINARY_OPERATOR(And, l && r)
+        FORMULA_BATCH_BINARY_OPERATOR(Or, l || r)
+
+#undef FORMULA_BATCH_BINARY_OPERATOR
+
+        case Negate:
+            for (size_t i=0; i<n; ++i)
+                top[i] = -top[i];
+            break;
+        case Call1:
+            for (size_t i=0; i<n; ++i)
+                top[i] = instruction.function1(top[i]);
+            break;
+        case Call2:
+        {
+            double* const left = stack[depth - 2];
+            for (size_t i=0; i<n; ++i)
+                left[i] = instruction.function2(left[i], top[i]);
+            depth--;
+            break;
+        }
+        case Sum:
+        case Average:
+        case Minimum:
+        case Maximum:
+        {
+            const size_t first = depth - instruction.operand;
+            double* const result = stack[first];
+            if (instruction.op == Sum || instruction.op == Average)
+            {
+                double sum[BatchSize] = {0};
+                for (size_t argument = first; argument < depth; ++argument)
+                    for (size_t i=0; i<n; ++i)
+                        sum[i] += stack[argument][i];
+                for (size_t i=0; i<n; ++i)
+                    result[i] = instruction.op == Average ? sum[i] / instruction.operand : sum[i];
+            }
+            else
+            {
+                for (size_t argument = first + 1; argument < depth; ++argument)
+                    for (size_t i=0; i<n; ++i)
+                        result[i] = instruction.op == Minimum ?
+                                std::min(result[i], stack[argument][i]) :
+                                std::max(result[i], stack[argument][i]);
+            }
+            depth = first + 1;
+            break;
+        }
+        case JumpIfZero:
+        case Jump:
+            break; // not in here, see m_hasJumps
+        case Return:
+            std::copy(top, top + n, results);
+            return;
+        }
+    }
+}
+
+BytecodeFormula::BytecodeFormula(const std::shared_ptr<const FormulaProgram>& program, const std::vector<const double*>& variables):
+        m_program(program),
+        m_variables(variables)
+{
+}
+
+double BytecodeFormula::evaluate()
+{
+    return m_program->run(m_variables.data());
+}
+
+std::unique_ptr<BytecodeFormula> BytecodeFormula::compile(
+        const std::string& formula,
+        const ConstantResolver& resolveConstant,
+        const VariableResolver& resolveVariable)
+{
+    NodePtr root;
+    try
+    {
+        root = Parser(formula, resolveConstant).parse();
+    }
+    catch (const Unsupported&)
+    {
+        return nullptr;
+    }
+
+    std::vector<std::string> variableNames;
+    assignSlots(*root, variableNames);
+    foldConstants(root);
+
+    CodeGenerator generator;
+    generator.generate(*root);
+    generator.finish();
+    if (generator.maxDepth() >= FormulaProgram::MaxStackDepth) // run() needs one spare element
+        return nullptr;
+
+    std::vector<const double*> variables;
+    for (const std::string& name : variableNames)
+        variables.push_back(resolveVariable(name));
+
+    std::shared_ptr<const FormulaProgram> program;
+    {
+        std::lock_guard<std::mutex> lock (s_programsLock);
+        std::shared_ptr<const FormulaProgram>& cached = s_programs[programKey(generator.code())];
+        if (!cached)
+            cached.reset(new FormulaProgram(generator.code(), generator.maxDepth()));
+        program = cached;
+    }
+    return std::unique_ptr<BytecodeFormula>(new BytecodeFormula(program, variables));
+}
+
+void BytecodeFormula::evaluateBatch(BytecodeFormula* const* formulas, size_t n, double* results)
+{
+    const double* const* variables[FormulaProgram::BatchSize];
+    for (size_t done = 0; done < n; done += FormulaProgram::BatchSize)
+    {
+        const size_t batch = std::min<size_t>(n - done, FormulaProgram::BatchSize);
+        for (size_t i=0; i<batch; ++i)
+            variables[i] = formulas[done + i]->m_variables.data();
+        formulas[done]->m_program->runBatch(variables, batch, results + done);
+    }
+}
+
+size_t BytecodeFormula::numDistinctPrograms()
+{
+    std::lock_guard<std::mutex> lock (s_programsLock);
+    return s_programs.size();
+}
+
+}
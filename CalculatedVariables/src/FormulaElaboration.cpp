@@ -0,0 +1,311 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * FormulaElaboration.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <FormulaElaboration.h>
+
+#include <stdexcept>
+#include <algorithm>
+
+namespace CalculatedVariables
+{
+
+const std::string DashSignVariableRepr {"__dash__"};
+const std::string SlashSignVariableRepr {"__slash__"};
+
+struct FormulaElaborator::Piece
+{
+    enum Kind
+    {
+        Text,
+        ThisObjectAddress,
+        ParentObjectAddress,
+        ApplyGenericFormula,
+        Error //!< a wrong dollar expression, text is the message; reported only when elaborating
+    };
+    Kind kind;
+    std::string text; //!< for Text, ApplyGenericFormula (the id) and Error
+    unsigned int numLevelsUp;
+};
+
+namespace
+{
+
+//! Generic formulas may use generic formulas, but not endlessly
+const unsigned int MaxGenericFormulaNesting = 64;
+
+bool isNameCharacter (char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+bool isArgumentCharacter (char c)
+{
+    return c != ' ' && c != '\r' && c != '\n' && c != '\t' && c != '(' && c != ')';
+}
+
+//! Accepts what "^numLevelsUp=(\d+)$" used to
+bool parseNumLevelsUp (const std::string& argument, unsigned int& numLevelsUp)
+{
+    const std::string prefix ("numLevelsUp=");
+    if (argument.compare(0, prefix.size(), prefix) != 0 || argument.size() == prefix.size())
+        return false;
+    unsigned long long value = 0;
+    for (size_t i = prefix.size(); i < argument.size(); ++i)
+    {
+        if (argument[i] < '0' || argument[i] > '9')
+            return false;
+        value = std::min<unsigned long long>(value * 10 + (argument[i] - '0'), ~0u); // way more than any address has
+    }
+    numLevelsUp = static_cast<unsigned int>(value);
+    return true;
+}
+
+/* Splits a formula into text and dollar expressions. A dollar expression is "$name" or "$name(argument)",
+ * name made of [A-Za-z0-9_], argument of anything but white-space and parentheses (if the argument doesn't
+ * fit, it's "$name" followed by text). A "$" not followed by a name is just text. */
+FormulaElaborator::Template tokenize (const std::string& formula)
+{
+    FormulaElaborator::Template pieces;
+    std::string text;
+    size_t position = 0;
+    while (position < formula.size())
+    {
+        const size_t dollar = formula.find('$', position);
+        size_t nameEnd = dollar == std::string::npos ? dollar : dollar + 1;
+        while (nameEnd < formula.size() && isNameCharacter(formula[nameEnd]))
+            nameEnd++;
+        if (dollar == std::string::npos || nameEnd == dollar + 1)
+        {
+            const size_t textEnd = dollar == std::string::npos ? formula.size() : dollar + 1;
+            text.append(formula, position, textEnd - position);
+            position = textEnd;
+            continue;
+        }
+        text.append(formula, position, dollar - position);
+
+        const std::string name (formula, dollar + 1, nameEnd - dollar - 1);
+        bool argumentPresent = false;
+        std::string argument;
+        size_t end = nameEnd;
+        if (nameEnd < formula.size() && formula[nameEnd] == '(')
+        {
+            size_t argumentEnd = nameEnd + 1;
+            while (argumentEnd < formula.size() && isArgumentCharacter(formula[argumentEnd]))
+                argumentEnd++;
+            if (argumentEnd > nameEnd + 1 && argumentEnd < formula.size() && formula[argumentEnd] == ')')
+            {
+                argumentPresent = true;
+                argument.assign(formula, nameEnd + 1, argumentEnd - nameEnd - 1);
+                end = argumentEnd + 1;
+            }
+        }
+
+        FormulaElaborator::Piece piece;
+        piece.numLevelsUp = 0;
+        if (name == "_" || name == "thisObjectAddress")
+        {
+            piece.kind = FormulaElaborator::Piece::ThisObjectAddress;
+            if (argumentPresent)
+            {
+                piece.kind = FormulaElaborator::Piece::Error;
+                piece.text = "$" + name + " expression does not take arguments!";
+            }
+        }
+        else if (name == "applyGenericFormula")
+        {
+            piece.kind = FormulaElaborator::Piece::ApplyGenericFormula;
+            piece.text = argument;
+            if (!argumentPresent)
+            {
+                piece.kind = FormulaElaborator::Piece::Error;
+                piece.text = "$applyGenericFormula expects a single argument -- formula id";
+            }
+        }
+        else if (name == "parentObjectAddress")
+        {
+            piece.kind = FormulaElaborator::Piece::ParentObjectAddress;
+            if (!argumentPresent)
+            {
+                piece.kind = FormulaElaborator::Piece::Error;
+                piece.text = "$" + name + " expression requires an argument";
+            }
+            else if (!parseNumLevelsUp(argument, piece.numLevelsUp))
+            {
+                piece.kind = FormulaElaborator::Piece::Error;
+                piece.text = "Argument did not fit the expected syntax, for example: $parentObjectAddress(numLevelsUp=2)";
+            }
+        }
+        else
+        {
+            piece.kind = FormulaElaborator::Piece::Error;
+            piece.text = "Invalid dollar expression: " + formula.substr(dollar, end - dollar);
+        }
+
+        if (!text.empty())
+        {
+            FormulaElaborator::Piece textPiece;
+            textPiece.kind = FormulaElaborator::Piece::Text;
+            textPiece.text.swap(text);
+            textPiece.numLevelsUp = 0;
+            pieces.push_back(textPiece);
+            text.clear();
+        }
+        pieces.push_back(piece);
+        position = end;
+    }
+    if (!text.empty())
+    {
+        FormulaElaborator::Piece textPiece;
+        textPiece.kind = FormulaElaborator::Piece::Text;
+        textPiece.text.swap(text);
+        textPiece.numLevelsUp = 0;
+        pieces.push_back(textPiece);
+    }
+    return pieces;
+}
+
+std::string elaborateParent (const std::string& input, unsigned int levels)
+{
+    // the assumption is that for every level to go up we find the dot and cut off at such place
+    std::size_t cutOffIndex = std::string::npos;
+    while (levels > 0)
+    {
+        cutOffIndex = input.rfind('.', cutOffIndex);
+        if (cutOffIndex == std::string::npos)
+            throw std::runtime_error("Not enough levels to go up!");
+        levels--;
+        if (levels>0)
+        {
+            if (cutOffIndex>0)
+                cutOffIndex--;
+            else
+                throw std::runtime_error("Not enough levels to go up!");
+        }
+    }
+    return input.substr(0, cutOffIndex);
+}
+
+//! One pass over input, appending to output, with each of the (one character long) special ones prefixed by escape replaced
+void escapeSpecialCharacters (const std::string& input, bool backslashed, std::string& output)
+{
+    output.reserve(output.size() + input.size());
+    for (size_t i = 0; i < input.size(); ++i)
+    {
+        size_t special = i;
+        if (backslashed)
+        {
+            if (input[i] != '\\' || i + 1 == input.size())
+            {
+                output.push_back(input[i]);
+                continue;
+            }
+            special = i + 1;
+        }
+        if (input[special] == '-')
+            output.append(DashSignVariableRepr);
+        else if (input[special] == '/')
+            output.append(SlashSignVariableRepr);
+        else
+        {
+            output.push_back(input[i]);
+            continue;
+        }
+        i = special;
+    }
+}
+
+}
+
+std::string escapeSpecialCharactersInFormula (const std::string& inputFormula)
+{
+    std::string output;
+    escapeSpecialCharacters(inputFormula, /*backslashed*/ true, output);
+    return output;
+}
+
+std::string escapeSpecialCharactersInParserVariableName (const std::string& input)
+{
+    std::string output;
+    escapeSpecialCharacters(input, /*backslashed*/ false, output);
+    return output;
+}
+
+bool FormulaElaborator::addGenericFormula (const std::string& id, const std::string& formula)
+{
+    std::shared_ptr<const Template>& pieces = m_genericFormulas[id];
+    if (pieces)
+        return false;
+    pieces.reset(new Template(tokenize(formula)));
+    return true;
+}
+
+std::shared_ptr<const FormulaElaborator::Template> FormulaElaborator::templateOf (const std::string& formula)
+{
+    std::lock_guard<std::mutex> lock (m_templatesLock);
+    std::shared_ptr<const Template>& pieces = m_templates[formula];
+    if (!pieces)
+        pieces.reset(new Template(tokenize(formula)));
+    return pieces;
+}
+
+std::string FormulaElaborator::elaborate (const std::string& formula, const std::string& parentObjectAddress)
+{
+    std::string expanded;
+    expand(*templateOf(formula), parentObjectAddress, 0, expanded);
+    return escapeSpecialCharactersInFormula(expanded);
+}
+
+void FormulaElaborator::expand (
+        const Template& pieces,
+        const std::string& parentObjectAddress,
+        unsigned int depth,
+        std::string& output) const
+{
+    for (const Piece& piece : pieces)
+    {
+        switch (piece.kind)
+        {
+        case Piece::Text:
+            output.append(piece.text);
+            break;
+        case Piece::ThisObjectAddress:
+            escapeSpecialCharacters(parentObjectAddress, /*backslashed*/ false, output);
+            break;
+        case Piece::ParentObjectAddress:
+            escapeSpecialCharacters(elaborateParent(parentObjectAddress, piece.numLevelsUp), /*backslashed*/ false, output);
+            break;
+        case Piece::ApplyGenericFormula:
+        {
+            decltype(m_genericFormulas)::const_iterator it = m_genericFormulas.find(piece.text);
+            if (it == m_genericFormulas.end())
+                throw std::runtime_error("Generic Formula id='" + piece.text + "' was referenced but never declared.");
+            if (depth >= MaxGenericFormulaNesting)
+                throw std::runtime_error("Generic Formula id='" + piece.text + "' nested too deeply, does it apply itself?");
+            expand(*it->second, parentObjectAddress, depth + 1, output);
+            break;
+        }
+        case Piece::Error:
+            throw std::runtime_error(piece.text);
+        }
+    }
+}
+
+}
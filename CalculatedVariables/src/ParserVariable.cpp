@@ -25,12 +25,149 @@
 #include <CalculatedVariablesLogComponentId.h>
 #include <ParserVariable.h>
 #include <CalculatedVariable.h>
+#include <AsyncEvaluator.h>
+#include <FormulaBytecode.h>
 
 #include <mutex> // for lock_guard
+#include <algorithm>
+#include <functional>
+#include <vector>
 
 namespace CalculatedVariables
 {
 
+namespace
+{
+
+struct ByTopologicalRank
+{
+    // std::push_heap/pop_heap put the "largest" on top, we want the lowest rank there
+    bool operator()(const CalculatedVariable* a, const CalculatedVariable* b) const { return a->topologicalRank() > b->topologicalRank(); }
+};
+
+/* The CalculatedVariables which still have to be evaluated in the propagation of a change. Evaluating one publishes
+ * its value, which (through its own ParserVariable) schedules the ones depending on it -- they all come later in the
+ * topological order, so every CalculatedVariable sees its inputs already updated and is evaluated only once. */
+typedef std::vector<CalculatedVariable*> Propagation; // a heap, see push() and pop()
+
+/* The storage of the propagations this thread runs, one at a time: kept, so that a change doesn't cost allocating
+ * the heap over again. */
+thread_local Propagation s_propagationStorage;
+
+//! The propagation which this thread is running, if any. Propagations don't cross synchronization domains.
+thread_local Propagation* s_currentPropagation = nullptr;
+
+void push (Propagation& propagation, CalculatedVariable* variable)
+{
+    propagation.push_back(variable);
+    std::push_heap(propagation.begin(), propagation.end(), ByTopologicalRank());
+}
+
+CalculatedVariable* top (const Propagation& propagation)
+{
+    return propagation.front();
+}
+
+void pop (Propagation& propagation)
+{
+    std::pop_heap(propagation.begin(), propagation.end(), ByTopologicalRank());
+    propagation.pop_back();
+}
+
+void schedule (Propagation& propagation, const std::list<CalculatedVariable*>& variables)
+{
+    for (CalculatedVariable* variable : variables)
+    {
+        if (!variable->isScheduled())
+        {
+            variable->setScheduled(true);
+            push(propagation, variable);
+        }
+    }
+}
+
+/* Evaluates variables of the same level, which don't depend on each other. The ones sharing a bytecode program
+ * (typically instances of a generic formula) are evaluated together, as a batch. */
+void evaluateLevel (std::vector<CalculatedVariable*>& level)
+{
+    std::stable_sort(level.begin(), level.end(), [](const CalculatedVariable* a, const CalculatedVariable* b)
+    {
+        return std::less<const FormulaProgram*>()(a->bytecodeValueFormula() ? a->bytecodeValueFormula()->program().get() : nullptr,
+                b->bytecodeValueFormula() ? b->bytecodeValueFormula()->program().get() : nullptr);
+    });
+    static thread_local std::vector<BytecodeFormula*> formulas;
+    static thread_local std::vector<double> values;
+    for (size_t begin = 0; begin < level.size(); )
+    {
+        BytecodeFormula* const formula = level[begin]->bytecodeValueFormula();
+        size_t end = begin + 1;
+        if (formula)
+            while (end < level.size() && level[end]->bytecodeValueFormula() &&
+                    level[end]->bytecodeValueFormula()->program() == formula->program())
+                end++;
+        if (end - begin == 1)
+        {
+            LOG(Log::TRC, logComponentId) << "Notifying variable " << level[begin]->nodeId().toString().toUtf8();
+            level[begin]->update();
+        }
+        else
+        {
+            formulas.clear();
+            for (size_t i = begin; i < end; ++i)
+                formulas.push_back(level[i]->bytecodeValueFormula());
+            values.resize(formulas.size());
+            BytecodeFormula::evaluateBatch(formulas.data(), formulas.size(), values.data());
+            LOG(Log::TRC, logComponentId) << "Evaluated a batch of " << formulas.size() << " formulas";
+            for (size_t i = begin; i < end; ++i)
+                level[i]->update(values[i - begin]);
+        }
+        begin = end;
+    }
+}
+
+//! Evaluates the scheduled variables in topological order, including the ones which get scheduled meanwhile.
+void run (Propagation& propagation)
+{
+    s_currentPropagation = &propagation;
+    try
+    {
+        static thread_local std::vector<CalculatedVariable*> level;
+        while (!propagation.empty())
+        {
+            CalculatedVariable* variable = top(propagation);
+            pop(propagation);
+            variable->setScheduled(false);
+            if (propagation.empty() || top(propagation)->topologicalRank() != variable->topologicalRank())
+            {
+                LOG(Log::TRC, logComponentId) << "Notifying variable " << variable->nodeId().toString().toUtf8();
+                variable->update();
+                continue;
+            }
+            level.assign(1, variable);
+            while (!propagation.empty() && top(propagation)->topologicalRank() == variable->topologicalRank())
+            {
+                level.push_back(top(propagation));
+                pop(propagation);
+                level.back()->setScheduled(false);
+            }
+            evaluateLevel(level);
+        }
+    }
+    catch (...)
+    {
+        for (CalculatedVariable* variable : propagation)
+            variable->setScheduled(false);
+        propagation.clear();
+        s_currentPropagation = nullptr;
+        throw;
+    }
+    s_currentPropagation = nullptr;
+}
+
+}
+
+bool ParserVariable::s_orderedPropagation = false;
+
 /* a note regarding name: in the first implementation, the name of the ParserVariable (which is the id presented in a formula) used to be identical
  * to the name under which the variable was present in the address-space. However we saw that there was a need for names with dashes ("-", minus sign)
  * for which the address-space name was containing the dash but the parser name must have been substituted, otherwise the dash would have been considered
@@ -41,7 +178,8 @@ ParserVariable::ParserVariable(AddressSpace::ChangeNotifyingVariable* notifyingV
         m_name(name),
         m_value(0),
         m_state(State::WaitingInitialData),
-        m_isConstant(false)
+        m_isConstant(false),
+        m_listenerHandle(0)
 {
 	if (notifyingVariable)
 		LOG(Log::TRC, logComponentId) << "Created ParserVariable id: " << name << " for a variable identified as: " << notifyingVariable->nodeId().toString().toUtf8();
@@ -54,9 +192,19 @@ std::string ParserVariable::name() const
     return m_name;
 }
 
+size_t ParserVariable::memoryUsage() const
+{
+    const char* const begin = reinterpret_cast<const char*>(this);
+    const bool nameOnHeap = m_name.data() < begin || m_name.data() >= begin + sizeof *this; // i.e. no short string optimization
+    return sizeof *this +
+            (nameOnHeap ? m_name.capacity() + 1 : 0) +
+            m_notifiedVariables.size() * (sizeof(CalculatedVariable*) + 2 * sizeof(void*)) +
+            m_synchronizers.capacity() * sizeof(SharedSynchronizer);
+}
+
 void ParserVariable::setValue(double v, State state)
 {
-    if (m_synchronizer)
+    if (!m_synchronizers.empty())
         this->setValueSynchronized(v, state);
     else
         this->setValueNonSynchronized(v, state);
@@ -66,17 +214,72 @@ void ParserVariable::setValueNonSynchronized(double v, State state)
 {
     m_value = v;
     m_state = state;
-    for (CalculatedVariable* notifiedVariable : m_notifiedVariables)
+    if (!s_orderedPropagation)
     {
-        LOG(Log::TRC, logComponentId) << "Notifying variable " << notifiedVariable->nodeId().toString().toUtf8();
-        notifiedVariable->update();
+        // still instantiating, just follow the graph
+        for (CalculatedVariable* notifiedVariable : m_notifiedVariables)
+        {
+            LOG(Log::TRC, logComponentId) << "Notifying variable " << notifiedVariable->nodeId().toString().toUtf8();
+            notifiedVariable->update();
+        }
+        return;
     }
+    if (s_currentPropagation)
+    {
+        // we're the output of a CalculatedVariable evaluated in an ongoing propagation
+        schedule(*s_currentPropagation, m_notifiedVariables);
+        return;
+    }
+    if (m_notifiedVariables.empty())
+        return;
+    AsyncEvaluator* asyncEvaluator = AsyncEvaluator::instance();
+    if (asyncEvaluator && !m_synchronizers.empty() && asyncEvaluator->markDirty(m_notifiedVariables))
+        return; // evaluation threads will take it from here
+
+    schedule(s_propagationStorage, m_notifiedVariables);
+    run(s_propagationStorage);
+}
+
+void ParserVariable::evaluateScheduled(const std::vector<CalculatedVariable*>& variables)
+{
+    s_propagationStorage.assign(variables.begin(), variables.end());
+    std::make_heap(s_propagationStorage.begin(), s_propagationStorage.end(), ByTopologicalRank());
+    run(s_propagationStorage);
 }
 
 void ParserVariable::setValueSynchronized(double v, State state)
 {
-    std::lock_guard<Synchronizer> lock (*m_synchronizer);
-    this->setValueNonSynchronized(v, state);
+    if (m_synchronizers.size() == 1)
+    {
+        std::lock_guard<Synchronizer> lock (*m_synchronizers.front());
+        this->setValueNonSynchronized(v, state);
+        return;
+    }
+    // a shared input: everybody takes multiple synchronizers in the same order, so this can't dead-lock
+    size_t numLocked = 0;
+    try
+    {
+        for (; numLocked < m_synchronizers.size(); ++numLocked)
+            m_synchronizers[numLocked]->lock();
+        this->setValueNonSynchronized(v, state);
+    }
+    catch (...)
+    {
+        while (numLocked > 0)
+            m_synchronizers[--numLocked]->unlock();
+        throw;
+    }
+    while (numLocked > 0)
+        m_synchronizers[--numLocked]->unlock();
+}
+
+void ParserVariable::addSynchronizer(const SharedSynchronizer& synchronizer)
+{
+    std::vector<SharedSynchronizer>::iterator it = std::lower_bound(
+            m_synchronizers.begin(), m_synchronizers.end(), synchronizer,
+            [](const SharedSynchronizer& a, const SharedSynchronizer& b) { return std::less<Synchronizer*>()(a.get(), b.get()); });
+    if (it == m_synchronizers.end() || *it != synchronizer)
+        m_synchronizers.insert(it, synchronizer);
 }
 
 void ParserVariable::addNotifiedVariable(CalculatedVariable* notifiedVariable)
@@ -0,0 +1,221 @@
+/*
+ * benchmark_formula_elaboration.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  Compares the elaboration of formulas (resolving $_, $parentObjectAddress(...), $applyGenericFormula(...) and
+ *  escaping dashes and slashes) done by FormulaElaborator against the regex-based one CalculatedVariables used
+ *  before, copied below. The configuration is synthetic: crates of boards of channels, every channel with a few
+ *  CalculatedVariables, some of them applying generic formulas. Both must give the same formula for every
+ *  CalculatedVariable, otherwise the benchmark fails.
+ *
+ *  Usage: benchmark_formula_elaboration [numCalculatedVariables]
+ */
+
+#include <FormulaElaboration.h>
+
+#include <boost/xpressive/xpressive.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+using namespace CalculatedVariables;
+using namespace boost::xpressive;
+
+namespace Legacy
+{
+
+static std::map<std::string, std::string> s_genericFormulas;
+
+static std::string elaborateParent (const std::string& input, unsigned int levels)
+{
+    std::size_t cutOffIndex = std::string::npos;
+    while (levels > 0)
+    {
+        cutOffIndex = input.rfind('.', cutOffIndex);
+        if (cutOffIndex == std::string::npos)
+            throw std::runtime_error("Not enough levels to go up!");
+        levels--;
+        if (levels>0)
+        {
+            if (cutOffIndex>0)
+                cutOffIndex--;
+            else
+                throw std::runtime_error("Not enough levels to go up!");
+        }
+    }
+    return input.substr(0, cutOffIndex);
+}
+
+static std::string replaceAll (const std::string& input, const std::string& from, const std::string& to)
+{
+    std::string replica (input);
+    std::string::size_type pos;
+    do
+    {
+        pos = replica.find(from);
+        if (pos != std::string::npos)
+            replica.replace(pos, from.length(), to);
+    }
+    while (pos != std::string::npos);
+    return replica;
+}
+
+static std::string escapeSpecialCharactersInFormula (const std::string& inputFormula)
+{
+    return replaceAll(replaceAll(inputFormula, "\\-", DashSignVariableRepr), "\\/", SlashSignVariableRepr);
+}
+
+static std::string escapeSpecialCharactersInParserVariableName (const std::string& input)
+{
+    return replaceAll(replaceAll(input, "-", DashSignVariableRepr), "/", SlashSignVariableRepr);
+}
+
+static std::string elaborateFormula (const std::string& formula, const std::string& parentObjectAddress)
+{
+    basic_regex<std::string::iterator> cvSubstitutionRegex = basic_regex<std::string::iterator>::compile("\\$([A-Za-z0-9_]+)(?:(?:\\()([^ \r\n\t()]+)(?:\\)))?");
+    match_results<std::string::iterator> matched;
+    std::string formulaInWork (formula);
+    bool matchedAnything (false);
+    do
+    {
+        matchedAnything = regex_search(formulaInWork.begin(), formulaInWork.end(), matched, cvSubstitutionRegex);
+        if (matchedAnything)
+        {
+            std::string operation = matched[1];
+            bool argumentPresent = matched[2].matched;
+            std::string argument = matched[2];
+            if (operation == "_" || operation == "thisObjectAddress")
+            {
+                if (argumentPresent)
+                    throw std::runtime_error("$"+operation+" expression does not take arguments!");
+                formulaInWork.replace(matched[0].first, matched[0].second, escapeSpecialCharactersInParserVariableName(parentObjectAddress));
+            }
+            else if (operation == "applyGenericFormula")
+            {
+                if (!argumentPresent)
+                    throw std::runtime_error("$applyGenericFormula expects a single argument -- formula id");
+                std::map<std::string, std::string>::const_iterator it = s_genericFormulas.find(argument);
+                if (it == s_genericFormulas.end())
+                    throw std::runtime_error("Generic Formula id='"+argument+"' was referenced but never declared.");
+                formulaInWork.replace(matched[0].first, matched[0].second, it->second);
+            }
+            else if (operation == "parentObjectAddress")
+            {
+                if (!argumentPresent)
+                    throw std::runtime_error("$"+operation+" expression requires an argument");
+                basic_regex<std::string::iterator> argumentFormat = basic_regex<std::string::iterator>::compile("^numLevelsUp=(\\d+)$");
+                match_results<std::string::iterator> myMatchResults;
+                if (!regex_match(argument, myMatchResults, argumentFormat))
+                    throw std::runtime_error("Argument did not fit the expected syntax, for example: $parentObjectAddress(numLevelsUp=2)");
+                unsigned int numLevelsUp = std::stoi(myMatchResults[1]);
+                formulaInWork.replace(matched[0].first, matched[0].second,
+                        escapeSpecialCharactersInParserVariableName(elaborateParent(parentObjectAddress, numLevelsUp)));
+            }
+            else
+                throw std::runtime_error("Invalid dollar expression: "+matched[0].str());
+        }
+    }
+    while (matchedAnything);
+    return escapeSpecialCharactersInFormula(formulaInWork);
+}
+
+}
+
+struct Instance
+{
+    const char* formula;
+    std::string parentObjectAddress;
+};
+
+static const char* s_genericFormulas[][2] =
+{
+    {"power", "$_.voltage * $_.current"},
+    {"overTemperature", "$_.temperature > $parentObjectAddress(numLevelsUp=1).temperatureLimit"},
+    {"powerInWatts", "$applyGenericFormula(power) / 1000"}
+};
+
+static const char* s_formulas[] =
+{
+    "$applyGenericFormula(power)",
+    "$applyGenericFormula(overTemperature)",
+    "$applyGenericFormula(powerInWatts) + $thisObjectAddress.offset",
+    "$_.voltage - $parentObjectAddress(numLevelsUp=2).nominalVoltage",
+    "$_.current > 0 ? $_.voltage / $_.current : 0",
+    "crate\\-0.board\\-0.channel\\-0.voltage + 1"
+};
+
+//! Returns the time per formula, in ns
+template<typename Elaborate>
+static double elaborateAll (const std::vector<Instance>& instances, std::vector<std::string>& results, Elaborate elaborate)
+{
+    results.clear();
+    results.reserve(instances.size());
+    Clock::time_point start = Clock::now();
+    for (const Instance& instance : instances)
+        results.push_back(elaborate(instance.formula, instance.parentObjectAddress));
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / instances.size();
+}
+
+int main (int argc, char* argv[])
+{
+    const size_t numCalculatedVariables = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    const size_t numFormulas = sizeof s_formulas / sizeof s_formulas[0];
+
+    FormulaElaborator elaborator;
+    for (const auto& generic : s_genericFormulas)
+    {
+        Legacy::s_genericFormulas[generic[0]] = generic[1];
+        elaborator.addGenericFormula(generic[0], generic[1]);
+    }
+
+    std::vector<Instance> instances;
+    instances.reserve(numCalculatedVariables);
+    for (size_t crate = 0; instances.size() < numCalculatedVariables; ++crate)
+        for (size_t board = 0; board < 16 && instances.size() < numCalculatedVariables; ++board)
+            for (size_t channel = 0; channel < 64 && instances.size() < numCalculatedVariables; ++channel)
+            {
+                const std::string address = "crate-" + std::to_string(crate) + ".board-" + std::to_string(board) +
+                        ".channel/" + std::to_string(channel);
+                for (size_t i = 0; i < numFormulas && instances.size() < numCalculatedVariables; ++i)
+                    instances.push_back(Instance{s_formulas[i], address});
+            }
+
+    std::vector<std::string> legacyResults, results;
+    const double nsLegacy = elaborateAll(instances, legacyResults, Legacy::elaborateFormula);
+    const double ns = elaborateAll(instances, results,
+            [&elaborator](const char* formula, const std::string& parentObjectAddress)
+            {
+                return elaborator.elaborate(formula, parentObjectAddress);
+            });
+
+    size_t numDifferent = 0;
+    for (size_t i = 0; i < instances.size(); ++i)
+        if (results[i] != legacyResults[i])
+        {
+            if (numDifferent++ < 10)
+                std::cout << "Elaboration differs for: " << instances[i].formula << " at " << instances[i].parentObjectAddress <<
+                    " legacy: " << legacyResults[i] << " now: " << results[i] << std::endl;
+        }
+
+    std::cout << "CalculatedVariables: " << instances.size() << std::endl << std::fixed << std::setprecision(1) <<
+            "regex-based:        " << std::setw(10) << nsLegacy << " ns/formula, " << nsLegacy * instances.size() / 1e6 << " ms total" << std::endl <<
+            "FormulaElaborator:  " << std::setw(10) << ns << " ns/formula, " << ns * instances.size() / 1e6 << " ms total" << std::endl <<
+            "speedup:            " << std::setw(10) << nsLegacy / ns << "x" << std::endl;
+
+    if (numDifferent > 0)
+    {
+        std::cout << numDifferent << " elaborations differ, FAILED" << std::endl;
+        return 1;
+    }
+    return 0;
+}
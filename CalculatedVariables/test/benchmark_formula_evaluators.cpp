@@ -0,0 +1,210 @@
+/*
+ * benchmark_formula_evaluators.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  Compares the CalculatedVariables formula backends: muParser (a mu::Parser per formula, as CalculatedVariable
+ *  always did) against the bytecode one (FormulaBytecode). The formulas are the ones of
+ *  .CI/test_cases/test_calculated_variables, as they look after elaboration, plus a few using functions and
+ *  the ternary operator. Inputs get changed between evaluations, like they would be in a server.
+ *  Both backends must agree on every result, otherwise the benchmark fails.
+ *  Then, a few generic formulas are instantiated for a crate of channels and evaluated instance by instance
+ *  and in batches (BytecodeFormula::evaluateBatch), which again must give the same results.
+ *
+ *  Usage: benchmark_formula_evaluators [evaluationsPerFormula]
+ */
+
+#include <FormulaBytecode.h>
+#include <muParser.h>
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+using namespace CalculatedVariables;
+
+static std::map<std::string, double> s_variables;
+
+static double* muParserVariableFactory (const char* name, void*)
+{
+    return &s_variables[name];
+}
+
+static const char* s_formulas[] =
+{
+    // test_calculated_variables
+    "7",
+    "tc.fv + 11",
+    "tc.fv + tc.calc_var_const",
+    "tc.fv + tc.calc_var_const + tc.cv_init_from_config",
+    "tc.fv + tc.calc_var_const + tc.cv_init_from_value_status",
+    "tc.calc_var_const*tc.calc_var_fv_plus_const*tc.ce*tc.cv_init_from_config*tc.cv_init_from_value_status*tc.fv*"
+        "tc.calc_var_fv_plus_const_plus_cv_init_from_config*tc.calc_var_fv_plus_const_plus_cv_init_from_value_status*tc.fv_plus_11",
+    // other typical ones
+    "tc.fv > 10 && tc.calc_var_const < 8",
+    "tc.fv > tc.ce ? tc.fv - tc.ce : tc.ce - tc.fv",
+    "sqrt(tc.fv*tc.fv + tc.ce*tc.ce) * (2*_pi/360)",
+    "max(tc.fv, tc.ce, tc.cv_init_from_config) - min(tc.fv, tc.ce, tc.cv_init_from_config)",
+    "(tc.fv - 32) * 5 / 9 + 273.15"
+};
+
+// as in a crate of channels, after $applyGenericFormula
+static const char* s_genericFormulas[] =
+{
+    "(ch.t - 32) * 5 / 9 + 273.15",
+    "ch.v * ch.i",
+    "sqrt(ch.v*ch.v + ch.i*ch.i) * 0.5 - ch.t",
+    "1/( 3.3540154*10^(-3)+(2.5627725*10^(-4)*log(1000*ch.r/500))+(2.0829210*10^(-6)*(log(1000*ch.r/500))^2)) -273.15",
+    "ch.v > ch.i ? ch.v : ch.i"
+};
+
+//! Returns false if batch and one-by-one evaluation don't agree
+static bool benchmarkGenericFormula (const char* formula, size_t numChannels, size_t rounds)
+{
+    std::vector<std::map<std::string, double>> channels (numChannels);
+    std::vector<std::unique_ptr<BytecodeFormula>> instances;
+    std::vector<BytecodeFormula*> batch;
+    for (size_t channel=0; channel<numChannels; ++channel)
+    {
+        instances.push_back(BytecodeFormula::compile(
+                formula,
+                [](const std::string&, double&) { return false; },
+                [&](const std::string& name) { return &channels[channel][name]; }));
+        batch.push_back(instances.back().get());
+    }
+    std::vector<double> oneByOne (numChannels);
+    std::vector<double> batched (numChannels);
+    double oneByOneNs = 0;
+    double batchNs = 0;
+    for (size_t round=0; round<rounds; ++round)
+    {
+        for (size_t channel=0; channel<numChannels; ++channel)
+            for (auto& variable : channels[channel])
+                variable.second = double((channel * 7 + round * 3) % 101) / 3 + 1;
+
+        Clock::time_point start = Clock::now();
+        for (size_t channel=0; channel<numChannels; ++channel)
+            oneByOne[channel] = instances[channel]->evaluate();
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / numChannels;
+        oneByOneNs = round == 0 ? ns : std::min(oneByOneNs, ns);
+
+        start = Clock::now();
+        BytecodeFormula::evaluateBatch(batch.data(), numChannels, batched.data());
+        const double nsBatch = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / numChannels;
+        batchNs = round == 0 ? nsBatch : std::min(batchNs, nsBatch);
+
+        if (std::memcmp(oneByOne.data(), batched.data(), numChannels * sizeof(double)) != 0)
+        {
+            std::cout << "Batch evaluation differs for: " << formula << std::endl;
+            return false;
+        }
+    }
+    std::string shownFormula (formula);
+    if (shownFormula.size() > 48)
+        shownFormula = shownFormula.substr(0, 45) + "...";
+    std::cout << std::left << std::setw(50) << shownFormula << std::right << std::fixed << std::setprecision(2) <<
+            std::setw(12) << oneByOneNs << std::setw(12) << batchNs << std::setw(9) << oneByOneNs / batchNs << "x" << std::endl;
+    return true;
+}
+
+/* Every evaluation sees different inputs (the same sequence for both backends). The best of a few rounds is taken,
+ * sum gets the sum of the results of the last round. */
+template<typename F>
+static double nsPerEvaluation (size_t evaluations, const std::vector<double*>& inputs, F evaluate, double& sum)
+{
+    double samples[256];
+    for (size_t i=0; i<256; ++i)
+        samples[i] = double(i % 97) - 13.5;
+    double best = 0;
+    for (int round=0; round<5; ++round)
+    {
+        sum = 0;
+        Clock::time_point start = Clock::now();
+        for (size_t i=0; i<evaluations; ++i)
+        {
+            for (size_t j=0; j<inputs.size(); ++j)
+                *inputs[j] = samples[(i + j) & 255];
+            sum += evaluate();
+        }
+        const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / evaluations;
+        if (round == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+int main (int argc, char* argv[])
+{
+    const size_t evaluations = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+    std::cout << std::left << std::setw(50) << "formula" << std::right <<
+            std::setw(12) << "muParser" << std::setw(12) << "bytecode" << std::setw(10) << "speedup" <<
+            "   [ns per evaluation]" << std::endl;
+
+    double totalMuParser = 0;
+    double totalBytecode = 0;
+    bool agree = true;
+    for (const char* formula : s_formulas)
+    {
+        s_variables.clear();
+
+        mu::Parser parser;
+        parser.DefineNameChars("0123456789_abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ.");
+        parser.SetExpr(formula);
+        parser.SetVarFactory(muParserVariableFactory, nullptr);
+        parser.Eval();
+
+        std::unique_ptr<BytecodeFormula> bytecode = BytecodeFormula::compile(
+                formula,
+                [](const std::string&, double&) { return false; },
+                [](const std::string& name) { return &s_variables[name]; });
+        if (!bytecode)
+        {
+            std::cout << "Bytecode backend couldn't compile: " << formula << std::endl;
+            return 1;
+        }
+
+        std::vector<double*> inputs;
+        for (auto& variable : s_variables)
+            inputs.push_back(&variable.second);
+
+        double sumMuParser = 0;
+        const double muParserNs = nsPerEvaluation(evaluations, inputs, [&](){ return parser.Eval(); }, sumMuParser);
+        double sumBytecode = 0;
+        const double bytecodeNs = nsPerEvaluation(evaluations, inputs, [&](){ return bytecode->evaluate(); }, sumBytecode);
+
+        if (std::fabs(sumMuParser - sumBytecode) > 1e-9 * std::max(1.0, std::fabs(sumMuParser)))
+        {
+            std::cout << "Results differ for: " << formula << " muParser: " << sumMuParser << " bytecode: " << sumBytecode << std::endl;
+            agree = false;
+        }
+
+        std::string shownFormula (formula);
+        if (shownFormula.size() > 48)
+            shownFormula = shownFormula.substr(0, 45) + "...";
+        std::cout << std::left << std::setw(50) << shownFormula << std::right << std::fixed << std::setprecision(2) <<
+                std::setw(12) << muParserNs << std::setw(12) << bytecodeNs << std::setw(9) << muParserNs / bytecodeNs << "x" << std::endl;
+        totalMuParser += muParserNs;
+        totalBytecode += bytecodeNs;
+    }
+    std::cout << std::left << std::setw(50) << "all formulas" << std::right << std::fixed << std::setprecision(2) <<
+            std::setw(12) << totalMuParser << std::setw(12) << totalBytecode << std::setw(9) << totalMuParser / totalBytecode << "x" << std::endl;
+    std::cout << "Distinct bytecode programs: " << BytecodeFormula::numDistinctPrograms() << std::endl;
+
+    const size_t numChannels = 1000;
+    std::cout << std::endl << std::left << std::setw(50) << "generic formula, 1000 channels" << std::right <<
+            std::setw(12) << "1-by-1" << std::setw(12) << "batch" << std::setw(10) << "speedup" <<
+            "   [ns per channel]" << std::endl;
+    for (const char* formula : s_genericFormulas)
+        agree = benchmarkGenericFormula(formula, numChannels, std::max<size_t>(evaluations / numChannels, 1)) && agree;
+    return agree ? 0 : 1;
+}
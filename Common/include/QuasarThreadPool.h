@@ -25,13 +25,19 @@
 #include <mutex>
 #include <vector>
 #include <thread>
-#include <list>
-#include <queue>
+#include <atomic>
+#include <memory>
 #include <condition_variable>
 #include <functional>
+#include <utility>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
 
 #include <statuscode.h>
 
+#include <QuasarWorkStealingQueues.h>
+
 namespace Quasar
 {
 
@@ -42,30 +48,178 @@ public:
 
     virtual void execute() = 0;
 
+    //! Only called when there is something to report (e.g. an exception was thrown), so it may be costly.
     virtual std::string describe() const = 0;
+
+    //! Called by the ThreadPool when it's done with the job. Jobs that weren't created with plain new should override it.
+    virtual void dispose() { delete this; }
 };
 
+class JobSlab;
+
+//! A ThreadPoolJob which, when created by a JobSlab, gives its storage back to that slab instead of being deleted.
+class SlabJob: public ThreadPoolJob
+{
+public:
+    SlabJob(): m_slab(nullptr), m_slotIndex(0xffffffff) {}
+
+    virtual void dispose();
+
+private:
+    friend class JobSlab;
+    JobSlab* m_slab;
+    uint32_t m_slotIndex; //!< JobSlab::NoSlot if it went to the heap
+};
+
+/* Up to a fixed number of fixed-size slots in which SlabJobs get constructed, so that steady-state job submission
+ * doesn't touch the heap. Slots are allocated in chunks as the load requires (and kept until the slab goes), not all
+ * at construction. Taking and returning a slot is lock-free; only adding a chunk takes a mutex.
+ * When the slab is exhausted (or the job doesn't fit in a slot) create() falls back to the heap. */
+class JobSlab
+{
+public:
+    //! Slots are indexed with 32-bit integers, that one meaning "none".
+    static const uint32_t NoSlot = 0xffffffff;
+
+    JobSlab (size_t slotSize, size_t numSlots);
+    ~JobSlab ();
+
+    JobSlab (const JobSlab& other) = delete;
+    JobSlab& operator= (const JobSlab& other) = delete;
+
+    template<typename Job, typename... Args>
+    Job* create (Args&&... args)
+    {
+        uint32_t index = (sizeof(Job) <= m_slotSize && alignof(Job) <= alignof(std::max_align_t)) ? acquireSlot() : NoSlot;
+        Job* job;
+        if (index != NoSlot)
+        {
+            try
+            {
+                job = new (slot(index)) Job (std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                releaseSlot(index);
+                throw;
+            }
+        }
+        else
+        {
+            m_numHeapFallbacks.fetch_add(1, std::memory_order_relaxed);
+            job = new Job (std::forward<Args>(args)...);
+        }
+        job->m_slab = this;
+        job->m_slotIndex = index;
+        return job;
+    }
+
+    //! Destroys a job obtained from create().
+    void destroy (SlabJob* job);
+
+    size_t slotSize () const { return m_slotSize; }
+    size_t numSlots () const { return m_numSlots; }
+    //! How many times create() had to go to the heap, a non-zero value means the slab is too small for the traffic.
+    size_t numHeapFallbacks () const { return m_numHeapFallbacks.load(std::memory_order_relaxed); }
+
+private:
+    struct Chunk
+    {
+        std::unique_ptr<char[]> storage;
+        //! The free list is a stack of slot indices; nextFree[i] is the free slot below slot i (of this chunk).
+        std::unique_ptr<std::atomic<uint32_t>[]> nextFree;
+    };
+
+    uint32_t acquireSlot ();
+    void releaseSlot (uint32_t index);
+    //! Adds a chunk of free slots unless there are free slots already; false if all chunks are there.
+    bool grow ();
+
+    char* slot (uint32_t index) const;
+    std::atomic<uint32_t>& nextFree (uint32_t index) const;
+
+    const size_t m_slotSize;
+    const size_t m_numSlots;
+
+    //! All chunks the slab may have; a chunk gets published here before any of its slots gets on the free list.
+    std::unique_ptr<std::atomic<Chunk*>[]> m_chunks;
+    std::mutex m_growthLock;
+    std::atomic<size_t> m_numChunks; //!< only grows under m_growthLock
+
+    //! Upper 32 bits: modification counter (against ABA), lower 32 bits: index of the topmost free slot.
+    std::atomic<uint64_t> m_freeListHead;
+
+    std::atomic<size_t> m_numHeapFallbacks;
+};
+
+//! Keeps any callable (and a callable producing the description) by value - no std::function, no std::string up-front.
+template<typename Functor, typename Describer>
+class FunctorJob: public SlabJob
+{
+public:
+    FunctorJob (Functor&& functor, Describer&& describer):
+        m_functor(std::forward<Functor>(functor)),
+        m_describer(std::forward<Describer>(describer))
+    {}
+    virtual void execute() { m_functor(); }
+    virtual std::string describe() const { return m_describer(); }
+private:
+    typename std::decay<Functor>::type m_functor;
+    typename std::decay<Describer>::type m_describer;
+};
+
+/* Jobs added from outside of the pool go to a lock-free injection queue, which grows with the load up to maxJobs.
+ * Jobs added from within a job (i.e. from a worker thread) go to the worker's own deque.
+ * Idle workers first look into their own deque, then into the injection queue, then steal from other workers.
+ * The mutex/condition variable pair below is only used to park idle workers, never on the job submission path
+ * (unless there is a parked worker to wake up). */
 class ThreadPool
 {
 public:
-    ThreadPool (unsigned int maxThreads, unsigned int maxJobs);
+    /* numIdleRoundsBeforeParking: how many times an idle worker looks for work (yielding in between) before it parks
+     * on the condition variable. More rounds pick up bursts of jobs without a wake-up but burn CPU while idle. */
+    ThreadPool (unsigned int maxThreads, unsigned int maxJobs, unsigned int numIdleRoundsBeforeParking = 4);
     ~ThreadPool ();
 
     UaStatus addJob (ThreadPoolJob* job);
-    UaStatus addJob (const std::function<void()>& functor, const std::string& description);
+    UaStatus addJob (std::function<void()> functor, std::string description);
+
+    /* Preferred over the std::function overload above: the job is placed in a pre-allocated slot of the pool
+     * and the description is only built (by calling describer()) if it's needed for logging. */
+    template<typename Functor, typename Describer>
+    UaStatus addFunctorJob (Functor&& functor, Describer&& describer)
+    {
+        typedef FunctorJob<Functor, Describer> Job;
+        Job* job = m_functorJobSlab.create<Job>(std::forward<Functor>(functor), std::forward<Describer>(describer));
+        UaStatus status = this->addJob(job);
+        if (!status.isGood())
+            job->dispose();
+        return status;
+    }
 
 private:
-    void work();
+    void work(unsigned int workerIndex);
+    ThreadPoolJob* findJob(unsigned int workerIndex);
+    void wakeUpParkedWorker();
 
-    std::mutex m_accessLock;
-    bool m_quit;
+    std::atomic<bool> m_quit;
     std::vector<std::thread> m_workers;
-    std::queue<ThreadPoolJob*, std::list<ThreadPoolJob*> > m_pendingJobs;
 
     const unsigned int m_maxJobs;
+    const unsigned int m_numIdleRoundsBeforeParking;
+    //! Counts jobs which were accepted but not yet taken by any worker. Used to respect maxJobs.
+    std::atomic<unsigned int> m_numPendingJobs;
+
+    GrowableMpmcJobQueue m_injectionQueue;
+    std::vector<std::unique_ptr<WorkStealingJobDeque>> m_workerDeques;
 
-    // this is the notification business for conditional variable notification
+    // this is the notification business for parking idle workers
+    std::mutex m_parkingLock;
     std::condition_variable m_conditionVariable;
+    std::atomic<unsigned int> m_numParkedWorkers;
+
+    //! Storage for jobs added by addFunctorJob()
+    JobSlab m_functorJobSlab;
 
 };
 
@@ -0,0 +1,156 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * QuasarWorkStealingQueues.h
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef COMMON_INCLUDE_QUASARWORKSTEALINGQUEUES_H_
+#define COMMON_INCLUDE_QUASARWORKSTEALINGQUEUES_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace Quasar
+{
+
+class ThreadPoolJob;
+
+/* The containers below are the building blocks of Quasar::ThreadPool.
+ * The bounded ones are fixed-capacity (capacity rounded up to a power of two) and never allocate after construction. */
+
+//! Bounded multi-producer/multi-consumer queue (D. Vyukov's algorithm). The rings of GrowableMpmcJobQueue.
+class BoundedMpmcJobQueue
+{
+public:
+    explicit BoundedMpmcJobQueue (size_t capacity);
+
+    BoundedMpmcJobQueue (const BoundedMpmcJobQueue& other) = delete;
+    BoundedMpmcJobQueue& operator= (const BoundedMpmcJobQueue& other) = delete;
+
+    //! Returns false when the queue is full or closed.
+    bool push (ThreadPoolJob* job);
+
+    //! Returns nullptr when the queue is empty.
+    ThreadPoolJob* pop ();
+
+    size_t capacity () const { return m_mask + 1; }
+
+    //! No push() succeeds from now on; those which already took a cell complete.
+    void close () { m_enqueuePosition.fetch_or(ClosedBit); }
+    bool isClosed () const { return (m_enqueuePosition.load() & ClosedBit) != 0; }
+    //! Closed and everything ever pushed was popped: empty for good.
+    bool isDrained () const;
+
+private:
+    //! Set in m_enqueuePosition by close(); positions never get that high.
+    static const size_t ClosedBit = ~(~size_t(0) >> 1);
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        ThreadPoolJob*      job;
+    };
+
+    const size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+
+    // producers and consumers touch different positions, keep them on separate cache lines
+    std::atomic<size_t> m_enqueuePosition;
+    char m_cacheLinePadding[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_dequeuePosition;
+};
+
+/* Multi-producer/multi-consumer queue for at least maxCapacity jobs which takes memory as the load requires rather
+ * than for maxCapacity up-front (the exact limit is the caller's business: ThreadPool counts pending jobs). Used to inject jobs from non-worker threads.
+ * It's a chain of BoundedMpmcJobQueue rings: producers push to the newest ring, when it's full the next one, twice
+ * as large (up to maxCapacity), gets chained and the full one closed. Consumers pop from the oldest ring which isn't
+ * drained yet, then look into the newer ones. Push and pop stay lock-free; only chaining a ring takes a mutex.
+ * Drained rings are kept until the queue goes (consumers may still be looking into them); being at most half
+ * as large as the one after, they take less than the newest ring together. */
+class GrowableMpmcJobQueue
+{
+public:
+    GrowableMpmcJobQueue (size_t initialCapacity, size_t maxCapacity);
+
+    GrowableMpmcJobQueue (const GrowableMpmcJobQueue& other) = delete;
+    GrowableMpmcJobQueue& operator= (const GrowableMpmcJobQueue& other) = delete;
+
+    //! Returns false when the newest ring is full and as large as it gets.
+    bool push (ThreadPoolJob* job);
+
+    //! Returns nullptr when the queue is empty.
+    ThreadPoolJob* pop ();
+
+    //! Of the newest ring
+    size_t capacity () const { return m_pushRing.load()->queue.capacity(); }
+
+private:
+    struct Ring
+    {
+        explicit Ring (size_t capacity): queue(capacity), next(nullptr) {}
+        BoundedMpmcJobQueue queue;
+        std::atomic<Ring*> next;
+    };
+
+    //! Chains a ring after full (unless someone did already); false if full is as large as it gets.
+    bool grow (Ring* full);
+
+    const size_t m_maxCapacity;
+
+    std::mutex m_growthLock;
+    std::vector<std::unique_ptr<Ring>> m_rings; //!< oldest first; guarded by m_growthLock
+
+    std::atomic<Ring*> m_pushRing;
+    std::atomic<Ring*> m_popRing;
+};
+
+//! Bounded Chase-Lev deque. Only the owning worker may push() and pop() (LIFO end); any thread may steal() (FIFO end).
+class WorkStealingJobDeque
+{
+public:
+    explicit WorkStealingJobDeque (size_t capacity);
+
+    WorkStealingJobDeque (const WorkStealingJobDeque& other) = delete;
+    WorkStealingJobDeque& operator= (const WorkStealingJobDeque& other) = delete;
+
+    //! Owner only. Returns false when the deque is full.
+    bool push (ThreadPoolJob* job);
+
+    //! Owner only. Returns nullptr when empty (or when the last job was just stolen).
+    ThreadPoolJob* pop ();
+
+    //! Any thread. Returns nullptr when empty or when losing a race with another thief or the owner.
+    ThreadPoolJob* steal ();
+
+private:
+    const int64_t m_mask;
+    std::unique_ptr<std::atomic<ThreadPoolJob*>[]> m_jobs;
+
+    // thieves hammer m_top while the owner works on m_bottom, keep them on separate cache lines
+    std::atomic<int64_t> m_top;
+    char m_cacheLinePadding[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> m_bottom;
+};
+
+}
+
+#endif /* COMMON_INCLUDE_QUASARWORKSTEALINGQUEUES_H_ */
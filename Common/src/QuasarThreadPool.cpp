@@ -20,6 +20,8 @@
  */
 
 #include <algorithm>
+#include <stdexcept>
+#include <string>
 
 #include <QuasarThreadPool.h>
 #include <LogIt.h>
@@ -27,44 +29,103 @@
 namespace Quasar
 {
 
-ThreadPool::ThreadPool (unsigned int maxThreads, unsigned int maxJobs):
+//! Local deques don't need to be as large as maxJobs, when a local deque is full the job goes to the injection queue.
+static const unsigned int MaxWorkerDequeCapacity = 4096;
+//! The injection queue starts that large and doubles (up to maxJobs) when the load needs it.
+static const unsigned int InitialInjectionQueueCapacity = 1024;
+//! Typical lambdas given to addFunctorJob() (e.g. asynchronous method calls capturing their arguments) fit in that.
+static const size_t FunctorJobSlotSize = 256;
+//! The job slab grows by that many slots: 64 kB of functor jobs.
+static const uint32_t SlotsPerChunk = 256;
+
+namespace
+{
+//! Lets addJob() know whether it is called from a worker of given pool (e.g. a job spawning another job).
+struct WorkerIdentity
+{
+    const ThreadPool* pool;
+    unsigned int      index;
+};
+thread_local WorkerIdentity currentWorker = {nullptr, 0};
+
+//! For addJob() with a std::string: the description gets moved into the job, not copied once more.
+struct StringDescriber
+{
+    std::string description;
+    std::string operator() () const { return description; }
+};
+}
+
+ThreadPool::ThreadPool (unsigned int maxThreads, unsigned int maxJobs, unsigned int numIdleRoundsBeforeParking):
         m_quit(false),
-        m_maxJobs(maxJobs)
+        m_maxJobs(maxJobs),
+        m_numIdleRoundsBeforeParking(numIdleRoundsBeforeParking),
+        m_numPendingJobs(0),
+        m_injectionQueue(std::min(maxJobs, InitialInjectionQueueCapacity), maxJobs),
+        m_numParkedWorkers(0),
+        m_functorJobSlab(FunctorJobSlotSize, maxJobs + maxThreads) // maxJobs waiting plus one being executed per worker
 {
+    m_workerDeques.reserve(maxThreads);
+    for (unsigned int i=0; i<maxThreads; ++i)
+        m_workerDeques.emplace_back(new WorkStealingJobDeque(std::min(maxJobs, MaxWorkerDequeCapacity)));
     m_workers.reserve(maxThreads);
     for (unsigned int i=0; i<maxThreads; ++i)
-        m_workers.emplace_back( [this](){this->work();} );
+        m_workers.emplace_back( [this, i](){this->work(i);} );
 }
 
 ThreadPool::~ThreadPool ()
 {
     LOG(Log::INF) << "Stopping threadpool - this might take some time.";
     m_quit = true;
-    m_conditionVariable.notify_all();
+    {
+        std::lock_guard<std::mutex> lock (m_parkingLock);
+        m_conditionVariable.notify_all();
+    }
     for (std::thread &t : m_workers)
         t.join();
     LOG(Log::INF) << "Stopped the threadpool";
     // all threads are stopped now, but are all jobs flushed?
-    while (!m_pendingJobs.empty())
+    auto removeUnfinishedJob = [](ThreadPoolJob* job)
     {
-        ThreadPoolJob* job = m_pendingJobs.front();
-        m_pendingJobs.pop();
         LOG(Log::WRN) << "Removing unfinished job: " << job->describe();
-        delete job;
+        job->dispose();
+    };
+    for (std::unique_ptr<WorkStealingJobDeque>& deque : m_workerDeques)
+        while (ThreadPoolJob* job = deque->pop())
+            removeUnfinishedJob(job);
+    while (ThreadPoolJob* job = m_injectionQueue.pop())
+        removeUnfinishedJob(job);
+}
+
+ThreadPoolJob* ThreadPool::findJob(unsigned int workerIndex)
+{
+    ThreadPoolJob* job = m_workerDeques[workerIndex]->pop();
+    if (job)
+        return job;
+    job = m_injectionQueue.pop();
+    if (job)
+        return job;
+    const unsigned int numWorkers = m_workerDeques.size();
+    for (unsigned int i=1; i<numWorkers; ++i)
+    {
+        job = m_workerDeques[(workerIndex + i) % numWorkers]->steal();
+        if (job)
+            return job;
     }
+    return nullptr;
 }
 
-void ThreadPool::work()
+void ThreadPool::work(unsigned int workerIndex)
 {
+    currentWorker = {this, workerIndex};
+    unsigned int numIdleRounds = 0;
     while (!m_quit)
     {
-        std::unique_lock<std::mutex>lock (m_accessLock);
-        if (! m_pendingJobs.empty())
+        ThreadPoolJob *job = findJob(workerIndex);
+        if (job)
         {
-            ThreadPoolJob *job = m_pendingJobs.front();
-            m_pendingJobs.pop();
-            unsigned int size = m_pendingJobs.size();
-            lock.unlock();
+            numIdleRounds = 0;
+            unsigned int size = m_numPendingJobs.fetch_sub(1) - 1;
             LOG(Log::TRC) << "Removed job from the threadpool, current number of jobs is:" << size;
             try
             {
@@ -75,52 +136,182 @@ void ThreadPool::work()
                 LOG(Log::ERR) << "Job '" << job->describe() << "' has thrown an unhandled exception. The job description was '" + job->describe() + "'";
             }
 
-            delete job;
+            job->dispose();
+        }
+        else if (++numIdleRounds < m_numIdleRoundsBeforeParking)
+        {
+            std::this_thread::yield();
         }
         else
         {
-            m_conditionVariable.wait(lock);
+            numIdleRounds = 0;
+            std::unique_lock<std::mutex> lock (m_parkingLock);
+            // note: both the increment below and the re-check of pending jobs are seq_cst; that pairs with addJob()
+            // incrementing m_numPendingJobs before looking at m_numParkedWorkers, so a wake-up can't be lost.
+            m_numParkedWorkers.fetch_add(1);
+            if (m_numPendingJobs.load() == 0 && !m_quit)
+                m_conditionVariable.wait(lock);
+            m_numParkedWorkers.fetch_sub(1);
         }
     }
 }
 
+void ThreadPool::wakeUpParkedWorker()
+{
+    if (m_numParkedWorkers.load() > 0)
+    {
+        std::lock_guard<std::mutex> lock (m_parkingLock);
+        m_conditionVariable.notify_one();
+    }
+}
+
 UaStatus ThreadPool::addJob (ThreadPoolJob* job)
 {
+    unsigned int numPendingJobs = m_numPendingJobs.fetch_add(1);
+    if (numPendingJobs >= m_maxJobs)
     {
-        std::lock_guard<std::mutex>lock (m_accessLock);
-        if (m_pendingJobs.size() >= m_maxJobs)
-        {
-            LOG(Log::ERR) << "The threadpool is already full (it has limit of " << m_maxJobs << " jobs. Cant add new jobs. Enlarge the threadpool";
-            return OpcUa_BadResourceUnavailable;
-        }
-        m_pendingJobs.push(job);
+        m_numPendingJobs.fetch_sub(1);
+        LOG(Log::ERR) << "The threadpool is already full (it has limit of " << m_maxJobs << " jobs. Cant add new jobs. Enlarge the threadpool";
+        return OpcUa_BadResourceUnavailable;
     }
-    m_conditionVariable.notify_one();
-    LOG(Log::TRC) << "Added new job to threadpool, current number of jobs is:" << m_pendingJobs.size();
+    bool queued = false;
+    if (currentWorker.pool == this)
+        queued = m_workerDeques[currentWorker.index]->push(job);
+    if (!queued)
+        queued = m_injectionQueue.push(job);
+    if (!queued)
+    {
+        // shouldn't happen as the injection queue grows to at least maxJobs, but let's be defensive
+        m_numPendingJobs.fetch_sub(1);
+        LOG(Log::ERR) << "Couldn't enqueue the job in the threadpool (queue full)";
+        return OpcUa_BadResourceUnavailable;
+    }
+    wakeUpParkedWorker();
+    LOG(Log::TRC) << "Added new job to threadpool, current number of jobs is:" << numPendingJobs + 1;
     return OpcUa_Good;
 }
 
-UaStatus ThreadPool::addJob (const std::function<void()>& functor, const std::string& description)
+UaStatus ThreadPool::addJob (std::function<void()> functor, std::string description)
+{
+    return addFunctorJob(std::move(functor), StringDescriber{std::move(description)});
+}
+
+void SlabJob::dispose()
+{
+    if (m_slab)
+        m_slab->destroy(this);
+    else
+        delete this;
+}
+
+static size_t roundUpToMaxAlignment (size_t x)
 {
-    class StdFunctionJob: public ThreadPoolJob
+    const size_t alignment = alignof(std::max_align_t);
+    return std::max<size_t>(alignment, (x + alignment - 1) / alignment * alignment);
+}
+
+JobSlab::JobSlab (size_t slotSize, size_t numSlots):
+        m_slotSize(roundUpToMaxAlignment(slotSize)),
+        m_numSlots(numSlots),
+        m_chunks(new std::atomic<Chunk*>[(numSlots + SlotsPerChunk - 1) / SlotsPerChunk]),
+        m_numChunks(0),
+        m_freeListHead(NoSlot),
+        m_numHeapFallbacks(0)
+{
+    if (numSlots >= NoSlot)
+        throw std::logic_error("JobSlab: too many slots requested: " + std::to_string(numSlots));
+    for (size_t i=0; i<(numSlots + SlotsPerChunk - 1) / SlotsPerChunk; ++i)
+        m_chunks[i].store(nullptr, std::memory_order_relaxed);
+}
+
+JobSlab::~JobSlab ()
+{
+    for (size_t i=0; i<m_numChunks.load(); ++i)
+        delete m_chunks[i].load();
+}
+
+char* JobSlab::slot (uint32_t index) const
+{
+    return m_chunks[index / SlotsPerChunk].load(std::memory_order_acquire)->storage.get() + (index % SlotsPerChunk) * m_slotSize;
+}
+
+std::atomic<uint32_t>& JobSlab::nextFree (uint32_t index) const
+{
+    return m_chunks[index / SlotsPerChunk].load(std::memory_order_acquire)->nextFree[index % SlotsPerChunk];
+}
+
+bool JobSlab::grow ()
+{
+    if (m_numChunks.load() * SlotsPerChunk >= m_numSlots)
+        return false; // an exhausted slab falls back to the heap without contending for the lock
+    std::lock_guard<std::mutex> lock (m_growthLock);
+    if (static_cast<uint32_t>(m_freeListHead.load(std::memory_order_acquire)) != NoSlot)
+        return true; // someone else did, or slots came back meanwhile
+    const size_t first = m_numChunks.load() * SlotsPerChunk;
+    if (first >= m_numSlots)
+        return false;
+    const size_t numChunkSlots = std::min<size_t>(SlotsPerChunk, m_numSlots - first);
+    Chunk* chunk = new Chunk;
+    chunk->storage.reset(new char[m_slotSize * numChunkSlots]);
+    chunk->nextFree.reset(new std::atomic<uint32_t>[numChunkSlots]);
+    for (size_t i=0; i+1<numChunkSlots; ++i)
+        chunk->nextFree[i].store(first + i + 1, std::memory_order_relaxed);
+    m_chunks[m_numChunks.load()].store(chunk, std::memory_order_release);
+    m_numChunks.fetch_add(1);
+    // the whole chunk goes on top of the free list at once
+    uint64_t head = m_freeListHead.load(std::memory_order_relaxed);
+    while (true)
     {
-    public:
-        StdFunctionJob (
-                const std::function<void()>& functor,
-                const std::string& description) :
-                    m_functor(functor),
-                    m_description(description) {}
-        virtual void execute() { m_functor(); }
-        virtual std::string describe() const { return m_description; }
-    private:
-        const std::function<void()> m_functor;
-        const std::string m_description;
+        chunk->nextFree[numChunkSlots - 1].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        uint64_t newHead = (((head >> 32) + 1) << 32) | first;
+        if (m_freeListHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed))
+            break;
+    }
+    return true;
+}
 
-    };
-    StdFunctionJob *job = new StdFunctionJob (functor, description);
-    return this->addJob (job);
+uint32_t JobSlab::acquireSlot ()
+{
+    uint64_t head = m_freeListHead.load(std::memory_order_acquire);
+    while (true)
+    {
+        uint32_t index = static_cast<uint32_t>(head);
+        if (index == NoSlot)
+        {
+            if (!grow())
+                return NoSlot;
+            head = m_freeListHead.load(std::memory_order_acquire);
+            continue;
+        }
+        // note: nextFree(index) might be stale if someone else took the slot meanwhile, but then the CAS fails thanks to the counter
+        uint64_t newHead = (((head >> 32) + 1) << 32) | nextFree(index).load(std::memory_order_relaxed);
+        if (m_freeListHead.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire))
+            return index;
+    }
 }
 
+void JobSlab::releaseSlot (uint32_t index)
+{
+    uint64_t head = m_freeListHead.load(std::memory_order_relaxed);
+    while (true)
+    {
+        nextFree(index).store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        uint64_t newHead = (((head >> 32) + 1) << 32) | index;
+        if (m_freeListHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed))
+            return;
+    }
 }
 
+void JobSlab::destroy (SlabJob* job)
+{
+    const uint32_t index = job->m_slotIndex;
+    if (index != NoSlot)
+    {
+        job->~SlabJob();
+        releaseSlot(index);
+    }
+    else
+        delete job;
+}
 
+}
@@ -0,0 +1,224 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * QuasarWorkStealingQueues.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include <QuasarWorkStealingQueues.h>
+
+namespace Quasar
+{
+
+static size_t roundUpToPowerOfTwo (size_t x)
+{
+    size_t result = 2; // Vyukov's queue needs at least two cells
+    while (result < x)
+        result <<= 1;
+    return result;
+}
+
+BoundedMpmcJobQueue::BoundedMpmcJobQueue (size_t capacity):
+        m_mask(roundUpToPowerOfTwo(capacity) - 1),
+        m_cells(new Cell[m_mask + 1]),
+        m_enqueuePosition(0),
+        m_dequeuePosition(0)
+{
+    for (size_t i=0; i<=m_mask; ++i)
+    {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        m_cells[i].job = nullptr;
+    }
+}
+
+bool BoundedMpmcJobQueue::push (ThreadPoolJob* job)
+{
+    Cell* cell;
+    size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+    while (true)
+    {
+        if (position & ClosedBit)
+            return false;
+        cell = &m_cells[position & m_mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0)
+        {
+            if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+            return false; // full
+        else
+            position = m_enqueuePosition.load(std::memory_order_relaxed);
+    }
+    cell->job = job;
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+ThreadPoolJob* BoundedMpmcJobQueue::pop ()
+{
+    Cell* cell;
+    size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+    while (true)
+    {
+        cell = &m_cells[position & m_mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+        if (difference == 0)
+        {
+            if (m_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (difference < 0)
+            return nullptr; // empty
+        else
+            position = m_dequeuePosition.load(std::memory_order_relaxed);
+    }
+    ThreadPoolJob* job = cell->job;
+    cell->sequence.store(position + m_mask + 1, std::memory_order_release);
+    return job;
+}
+
+bool BoundedMpmcJobQueue::isDrained () const
+{
+    size_t enqueuePosition = m_enqueuePosition.load(std::memory_order_acquire);
+    // the dequeue position only passes a cell once its job got published, so reaching the end means all were popped
+    return (enqueuePosition & ClosedBit) && m_dequeuePosition.load(std::memory_order_acquire) == (enqueuePosition & ~ClosedBit);
+}
+
+GrowableMpmcJobQueue::GrowableMpmcJobQueue (size_t initialCapacity, size_t maxCapacity):
+        m_maxCapacity(roundUpToPowerOfTwo(maxCapacity))
+{
+    m_rings.emplace_back(new Ring(std::min(roundUpToPowerOfTwo(initialCapacity), m_maxCapacity)));
+    m_pushRing.store(m_rings.back().get());
+    m_popRing.store(m_rings.back().get());
+}
+
+bool GrowableMpmcJobQueue::push (ThreadPoolJob* job)
+{
+    while (true)
+    {
+        Ring* ring = m_pushRing.load(std::memory_order_acquire);
+        if (ring->queue.push(job))
+            return true;
+        // closed: a newer ring is already there; full: chain one
+        if (!ring->queue.isClosed() && !grow(ring))
+            return false;
+    }
+}
+
+bool GrowableMpmcJobQueue::grow (Ring* full)
+{
+    std::lock_guard<std::mutex> lock (m_growthLock);
+    if (m_pushRing.load() != full)
+        return true; // someone else did
+    if (full->queue.capacity() >= m_maxCapacity)
+        return false;
+    m_rings.emplace_back(new Ring(std::min(2 * full->queue.capacity(), m_maxCapacity)));
+    Ring* ring = m_rings.back().get();
+    full->next.store(ring, std::memory_order_release);
+    m_pushRing.store(ring, std::memory_order_release);
+    // only now: producers failing on the closed ring find the new one in m_pushRing
+    full->queue.close();
+    return true;
+}
+
+ThreadPoolJob* GrowableMpmcJobQueue::pop ()
+{
+    Ring* ring = m_popRing.load(std::memory_order_acquire);
+    while (true)
+    {
+        ThreadPoolJob* job = ring->queue.pop();
+        if (job)
+            return job;
+        Ring* next = ring->next.load(std::memory_order_acquire);
+        if (!next)
+            return nullptr;
+        if (ring->queue.isDrained())
+        {
+            Ring* expected = ring;
+            m_popRing.compare_exchange_strong(expected, next, std::memory_order_release, std::memory_order_relaxed);
+        }
+        // not drained: a producer is just finishing a push into it, meanwhile take what's in the newer rings
+        ring = next;
+    }
+}
+
+/* The memory orderings below follow N.M. Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models" (PPoPP'13). */
+
+WorkStealingJobDeque::WorkStealingJobDeque (size_t capacity):
+        m_mask(static_cast<int64_t>(roundUpToPowerOfTwo(capacity)) - 1),
+        m_jobs(new std::atomic<ThreadPoolJob*>[m_mask + 1]),
+        m_top(0),
+        m_bottom(0)
+{
+    for (int64_t i=0; i<=m_mask; ++i)
+        m_jobs[i].store(nullptr, std::memory_order_relaxed);
+}
+
+bool WorkStealingJobDeque::push (ThreadPoolJob* job)
+{
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+    int64_t top = m_top.load(std::memory_order_acquire);
+    if (bottom - top > m_mask)
+        return false; // full
+    m_jobs[bottom & m_mask].store(job, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    return true;
+}
+
+ThreadPoolJob* WorkStealingJobDeque::pop ()
+{
+    int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = m_top.load(std::memory_order_relaxed);
+    if (top > bottom)
+    {
+        m_bottom.store(bottom + 1, std::memory_order_relaxed); // was empty
+        return nullptr;
+    }
+    ThreadPoolJob* job = m_jobs[bottom & m_mask].load(std::memory_order_relaxed);
+    if (top == bottom)
+    {
+        // the last element - compete with thieves
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+ThreadPoolJob* WorkStealingJobDeque::steal ()
+{
+    int64_t top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = m_bottom.load(std::memory_order_acquire);
+    if (top >= bottom)
+        return nullptr;
+    ThreadPoolJob* job = m_jobs[top & m_mask].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+    return job;
+}
+
+}
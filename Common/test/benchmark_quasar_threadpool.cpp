@@ -0,0 +1,166 @@
+/*
+ * benchmark_quasar_threadpool.cpp
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  Compares Quasar::ThreadPool against the former implementation (single mutex + std::list based queue,
+ *  reproduced below as MutexThreadPool) in terms of throughput (jobs/s) and enqueue-to-start latency.
+ *  The jobs are very short, so what's measured is mostly the overhead of the pool itself.
+ *
+ *  Usage: benchmark_quasar_threadpool [numWorkers] [numProducers] [numJobsPerProducer]
+ */
+
+#include <QuasarThreadPool.h>
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <queue>
+#include <list>
+#include <cstdlib>
+
+#include <LogIt.h>
+
+typedef std::chrono::steady_clock Clock;
+
+//! The reference: this is how Quasar::ThreadPool was implemented before the work-stealing rewrite.
+class MutexThreadPool
+{
+public:
+    MutexThreadPool (unsigned int maxThreads, unsigned int maxJobs):
+        m_quit(false),
+        m_maxJobs(maxJobs)
+    {
+        for (unsigned int i=0; i<maxThreads; ++i)
+            m_workers.emplace_back( [this](){this->work();} );
+    }
+    ~MutexThreadPool ()
+    {
+        {
+            std::lock_guard<std::mutex> lock (m_accessLock);
+            m_quit = true;
+        }
+        m_conditionVariable.notify_all();
+        for (std::thread &t : m_workers)
+            t.join();
+        while (!m_pendingJobs.empty())
+        {
+            delete m_pendingJobs.front();
+            m_pendingJobs.pop();
+        }
+    }
+    UaStatus addJob (Quasar::ThreadPoolJob* job)
+    {
+        {
+            std::lock_guard<std::mutex> lock (m_accessLock);
+            if (m_pendingJobs.size() >= m_maxJobs)
+                return OpcUa_BadResourceUnavailable;
+            m_pendingJobs.push(job);
+        }
+        m_conditionVariable.notify_one();
+        return OpcUa_Good;
+    }
+private:
+    void work()
+    {
+        std::unique_lock<std::mutex> lock (m_accessLock);
+        while (!m_quit)
+        {
+            if (!m_pendingJobs.empty())
+            {
+                Quasar::ThreadPoolJob *job = m_pendingJobs.front();
+                m_pendingJobs.pop();
+                lock.unlock();
+                job->execute();
+                delete job;
+                lock.lock();
+            }
+            else
+                m_conditionVariable.wait(lock);
+        }
+    }
+    std::mutex m_accessLock;
+    bool m_quit;
+    std::vector<std::thread> m_workers;
+    std::queue<Quasar::ThreadPoolJob*, std::list<Quasar::ThreadPoolJob*> > m_pendingJobs;
+    const unsigned int m_maxJobs;
+    std::condition_variable m_conditionVariable;
+};
+
+//! A tiny job that only records when it was started relative to when it was enqueued.
+class LatencyProbeJob: public Quasar::ThreadPoolJob
+{
+public:
+    LatencyProbeJob (double* latencySlot, std::atomic<unsigned int>* numFinished):
+        m_enqueuedAt(Clock::now()),
+        m_latencySlot(latencySlot),
+        m_numFinished(numFinished)
+    {}
+    virtual void execute()
+    {
+        *m_latencySlot = std::chrono::duration<double, std::micro>(Clock::now() - m_enqueuedAt).count();
+        m_numFinished->fetch_add(1, std::memory_order_release);
+    }
+    virtual std::string describe() const { return "latency probe"; }
+private:
+    const Clock::time_point m_enqueuedAt;
+    double* m_latencySlot;
+    std::atomic<unsigned int>* m_numFinished;
+};
+
+template<typename Pool>
+void runBenchmark (const std::string& title, unsigned int numWorkers, unsigned int numProducers, unsigned int numJobsPerProducer)
+{
+    const unsigned int numJobs = numProducers * numJobsPerProducer;
+    std::vector<double> latencies (numJobs, 0);
+    std::atomic<unsigned int> numFinished (0);
+    std::atomic<unsigned int> numRejected (0);
+    Clock::time_point start, finish;
+    {
+        Pool pool (numWorkers, numJobs);
+        start = Clock::now();
+        std::vector<std::thread> producers;
+        for (unsigned int p=0; p<numProducers; ++p)
+            producers.emplace_back([&, p]()
+            {
+                for (unsigned int i=0; i<numJobsPerProducer; ++i)
+                {
+                    Quasar::ThreadPoolJob* job = new LatencyProbeJob(&latencies[p*numJobsPerProducer + i], &numFinished);
+                    if (!pool.addJob(job).isGood())
+                    {
+                        delete job;
+                        numRejected++;
+                    }
+                }
+            });
+        for (std::thread& t : producers)
+            t.join();
+        while (numFinished.load(std::memory_order_acquire) + numRejected.load() < numJobs)
+            std::this_thread::yield();
+        finish = Clock::now();
+    }
+    double seconds = std::chrono::duration<double>(finish - start).count();
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << std::left << std::setw(28) << title <<
+        " jobs/s=" << std::setw(12) << static_cast<unsigned long>(numFinished / seconds) <<
+        " p50[us]=" << std::setw(10) << latencies[numJobs / 2] <<
+        " p99[us]=" << std::setw(10) << latencies[numJobs * 99 / 100] <<
+        " rejected=" << numRejected << std::endl;
+}
+
+int main (int argc, char* argv[])
+{
+    Log::initializeLogging(Log::WRN);
+    const unsigned int numWorkers = argc > 1 ? std::atoi(argv[1]) : 4;
+    const unsigned int numProducers = argc > 2 ? std::atoi(argv[2]) : 4;
+    const unsigned int numJobsPerProducer = argc > 3 ? std::atoi(argv[3]) : 250000;
+    std::cout << "workers=" << numWorkers << " producers=" << numProducers << " jobs/producer=" << numJobsPerProducer << std::endl;
+    for (int repetition=0; repetition<3; ++repetition)
+    {
+        runBenchmark<MutexThreadPool>("mutex+list (former)", numWorkers, numProducers, numJobsPerProducer);
+        runBenchmark<Quasar::ThreadPool>("work-stealing (current)", numWorkers, numProducers, numJobsPerProducer);
+    }
+}
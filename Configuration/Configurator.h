@@ -68,6 +68,16 @@ void validateContentOrder(const TParent& parent, const TChildren& children, cons
   }
 }
 
+/* With numThreads > 1, configure() builds the subtrees of the children of Root concurrently and inserts their
+ * nodes into the address space afterwards, in the order of the configuration file. Constructors of the device
+ * logic of different subtrees then run concurrently. */
+void setConfigurationThreads (unsigned int numThreads);
+
+/* With a cache file set, configure() keeps the configuration it loaded, parsed and validated, in a binary form
+ * in that file, and the next configure() of the same configuration file (same contents, same design and build)
+ * maps the file and takes the configuration from there instead. */
+void setConfigurationCache (const std::string& cacheFileName);
+
 void unlinkAllDevices (AddressSpace::ASNodeManager *nm);
 
 /* The body for that one is generated in ConfigValidator.cpp */
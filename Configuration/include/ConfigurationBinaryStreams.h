@@ -0,0 +1,380 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * ConfigurationBinaryStreams.h
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONFIGURATION_BINARY_STREAMS_H_
+#define CONFIGURATION_BINARY_STREAMS_H_
+
+/* The binary representation of the configuration object tree, used by the configuration cache (see
+ * setConfigurationCache() in Configurator.h). xsdcxx generates the insertion into BinaryOutputStream and the
+ * extraction from BinaryInputStream of every configuration type (--generate-insertion/--generate-extraction),
+ * this file is included at the top of Configuration.hxx and provides the fundamental types and strings.
+ *
+ * The representation is native (byte order, sizes): a cache is only valid on the machine which wrote it. */
+
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#include <fstream>
+#include <iterator>
+#include <vector>
+#endif
+
+#include <xsd/cxx/tree/ostream.hxx>
+#include <xsd/cxx/tree/istream.hxx>
+
+namespace Configuration
+{
+
+class BinaryOutputStream
+{
+public:
+    void write (const void* from, std::size_t size) { m_data.append(static_cast<const char*>(from), size); }
+
+    template<typename T>
+    void writeValue (T value) { write(&value, sizeof value); }
+
+    const std::string& data () const { return m_data; }
+
+private:
+    std::string m_data;
+};
+
+//! Reads from memory it doesn't own, e.g. a MappedFile. Reading past the end throws std::runtime_error.
+class BinaryInputStream
+{
+public:
+    BinaryInputStream (const char* begin, const char* end): m_position(begin), m_end(end) {}
+
+    void read (void* to, std::size_t size)
+    {
+        if (size > static_cast<std::size_t>(m_end - m_position))
+            throw std::runtime_error("binary configuration is truncated");
+        std::memcpy(to, m_position, size);
+        m_position += size;
+    }
+
+    template<typename T>
+    T readValue () { T value; read(&value, sizeof value); return value; }
+
+    std::size_t remaining () const { return m_end - m_position; }
+
+private:
+    const char* m_position;
+    const char* m_end;
+};
+
+//! A whole file, read-only, mapped into memory (read into memory where there's no mmap)
+class MappedFile
+{
+public:
+    //! Throws std::runtime_error if the file can't be opened
+    explicit MappedFile (const std::string& fileName):
+#ifndef _WIN32
+        m_data(nullptr),
+#endif
+        m_size(0)
+    {
+#ifndef _WIN32
+        const int fd = ::open(fileName.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("can't open [" + fileName + "]: " + std::strerror(errno));
+        struct stat status;
+        if (::fstat(fd, &status) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("can't stat [" + fileName + "]: " + std::strerror(errno));
+        }
+        m_size = status.st_size;
+        if (m_size > 0)
+        {
+            void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error("can't map [" + fileName + "]: " + std::strerror(errno));
+            }
+            m_data = static_cast<const char*>(data);
+        }
+        ::close(fd); // the mapping stays
+#else
+        std::ifstream file (fileName, std::ios::binary);
+        if (!file)
+            throw std::runtime_error("can't open [" + fileName + "]");
+        m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        m_size = m_buffer.size();
+#endif
+    }
+
+    ~MappedFile ()
+    {
+#ifndef _WIN32
+        if (m_data)
+            ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+    }
+
+    MappedFile (const MappedFile&) = delete;
+    MappedFile& operator= (const MappedFile&) = delete;
+
+#ifndef _WIN32
+    const char* begin () const { return m_data; }
+#else
+    const char* begin () const { return m_buffer.data(); }
+#endif
+    const char* end () const { return begin() + m_size; }
+    std::size_t size () const { return m_size; }
+
+private:
+#ifndef _WIN32
+    const char* m_data;
+#else
+    std::vector<char> m_buffer;
+#endif
+    std::size_t m_size;
+};
+
+//! 64-bit FNV-1a; identifies contents, it's not meant to resist anyone forging them
+inline std::uint64_t contentsHash (const char* begin, const char* end)
+{
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (const char* p = begin; p != end; ++p)
+    {
+        hash ^= static_cast<unsigned char>(*p);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+}
+
+namespace xsd
+{
+namespace cxx
+{
+namespace tree
+{
+
+typedef ostream<Configuration::BinaryOutputStream> ConfigurationOstream;
+typedef istream<Configuration::BinaryInputStream> ConfigurationIstream;
+
+template<typename T>
+inline ConfigurationOstream& operator<< (ConfigurationOstream& s, ostream_common::as_size<T> x)
+{
+    s.impl().writeValue(static_cast<std::uint64_t>(x.x_));
+    return s;
+}
+
+template<typename T>
+inline ConfigurationOstream& operator<< (ConfigurationOstream& s, ostream_common::as_int8<T> x)
+{
+    s.impl().writeValue(static_cast<std::int8_t>(x.x_));
+    return s;
+}
+
+template<typename T>
+inline ConfigurationOstream& operator<< (ConfigurationOstream& s, ostream_common::as_uint8<T> x)
+{
+    s.impl().writeValue(static_cast<std::uint8_t>(x.x_));
+    return s;
+}
+
+template<typename T>
+inline ConfigurationOstream& operator<< (ConfigurationOstream& s, ostream_common::as_int16<T> x)
+{
+    s.impl().writeValue(static_cast<std::int16_t>(x.x_));
+    return s;
+}
+
+template<typename T>
+inline ConfigurationOstream& operator<< (ConfigurationOstream& s, ostream_common::as_uint16<T> x)
+{
+    s.impl().writeValue(static_cast<std::uint16_t>(x.x_));
+    return s;
+}
+
+template<typename T>
+inline ConfigurationOstream& operator<< (ConfigurationOstream& s, ostream_common::as_int32<T> x)
+{
+    s.impl().writeValue(static_cast<std::int32_t>(x.x_));
+    return s;
+}
+
+template<typename T>
+inline ConfigurationOstream& operator<< (ConfigurationOstream& s, ostream_common::as_uint32<T> x)
+{
+    s.impl().writeValue(static_cast<std::uint32_t>(x.x_));
+    return s;
+}
+
+template<typename T>
+inline ConfigurationOstream& operator<< (ConfigurationOstream& s, ostream_common::as_int64<T> x)
+{
+    s.impl().writeValue(static_cast<std::int64_t>(x.x_));
+    return s;
+}
+
+template<typename T>
+inline ConfigurationOstream& operator<< (ConfigurationOstream& s, ostream_common::as_uint64<T> x)
+{
+    s.impl().writeValue(static_cast<std::uint64_t>(x.x_));
+    return s;
+}
+
+template<typename T>
+inline ConfigurationOstream& operator<< (ConfigurationOstream& s, ostream_common::as_bool<T> x)
+{
+    s.impl().writeValue(static_cast<std::uint8_t>(x.x_ ? 1 : 0));
+    return s;
+}
+
+template<typename T>
+inline ConfigurationOstream& operator<< (ConfigurationOstream& s, ostream_common::as_float32<T> x)
+{
+    s.impl().writeValue(static_cast<float>(x.x_));
+    return s;
+}
+
+template<typename T>
+inline ConfigurationOstream& operator<< (ConfigurationOstream& s, ostream_common::as_float64<T> x)
+{
+    s.impl().writeValue(static_cast<double>(x.x_));
+    return s;
+}
+
+template<typename C>
+inline ConfigurationOstream& operator<< (ConfigurationOstream& s, const std::basic_string<C>& x)
+{
+    s.impl().writeValue(static_cast<std::uint64_t>(x.size()));
+    s.impl().write(x.data(), x.size() * sizeof(C));
+    return s;
+}
+
+template<typename T>
+inline ConfigurationIstream& operator>> (ConfigurationIstream& s, istream_common::as_size<T>& x)
+{
+    x.x_ = static_cast<T>(s.impl().readValue<std::uint64_t>());
+    return s;
+}
+
+template<typename T>
+inline ConfigurationIstream& operator>> (ConfigurationIstream& s, istream_common::as_int8<T>& x)
+{
+    x.x_ = static_cast<T>(s.impl().readValue<std::int8_t>());
+    return s;
+}
+
+template<typename T>
+inline ConfigurationIstream& operator>> (ConfigurationIstream& s, istream_common::as_uint8<T>& x)
+{
+    x.x_ = static_cast<T>(s.impl().readValue<std::uint8_t>());
+    return s;
+}
+
+template<typename T>
+inline ConfigurationIstream& operator>> (ConfigurationIstream& s, istream_common::as_int16<T>& x)
+{
+    x.x_ = static_cast<T>(s.impl().readValue<std::int16_t>());
+    return s;
+}
+
+template<typename T>
+inline ConfigurationIstream& operator>> (ConfigurationIstream& s, istream_common::as_uint16<T>& x)
+{
+    x.x_ = static_cast<T>(s.impl().readValue<std::uint16_t>());
+    return s;
+}
+
+template<typename T>
+inline ConfigurationIstream& operator>> (ConfigurationIstream& s, istream_common::as_int32<T>& x)
+{
+    x.x_ = static_cast<T>(s.impl().readValue<std::int32_t>());
+    return s;
+}
+
+template<typename T>
+inline ConfigurationIstream& operator>> (ConfigurationIstream& s, istream_common::as_uint32<T>& x)
+{
+    x.x_ = static_cast<T>(s.impl().readValue<std::uint32_t>());
+    return s;
+}
+
+template<typename T>
+inline ConfigurationIstream& operator>> (ConfigurationIstream& s, istream_common::as_int64<T>& x)
+{
+    x.x_ = static_cast<T>(s.impl().readValue<std::int64_t>());
+    return s;
+}
+
+template<typename T>
+inline ConfigurationIstream& operator>> (ConfigurationIstream& s, istream_common::as_uint64<T>& x)
+{
+    x.x_ = static_cast<T>(s.impl().readValue<std::uint64_t>());
+    return s;
+}
+
+template<typename T>
+inline ConfigurationIstream& operator>> (ConfigurationIstream& s, istream_common::as_bool<T>& x)
+{
+    x.x_ = s.impl().readValue<std::uint8_t>() != 0;
+    return s;
+}
+
+template<typename T>
+inline ConfigurationIstream& operator>> (ConfigurationIstream& s, istream_common::as_float32<T>& x)
+{
+    x.x_ = static_cast<T>(s.impl().readValue<float>());
+    return s;
+}
+
+template<typename T>
+inline ConfigurationIstream& operator>> (ConfigurationIstream& s, istream_common::as_float64<T>& x)
+{
+    x.x_ = static_cast<T>(s.impl().readValue<double>());
+    return s;
+}
+
+template<typename C>
+inline ConfigurationIstream& operator>> (ConfigurationIstream& s, std::basic_string<C>& x)
+{
+    const std::uint64_t size = s.impl().readValue<std::uint64_t>();
+    if (size > s.impl().remaining() / sizeof(C))
+        throw std::runtime_error("binary configuration is truncated");
+    std::basic_string<C> value (static_cast<std::size_t>(size), C());
+    s.impl().read(&value[0], value.size() * sizeof(C));
+    x.swap(value);
+    return s;
+}
+
+}
+}
+}
+
+#endif /* CONFIGURATION_BINARY_STREAMS_H_ */
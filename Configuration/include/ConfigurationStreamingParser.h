@@ -0,0 +1,219 @@
+/* © Copyright CERN, 2026.  All rights not expressly granted are reserved.
+ * ConfigurationStreamingParser.h
+ *
+ *  Created on: 16 Oct 2026
+ *      Author: agent <agent@local>
+ *
+ *  This file is part of Quasar.
+ *
+ *  Quasar is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public Licence as published by
+ *  the Free Software Foundation, either version 3 of the Licence.
+ *
+ *  Quasar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Quasar.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CONFIGURATION_STREAMING_PARSER_H_
+#define CONFIGURATION_STREAMING_PARSER_H_
+
+/* Parses a configuration file one child of the document element at a time, so that the configuration can be
+ * loaded without the whole DOM: every child (e.g. a top-level object with all its subtree) becomes a DOM
+ * document of its own, is handed to the callback - which builds its part of the object tree - and is released
+ * before the next child is read. The DOM therefore never holds more than the biggest child of the document element.
+ *
+ * The file is validated by Xerces against the schema, with the same settings xsdcxx uses for the DOM parsing.
+ * Problems are thrown as xsd::cxx::tree::parsing<char>, like from the xsdcxx parsing functions, at the latest
+ * before the child they were found in gets handed over. XInclude isn't supported: Xerces only does it for DOM. */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <functional>
+
+#include <xercesc/dom/DOM.hpp>
+#include <xercesc/sax2/Attributes.hpp>
+#include <xercesc/sax2/DefaultHandler.hpp>
+#include <xercesc/sax2/SAX2XMLReader.hpp>
+#include <xercesc/sax2/XMLReaderFactory.hpp>
+#include <xercesc/framework/XMLPScanToken.hpp>
+#include <xercesc/util/XMLString.hpp>
+#include <xercesc/util/XMLUni.hpp>
+#include <xercesc/util/XMLUniDefs.hpp>
+
+#include <xsd/cxx/xml/string.hxx>
+#include <xsd/cxx/xml/elements.hxx>
+#include <xsd/cxx/xml/sax/bits/error-handler-proxy.hxx>
+#include <xsd/cxx/tree/exceptions.hxx>
+#include <xsd/cxx/tree/error-handler.hxx>
+
+namespace Configuration
+{
+
+class StreamingParser: private xercesc::DefaultHandler
+{
+public:
+    typedef std::function<void (const xercesc::DOMElement& element)> OnElement;
+
+    StreamingParser (): m_implementation(nullptr), m_depth(0), m_current(nullptr), m_fragmentComplete(false) {}
+
+    //! Calls onElement for every child of the document element, in the order of the file
+    void parse (const std::string& fileName, const OnElement& onElement)
+    {
+        xsd::cxx::xml::auto_initializer xercesInitializer;
+        m_implementation = xercesc::DOMImplementationRegistry::getDOMImplementation(xsd::cxx::xml::string("LS").c_str());
+        m_depth = 0;
+        m_current = nullptr;
+        m_fragmentComplete = false;
+        m_namespaceDeclarations.clear();
+
+        xsd::cxx::tree::error_handler<char> errorHandler;
+        xsd::cxx::xml::sax::bits::error_handler_proxy<char> errorHandlerProxy (errorHandler);
+        {
+            std::unique_ptr<xercesc::SAX2XMLReader> reader (xercesc::XMLReaderFactory::createXMLReader());
+            reader->setFeature(xercesc::XMLUni::fgSAX2CoreNameSpaces, true);
+            reader->setFeature(xercesc::XMLUni::fgSAX2CoreNameSpacePrefixes, true); // the xmlns attributes are needed for the fragments
+            reader->setFeature(xercesc::XMLUni::fgSAX2CoreValidation, true);
+            reader->setFeature(xercesc::XMLUni::fgXercesDynamic, false);
+            reader->setFeature(xercesc::XMLUni::fgXercesSchema, true);
+            reader->setFeature(xercesc::XMLUni::fgXercesSchemaFullChecking, false);
+#if _XERCES_VERSION >= 30100
+            reader->setFeature(xercesc::XMLUni::fgXercesHandleMultipleImports, true);
+#endif
+            reader->setContentHandler(this);
+            reader->setErrorHandler(&errorHandlerProxy);
+
+            try
+            {
+                // progressive parsing, so that onElement runs outside of Xerces
+                xercesc::XMLPScanToken token;
+                bool more = reader->parseFirst(fileName.c_str(), token);
+                while (more)
+                {
+                    more = reader->parseNext(token);
+                    errorHandler.throw_if_failed<xsd::cxx::tree::parsing<char> >();
+                    if (m_fragmentComplete)
+                    {
+                        m_fragmentComplete = false;
+                        const Document fragment (std::move(m_fragment));
+                        onElement(*fragment->getDocumentElement());
+                    }
+                }
+            }
+            catch (...)
+            {
+                m_fragment.reset(); // while Xerces is still initialized
+                throw;
+            }
+        }
+        errorHandler.throw_if_failed<xsd::cxx::tree::parsing<char> >();
+    }
+
+private:
+    typedef std::vector<XMLCh> XmlString; // null-terminated
+
+    struct DocumentReleaser
+    {
+        void operator() (xercesc::DOMDocument* document) const { document->release(); }
+    };
+    typedef std::unique_ptr<xercesc::DOMDocument, DocumentReleaser> Document;
+
+    static XmlString copyOf (const XMLCh* text, XMLSize_t length)
+    {
+        XmlString copy (text, text + length);
+        copy.push_back(0);
+        return copy;
+    }
+
+    static bool isNamespaceDeclaration (const XMLCh* qualifiedName)
+    {
+        const XMLSize_t prefixLength = xercesc::XMLString::stringLen(xercesc::XMLUni::fgXMLNSString);
+        return xercesc::XMLString::startsWith(qualifiedName, xercesc::XMLUni::fgXMLNSString) &&
+            (qualifiedName[prefixLength] == 0 || qualifiedName[prefixLength] == xercesc::chColon);
+    }
+
+    static void setAttributes (xercesc::DOMElement* element, const xercesc::Attributes& attributes)
+    {
+        for (XMLSize_t i = 0; i < attributes.getLength(); ++i)
+        {
+            const XMLCh* qualifiedName = attributes.getQName(i);
+            element->setAttributeNS(
+                isNamespaceDeclaration(qualifiedName) ? xercesc::XMLUni::fgXMLNSURIName : attributes.getURI(i),
+                qualifiedName,
+                attributes.getValue(i));
+        }
+    }
+
+    virtual void startElement (
+        const XMLCh* const uri,
+        const XMLCh* const localName,
+        const XMLCh* const qualifiedName,
+        const xercesc::Attributes& attributes) override
+    {
+        (void)localName;
+        if (m_depth == 0)
+        {
+            // the document element: only its namespace declarations are needed, they're put on every fragment
+            for (XMLSize_t i = 0; i < attributes.getLength(); ++i)
+            {
+                const XMLCh* attributeName = attributes.getQName(i);
+                if (isNamespaceDeclaration(attributeName))
+                    m_namespaceDeclarations.emplace_back(
+                        copyOf(attributeName, xercesc::XMLString::stringLen(attributeName)),
+                        copyOf(attributes.getValue(i), xercesc::XMLString::stringLen(attributes.getValue(i))));
+            }
+        }
+        else if (m_depth == 1)
+        {
+            m_fragment.reset(m_implementation->createDocument(uri, qualifiedName, nullptr));
+            m_current = m_fragment->getDocumentElement();
+            for (const auto& declaration : m_namespaceDeclarations)
+                m_current->setAttributeNS(xercesc::XMLUni::fgXMLNSURIName, declaration.first.data(), declaration.second.data());
+            setAttributes(m_current, attributes); // after, as the element may redeclare a prefix
+        }
+        else
+        {
+            xercesc::DOMElement* element = m_fragment->createElementNS(uri, qualifiedName);
+            m_current->appendChild(element);
+            m_current = element;
+            setAttributes(m_current, attributes);
+        }
+        ++m_depth;
+    }
+
+    virtual void endElement (const XMLCh* const uri, const XMLCh* const localName, const XMLCh* const qualifiedName) override
+    {
+        (void)uri; (void)localName; (void)qualifiedName;
+        --m_depth;
+        if (m_depth == 1)
+        {
+            m_current = nullptr;
+            m_fragmentComplete = true;
+        }
+        else if (m_depth > 1)
+            m_current = static_cast<xercesc::DOMElement*>(m_current->getParentNode());
+    }
+
+    virtual void characters (const XMLCh* const text, const XMLSize_t length) override
+    {
+        if (m_current) // i.e. within a fragment; the whitespace between the children of the document element is dropped
+            m_current->appendChild(m_fragment->createTextNode(copyOf(text, length).data()));
+    }
+
+    xercesc::DOMImplementation* m_implementation;
+    size_t m_depth;
+    std::vector<std::pair<XmlString, XmlString>> m_namespaceDeclarations; // of the document element
+    Document m_fragment; // the child of the document element being read
+    xercesc::DOMElement* m_current;
+    bool m_fragmentComplete;
+};
+
+}
+
+#endif // CONFIGURATION_STREAMING_PARSER_H_
@@ -37,6 +37,7 @@ from colorama import Fore, Style
 from lxml.objectify import ObjectifiedDataElement
 from copy import deepcopy
 import logging
+import hashlib
 
 DEBUG = False
 DEBUG_XPATH = False
@@ -46,10 +47,16 @@ QUASAR_NAMESPACES = {'d':'http://cern.ch/quasar/Design'}
 class DesignInspector():
     """This class is to dig out data of interest for quasar NextGen transforms"""
     def __init__(self, designPath):
+        self.design_path = designPath
         design_file = open(designPath, 'r', encoding='utf-8')
         self.tree = etree.parse(design_file)
         # TODO: get root here if it is guaranteed to exist?
 
+    def get_design_hash(self):
+        """Returns the SHA-1 (hex) of the design file, e.g. to tell which design some data was made for"""
+        with open(self.design_path, 'rb') as design_file:
+            return hashlib.sha1(design_file.read()).hexdigest()
+
     def xpath(self, expr, *args):
         """ Just a wrapper on top of etree.xpath that does quasar namespaces mapping """
         xpath_expr = expr.format(*args)
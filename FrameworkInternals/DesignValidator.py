@@ -201,6 +201,26 @@ class DesignValidator():
                                            'when data type is UaVariant', locator)
                     assert_attribute_absent(cache_variable, 'initialValue',
                                             'when data type is UaVariant', locator)
+                self.validate_update_filter(cache_variable, locator)
+
+    def validate_update_filter(self, cachevariable, locator):
+        """Checks that updateFilter and deadband of given cache variable fit together and fit its data type"""
+        update_filter = cachevariable.get('updateFilter', 'none')
+        if update_filter in ['absoluteDeadband', 'percentDeadband']:
+            assert_attribute_present(cachevariable, 'deadband',
+                                     'when updateFilter={0}'.format(update_filter), locator)
+            if cachevariable.get('dataType') not in Oracle.NumericDataTypes:
+                raise DesignFlaw('updateFilter={0} needs a numeric data type (at: {1})'.format(
+                    update_filter, stringify_locator(locator)))
+            if not 0 <= float(cachevariable.get('deadband')) < float('inf'):
+                raise DesignFlaw('deadband must be finite and not negative (at: {0})'.format(
+                    stringify_locator(locator)))
+        else:
+            assert_attribute_absent(cachevariable, 'deadband',
+                                    'when updateFilter={0}'.format(update_filter), locator)
+        if update_filter != 'none' and count_children(cachevariable, 'array') > 0:
+            raise DesignFlaw('updateFilter is supported only for scalars (at: {0})'.format(
+                stringify_locator(locator)))
 
     def assert_mutex_present(self, class_name, locator, extra_info=''):
         """Raises DesignFlaw if class 'class_name' doesnt have a mutex"""
@@ -219,6 +239,9 @@ class DesignValidator():
             cls = self.design_inspector.objectify_class(class_name)
             for source_variable in self.design_inspector.objectify_source_variables(class_name):
                 locator['sourcevariable'] = source_variable.get('name')
+                if source_variable.get('cacheMaxAgeMs') is not None:
+                    assert_attribute_equal(source_variable, 'addressSpaceRead', 'asynchronous',
+                                           'to support setting cacheMaxAgeMs', locator)
                 mutex_options = [
                     source_variable.get('addressSpaceReadUseMutex'),
                     source_variable.get('addressSpaceWriteUseMutex')]
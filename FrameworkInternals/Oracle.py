@@ -327,6 +327,29 @@ class Oracle():
         else:
             return 'ArrayTools::convertUaVariantToVector'
 
+    def opcua_variant_to_vector_function(self, quasar_data_type):
+        """Returns the name of function from ArrayTools which copies an array
+           out of OpcUa_Variant in place"""
+        if quasar_data_type == 'OpcUa_Byte':
+            return 'ArrayTools::copyOpcUaVariantToByteVector'
+        elif quasar_data_type == 'OpcUa_Boolean':
+            return 'ArrayTools::copyOpcUaVariantToBooleanVector'
+        else:
+            return 'ArrayTools::copyOpcUaVariantToVector'
+
+    def data_type_to_stack_type(self, quasar_data_type):
+        """Returns the type of the OPC-UA stack in which given data type is
+           held inside of OpcUa_Variant"""
+        return {
+            'UaString'     : 'OpcUa_String',
+            'UaByteString' : 'OpcUa_ByteString',
+            'UaVariant'    : 'OpcUa_Variant'}.get(quasar_data_type, quasar_data_type)
+
+    def data_type_to_variant_array_member(self, quasar_data_type):
+        """Returns the member of OpcUa_VariantArrayUnion which points to
+           an array of given data type"""
+        return Oracle.DataTypeToBuiltinType[quasar_data_type].replace('OpcUaType_', '') + 'Array'
+
     def vector_to_uavariant_function(self, quasar_data_type):
         """Returns the name of function from ArrayTools which can perform
            that conversion"""
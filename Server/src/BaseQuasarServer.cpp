@@ -176,8 +176,12 @@ int BaseQuasarServer::serverRun(
         LOG(Log::ERR) << "Exception caught in BaseQuasarServer::serverRun:  [" << Quasar::TermColors::ForeRed() << e.what() << Quasar::TermColors::StyleReset() << "]";
         serverReturnCode = 1;
     }
+#ifndef BACKEND_OPEN62541
+    m_nodeManager->stopSourceVariableSampling ();
+#endif // BACKEND_OPEN62541
     AddressSpace::SourceVariables_destroySourceVariablesThreadPool ();
     shutdown();  // this is typically overridden by the developer
+    CalculatedVariables::Engine::shutdown();
 
     unlinkAllDevices(m_nodeManager);
     destroyMeta(m_nodeManager);
@@ -298,6 +302,11 @@ int BaseQuasarServer::parseCommandLine(
     bool createCertificateOnly = false;
     bool printVersion = false;
     string logFile;
+    string calculatedVariablesBackend;
+    unsigned int calculatedVariablesAsyncThreads = 0;
+    double calculatedVariablesMaxRate = 0;
+    unsigned int configurationThreads = 0;
+    string configurationCache;
     options_description desc("Allowed options");
 
     std::string defaultOpcUaBackendConfigurationFile = this->getApplicationPath() + "/ServerConfig.xml";
@@ -308,6 +317,16 @@ int BaseQuasarServer::parseCommandLine(
 	         ->default_value(defaultOpcUaBackendConfigurationFile),
                  "(Optional) path to the OPC-UA settings file")
             ("create_certificate", bool_switch(&createCertificateOnly), "Create new certificate and exit")
+            ("calculated_variables_backend", value<string>(&calculatedVariablesBackend)->default_value("muparser"),
+                 "(Optional) how CalculatedVariables formulas are evaluated: muparser or bytecode (experimental; formulas it can't handle still go to muparser)")
+            ("calculated_variables_async_threads", value<unsigned int>(&calculatedVariablesAsyncThreads)->default_value(0),
+                 "(Optional) evaluate CalculatedVariables in that many dedicated threads, coalescing changes, instead of in the thread making the change (0: synchronous)")
+            ("calculated_variables_max_rate", value<double>(&calculatedVariablesMaxRate)->default_value(0),
+                 "(Optional) with asynchronous evaluation, max evaluations per second of a CalculatedVariables synchronization domain (0: unlimited)")
+            ("configuration_threads", value<unsigned int>(&configurationThreads)->default_value(0),
+                 "(Optional) build the address space of independent top-level objects of the configuration in that many threads (0 or 1: sequentially)")
+            ("config_cache", value<string>(&configurationCache),
+                 "(Optional) a file where to keep the parsed and validated configuration, to skip the XML work when the same configuration is loaded again")
             ("help,h", "Print help")
             ("version,v", bool_switch(&printVersion), "Print version and exit");
 
@@ -353,6 +372,23 @@ int BaseQuasarServer::parseCommandLine(
     }
     else
     {
+        if (calculatedVariablesBackend == "bytecode")
+            CalculatedVariables::Engine::setFormulaBackend(CalculatedVariables::FormulaBackend::Bytecode);
+        else if (calculatedVariablesBackend == "muparser")
+            CalculatedVariables::Engine::setFormulaBackend(CalculatedVariables::FormulaBackend::MuParser);
+        else
+        {
+            cout << "Unknown calculated_variables_backend: " << calculatedVariablesBackend << ", please run with --help " << endl;
+            return 1;
+        }
+        if (calculatedVariablesMaxRate < 0)
+        {
+            cout << "calculated_variables_max_rate can't be negative, please run with --help " << endl;
+            return 1;
+        }
+        CalculatedVariables::Engine::setAsyncEvaluation(calculatedVariablesAsyncThreads, calculatedVariablesMaxRate);
+        setConfigurationThreads(configurationThreads);
+        setConfigurationCache(configurationCache);
         if (vm.count("config_file") > 0)
             *configurationFileName = vm["config_file"].as<string>();
         *isHelpOrVersion = false;